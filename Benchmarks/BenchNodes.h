@@ -0,0 +1,315 @@
+#pragma once
+
+#include "GraphicsNode.h"
+#include "CpuBackend.h"
+#include "DagGenerator.h"
+
+#include <cmath>
+
+/*
+ * Node types used by the benchmarks, one per DagNodeKind. They carry a small
+ * GLSL library like the real texture nodes, so codegen has work to do, and an
+ * optional amount of fake CPU work per solve for the parallel solve sweep.
+ * Their CPU kernels are there for the CPU render bench.
+ */
+
+inline size_t g_benchSolveWork = 0;
+
+class BenchNode : public GraphicsNode {
+public:
+	virtual DagNodeKind kind() const = 0;
+
+	NodeValue solve() override {
+		// the real nodes only emit GLSL, this stands in for CPU evaluated nodes
+		float acc = 0.0f;
+		for (size_t i = 0; i < inputCount(); i++) acc += input(i).value[0];
+		for (size_t i = 0; i < g_benchSolveWork; i++) acc = std::sin(acc) + 1.0f;
+		for (size_t i = 0; i < outputCount(); i++) texture(i).value[0] = acc;
+		return GraphicsNode::solve();
+	}
+};
+
+class BenchSourceNode : public BenchNode {
+public:
+	DagNodeKind kind() const override { return DagNodeKind::source; }
+
+	std::string library() {
+		return R"(void bench_source(in vec2 uv, float scale, out vec4 res) {
+	res = vec4(uv * scale, 0.0, 1.0);
+})";
+	}
+
+	std::string functionName() { return "bench_source"; }
+
+	GraphicsNodeParams parameters() {
+		return {
+			{ "uv", { "cUV", SpecialType::none } },
+			{ "scale", { "Scale", SpecialType::none } }
+		};
+	}
+
+	void onCreate() {
+		addOutput("Output", ValueType::vec4);
+		addParam("Scale", ValueType::scalar);
+		setParam("Scale", 1.0f);
+	}
+
+	bool evaluate(CpuArgs& args) override {
+		CpuValue uv = args.get(0);
+		CpuScalar scale = args.scalar(1);
+		args.set(0, { uv.x * scale, uv.y * scale, 0.0f, 1.0f });
+		return true;
+	}
+};
+
+class BenchUnaryNode : public BenchNode {
+public:
+	DagNodeKind kind() const override { return DagNodeKind::unary; }
+
+	std::string library() {
+		return R"(void bench_unary(in vec4 a, float amount, out vec4 res) {
+	res = a * amount;
+})";
+	}
+
+	std::string functionName() { return "bench_unary"; }
+
+	GraphicsNodeParams parameters() {
+		return {
+			{ "a", { "A", SpecialType::none } },
+			{ "amount", { "Amount", SpecialType::none } }
+		};
+	}
+
+	void onCreate() {
+		addInput("A", ValueType::vec4);
+		addOutput("Output", ValueType::vec4);
+		addParam("Amount", ValueType::scalar);
+		setParam("Amount", 0.5f);
+	}
+
+	bool evaluate(CpuArgs& args) override {
+		CpuValue a = args.get(0);
+		CpuScalar amount = args.scalar(1);
+		args.set(0, { a.x * amount, a.y * amount, a.z * amount, a.w * amount });
+		return true;
+	}
+};
+
+class BenchBinaryNode : public BenchNode {
+public:
+	DagNodeKind kind() const override { return DagNodeKind::binary; }
+
+	std::string library() {
+		return R"(void bench_binary(in vec4 a, in vec4 b, float factor, out vec4 res) {
+	res = mix(a, b, factor);
+})";
+	}
+
+	std::string functionName() { return "bench_binary"; }
+
+	GraphicsNodeParams parameters() {
+		return {
+			{ "a", { "A", SpecialType::none } },
+			{ "b", { "B", SpecialType::none } },
+			{ "factor", { "Factor", SpecialType::none } }
+		};
+	}
+
+	void onCreate() {
+		addInput("A", ValueType::vec4);
+		addInput("B", ValueType::vec4);
+		addOutput("Output", ValueType::vec4);
+		addParam("Factor", ValueType::scalar);
+		setParam("Factor", 0.5f);
+	}
+
+	bool evaluate(CpuArgs& args) override {
+		CpuValue a = args.get(0), b = args.get(1);
+		CpuScalar factor = args.scalar(2);
+		args.set(0, { mix(a.x, b.x, factor), mix(a.y, b.y, factor), mix(a.z, b.z, factor), mix(a.w, b.w, factor) });
+		return true;
+	}
+};
+
+class BenchSplitNode : public BenchNode {
+public:
+	DagNodeKind kind() const override { return DagNodeKind::split; }
+
+	std::string library() {
+		return R"(void bench_split(in vec4 a, out vec4 lo, out vec4 hi) {
+	lo = min(a, vec4(0.5));
+	hi = max(a, vec4(0.5));
+})";
+	}
+
+	std::string functionName() { return "bench_split"; }
+
+	GraphicsNodeParams parameters() {
+		return {
+			{ "a", { "A", SpecialType::none } }
+		};
+	}
+
+	void onCreate() {
+		addInput("A", ValueType::vec4);
+		addOutput("Low", ValueType::vec4);
+		addOutput("High", ValueType::vec4);
+	}
+
+	bool evaluate(CpuArgs& args) override {
+		CpuValue a = args.get(0);
+		const CpuScalar half = 0.5f;
+		args.set(0, { min(a.x, half), min(a.y, half), min(a.z, half), min(a.w, half) });
+		args.set(1, { max(a.x, half), max(a.y, half), max(a.z, half), max(a.w, half) });
+		return true;
+	}
+};
+
+// the mode of the mode nodes created next: a specialization param, or a
+// uniform the shader branches on
+inline bool g_benchSpecialize = true;
+
+// not a DagNodeKind, the specialization bench chains these by hand
+class BenchModeNode : public BenchNode {
+public:
+	DagNodeKind kind() const override { return DagNodeKind::unary; }
+
+	std::string library() {
+		return R"(void bench_mode_scale(in vec4 a, float amount, out vec4 res) {
+	res = a * amount;
+}
+
+void bench_mode_pow(in vec4 a, float amount, out vec4 res) {
+	res = pow(abs(a), vec4(amount));
+}
+
+void bench_mode_wave(in vec4 a, float amount, out vec4 res) {
+	res = sin(a * amount * 6.2831853) * 0.5 + 0.5;
+}
+
+void bench_mode_step(in vec4 a, float amount, out vec4 res) {
+	res = smoothstep(vec4(0.0), vec4(amount), a);
+}
+
+void bench_mode(in vec4 a, float amount, float mode, out vec4 res) {
+	if (mode == 1.0) {
+		bench_mode_pow(a, amount, res);
+	} else if (mode == 2.0) {
+		bench_mode_wave(a, amount, res);
+	} else if (mode == 3.0) {
+		bench_mode_step(a, amount, res);
+	} else {
+		bench_mode_scale(a, amount, res);
+	}
+})";
+	}
+
+	std::string functionName() {
+		static const std::string modes[] = { "bench_mode_scale", "bench_mode_pow", "bench_mode_wave", "bench_mode_step" };
+		static const Symbol modeParam = "Mode";
+		return m_specialized ? modes[variant(modeParam)] : "bench_mode";
+	}
+
+	GraphicsNodeParams parameters() {
+		return {
+			{ "a", { "A", SpecialType::none } },
+			{ "amount", { "Amount", SpecialType::none } },
+			{ "mode", { "Mode", SpecialType::none } }
+		};
+	}
+
+	void onCreate() {
+		addInput("A", ValueType::vec4);
+		addOutput("Output", ValueType::vec4);
+		addParam("Amount", ValueType::scalar);
+		setParam("Amount", 0.5f);
+
+		m_specialized = g_benchSpecialize;
+		if (m_specialized) addSpecializationParam("Mode", 4);
+		else addParam("Mode", ValueType::scalar);
+	}
+
+	bool evaluate(CpuArgs& args) override {
+		CpuValue a = args.get(0);
+		CpuScalar amount = args.scalar(1);
+
+		auto branch = [&](uint32_t mode, CpuScalar v) {
+			switch (mode) {
+				case 1: return pow(abs(v), amount);
+				case 2: return sin(v * amount * 6.2831853f) * 0.5f + 0.5f;
+				case 3: return smoothstep(0.0f, amount, v);
+				default: return v * amount;
+			}
+		};
+
+		// bench_mode's if chain, a mode that's a param folds it to one branch
+		auto apply = [&](CpuScalar v) {
+			if (m_specialized) return branch(args.variant(), v);
+
+			CpuScalar mode = args.scalar(2);
+			CpuScalar res = branch(0, v);
+			for (uint32_t k = 3; k >= 1; k--) res = select(equal(mode, float(k)), branch(k, v), res);
+			return res;
+		};
+		args.set(0, { apply(a.x), apply(a.y), apply(a.z), apply(a.w) });
+		return true;
+	}
+
+private:
+	bool m_specialized{ true };
+};
+
+// the end of a chain for the renders, like OutputNode
+class BenchOutputNode : public BenchNode {
+public:
+	DagNodeKind kind() const override { return DagNodeKind::unary; }
+
+	std::string library() {
+		return R"(void bench_output_$NODE(in vec4 color) {
+	imageStore(bOutput$NODE, ivec2(gl_GlobalInvocationID.xy), color);
+})";
+	}
+
+	std::string functionName() { return "bench_output_$NODE"; }
+	bool outputNode() override { return true; }
+
+	std::optional<StorageFormat> requestedFormat() override { return format; }
+	std::optional<StorageFormat> format; // none lets the graph pick, like OutputNode's
+
+	GraphicsNodeParams parameters() {
+		return {
+			{ "color", { "Color", SpecialType::none } }
+		};
+	}
+
+	void onCreate() {
+		addInput("Color", ValueType::vec4);
+	}
+
+	bool evaluate(CpuArgs& args) override {
+		args.emit(args.get(0));
+		return true;
+	}
+};
+
+constexpr const char* benchNodeTypes[] = { "SOURCE", "UNARY", "BINARY", "SPLIT" };
+
+template <typename Graph>
+GraphicsNode* createBenchNode(Graph& graph, DagNodeKind kind) {
+	switch (kind) {
+		case DagNodeKind::source: return graph.template create<BenchSourceNode>();
+		case DagNodeKind::unary: return graph.template create<BenchUnaryNode>();
+		case DagNodeKind::binary: return graph.template create<BenchBinaryNode>();
+		case DagNodeKind::split: return graph.template create<BenchSplitNode>();
+	}
+	return nullptr;
+}
+
+template <typename Graph>
+GraphicsNode* createBenchNode(Graph& graph, const std::string& type) {
+	for (size_t i = 0; i < std::size(benchNodeTypes); i++) {
+		if (type == benchNodeTypes[i]) return createBenchNode(graph, DagNodeKind(i));
+	}
+	return nullptr;
+}
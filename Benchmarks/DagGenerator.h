@@ -0,0 +1,194 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdint>
+#include <algorithm>
+
+/*
+ * Synthetic DAG generator
+ * ====================================================
+ * Produces a graph description only (node kinds + edges), building it into a
+ * NodeGraph is up to the caller. Edges always go from a lower to a higher node
+ * index, so every description is acyclic and the index order is a valid
+ * topological order. Every input gets at most one connection.
+ * The same (shape, count, seed) always gives the same graph.
+ */
+
+enum class DagNodeKind : uint8_t {
+	source = 0,	// 0 inputs, 1 output
+	unary,		// 1 input, 1 output
+	binary,		// 2 inputs, 1 output
+	split		// 1 input, 2 outputs
+};
+
+constexpr uint32_t dagInputCount[] = { 0, 1, 2, 1 };
+constexpr uint32_t dagOutputCount[] = { 1, 1, 1, 2 };
+
+enum class DagShape : uint8_t {
+	chain = 0,		// one long dependency chain
+	fan,			// a few sources fanned out wide, then reduced pairwise
+	diamond,		// split -> two branches -> join, repeated
+	multiOutput,	// split nodes feeding random later nodes from both outputs
+	random			// random kinds, inputs from a window of earlier nodes
+};
+
+constexpr const char* dagShapeNames[] = { "chain", "fan", "diamond", "multi_output", "random" };
+
+struct DagEdge {
+	uint32_t source, sourceOutput;
+	uint32_t destination, destinationInput;
+};
+
+struct DagSpec {
+	std::vector<DagNodeKind> nodes;
+	std::vector<DagEdge> edges;
+};
+
+class DagGenerator {
+public:
+	explicit DagGenerator(uint64_t seed) : m_rng(seed) {}
+
+	DagSpec generate(DagShape shape, size_t count) {
+		m_spec = {};
+		m_spec.nodes.reserve(count);
+		m_spec.edges.reserve(count * 2);
+		if (count == 0) return m_spec;
+
+		switch (shape) {
+			case DagShape::chain: chain(count); break;
+			case DagShape::fan: fan(count); break;
+			case DagShape::diamond: diamond(count); break;
+			case DagShape::multiOutput: multiOutput(count); break;
+			case DagShape::random: random(count); break;
+		}
+		return std::move(m_spec);
+	}
+
+private:
+	std::mt19937_64 m_rng;
+	DagSpec m_spec;
+
+	uint32_t add(DagNodeKind kind) {
+		m_spec.nodes.push_back(kind);
+		return uint32_t(m_spec.nodes.size() - 1);
+	}
+
+	void link(uint32_t source, uint32_t sourceOutput, uint32_t destination, uint32_t destinationInput) {
+		m_spec.edges.push_back({ source, sourceOutput, destination, destinationInput });
+	}
+
+	uint32_t pick(uint32_t first, uint32_t last) { // inclusive
+		return std::uniform_int_distribution<uint32_t>(first, last)(m_rng);
+	}
+
+	void chain(size_t count) {
+		uint32_t prev = add(DagNodeKind::source);
+		while (m_spec.nodes.size() < count) {
+			uint32_t node = add(DagNodeKind::unary);
+			link(prev, 0, node, 0);
+			prev = node;
+		}
+	}
+
+	void fan(size_t count) {
+		// sources, then a wide layer reading from them, then a binary reduction
+		size_t sources = std::max<size_t>(1, count / 64);
+		size_t width = std::max<size_t>(1, (count - std::min(count, sources)) / 2);
+
+		for (size_t i = 0; i < sources && m_spec.nodes.size() < count; i++) {
+			add(DagNodeKind::source);
+		}
+
+		std::vector<uint32_t> layer;
+		for (size_t i = 0; i < width && m_spec.nodes.size() < count; i++) {
+			uint32_t node = add(DagNodeKind::unary);
+			link(pick(0, uint32_t(sources - 1)), 0, node, 0);
+			layer.push_back(node);
+		}
+
+		while (layer.size() > 1 && m_spec.nodes.size() < count) {
+			std::vector<uint32_t> next;
+			for (size_t i = 0; i + 1 < layer.size() && m_spec.nodes.size() < count; i += 2) {
+				uint32_t node = add(DagNodeKind::binary);
+				link(layer[i], 0, node, 0);
+				link(layer[i + 1], 0, node, 1);
+				next.push_back(node);
+			}
+			if (layer.size() % 2) next.push_back(layer.back());
+			layer = std::move(next);
+		}
+
+		// pad with a chain off the last node
+		uint32_t prev = uint32_t(m_spec.nodes.size() - 1);
+		while (m_spec.nodes.size() < count) {
+			uint32_t node = add(DagNodeKind::unary);
+			link(prev, 0, node, 0);
+			prev = node;
+		}
+	}
+
+	void diamond(size_t count) {
+		uint32_t prev = add(DagNodeKind::source);
+		while (m_spec.nodes.size() + 4 <= count) {
+			uint32_t split = add(DagNodeKind::split);
+			uint32_t left = add(DagNodeKind::unary);
+			uint32_t right = add(DagNodeKind::unary);
+			uint32_t join = add(DagNodeKind::binary);
+			link(prev, 0, split, 0);
+			link(split, 0, left, 0);
+			link(split, 1, right, 0);
+			link(left, 0, join, 0);
+			link(right, 0, join, 1);
+			prev = join;
+		}
+		while (m_spec.nodes.size() < count) {
+			uint32_t node = add(DagNodeKind::unary);
+			link(prev, 0, node, 0);
+			prev = node;
+		}
+	}
+
+	void multiOutput(size_t count) {
+		// every split output is consumed by some later node
+		std::vector<std::pair<uint32_t, uint32_t>> open; // unconsumed (node, output)
+		open.push_back({ add(DagNodeKind::source), 0 });
+
+		while (m_spec.nodes.size() < count) {
+			bool splitNext = open.size() < 8 || pick(0, 3) == 0;
+			uint32_t node = add(splitNext ? DagNodeKind::split : DagNodeKind::binary);
+
+			for (uint32_t in = 0; in < dagInputCount[size_t(m_spec.nodes[node])]; in++) {
+				if (open.empty()) {
+					open.push_back({ pick(0, node - 1), 0 });
+				}
+				size_t at = pick(0, uint32_t(open.size() - 1));
+				link(open[at].first, open[at].second, node, in);
+				open[at] = open.back();
+				open.pop_back();
+			}
+
+			for (uint32_t out = 0; out < dagOutputCount[size_t(m_spec.nodes[node])]; out++) {
+				open.push_back({ node, out });
+			}
+		}
+	}
+
+	void random(size_t count) {
+		constexpr uint32_t window = 256;
+		add(DagNodeKind::source);
+
+		while (m_spec.nodes.size() < count) {
+			auto kind = DagNodeKind(pick(0, 3));
+			uint32_t node = add(kind);
+			uint32_t first = node > window ? node - window : 0;
+
+			for (uint32_t in = 0; in < dagInputCount[size_t(kind)]; in++) {
+				uint32_t source = pick(first, node - 1);
+				uint32_t output = pick(0, dagOutputCount[size_t(m_spec.nodes[source])] - 1);
+				link(source, output, node, in);
+			}
+		}
+	}
+};
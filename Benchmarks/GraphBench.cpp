@@ -0,0 +1,1169 @@
+#include "NodeGraph.h"
+#include "GraphicsNode.h"
+#include "ShaderGen.h"
+#include "RenderGraph.h"
+#include "Std140Layout.h"
+#include "TextureNodeGraph.hpp"
+#include "IntHash.h"
+#include "LruCache.h"
+#include "Voronoise.h"
+#include "olcUTIL_DataFile.h"
+
+#include "DagGenerator.h"
+#include "BenchNodes.h"
+#include "LegacyScanner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Graph core benchmarks
+ * ====================================================
+ * For every shape and size a DAG is generated from the seed, then each
+ * operation is timed `reps` times on a fresh graph. Before that the GLSL
+ * library parsers are timed against the old regex scanner on a generated
+ * library of --library-kb (0 skips it), and the render graph plans the
+ * textures of --transients random pass textures (0 skips it). The std140
+ * packer is checked against the layout rules, the program cache and its
+ * structural hash against the edits that must and mustn't recompile, the
+ * integer hashes against their reference values, 100k nodes are created and
+ * removed until the heap is back where it started, and a 50 node chain of
+ * mode nodes is generated with its modes compiled in and as branches. The noise
+ * kernels are timed on an image, and the fast one checked against a plain
+ * scalar version of its formula. A check that fails says why on stderr and
+ * the run exits with 1. One result per line:
+ *   csv:  benchmark,shape,nodes,edges,threads,reps,min_ms,median_ms,ns_per_node
+ *   json: one object per line with the same fields
+ *
+ * Usage: GraphBench [--sizes 10,100,1000] [--shapes chain,fan,diamond,multi_output,random]
+ *                   [--threads 1,2,4,8,16] [--reps 3] [--seed 1] [--work 0]
+ *                   [--codegen-max 10000] [--library-kb 200] [--transients 10000]
+ *                   [--format csv|json] [--out file]
+ */
+
+// the bytes held through operator new, for the removal check. Each block
+// keeps its size in front, 16 bytes keep malloc's alignment
+static std::atomic<size_t> g_heapBytes{ 0 };
+
+void* operator new(size_t size) {
+	void* block = std::malloc(size + 16);
+	if (!block) throw std::bad_alloc();
+	*static_cast<size_t*>(block) = size;
+	g_heapBytes.fetch_add(size, std::memory_order_relaxed);
+	return static_cast<char*>(block) + 16;
+}
+
+void operator delete(void* ptr) noexcept {
+	if (!ptr) return;
+	void* block = static_cast<char*>(ptr) - 16;
+	g_heapBytes.fetch_sub(*static_cast<size_t*>(block), std::memory_order_relaxed);
+	std::free(block);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	operator delete(ptr);
+}
+
+class BenchGraph : public TextureNodeGraph {
+public:
+	using NodeGraph::buildNodePath;
+
+	// NodeGraph::solve only, TextureNodeGraph::solve compiles a shader
+	void solveValues() { NodeGraph::solve(); }
+
+	void markAllDirty() {
+		for (Node* node : m_nodes) markDirty(node);
+	}
+
+	const SlotMap<Node*>& nodes() const { return m_nodes; }
+
+	// the bench nodes have no output node, so codegen gets the nodes to emit
+	std::vector<GraphicsNode*> pathNodes() {
+		compactNodePath();
+		std::vector<GraphicsNode*> nodes;
+		for (Node* node : m_nodePath) nodes.push_back(static_cast<GraphicsNode*>(node));
+		return nodes;
+	}
+
+	// what the last node of the path depends on, the rest is dead code
+	std::vector<GraphicsNode*> liveFromLast() {
+		compactNodePath();
+		if (m_nodePath.empty()) return {};
+		Node* last = m_nodePath.back();
+		return collectNodes(std::span(&last, 1));
+	}
+};
+
+struct Options {
+	std::vector<size_t> sizes{ 10, 100, 1000, 10000, 100000 };
+	std::vector<DagShape> shapes{ DagShape::chain, DagShape::fan, DagShape::diamond, DagShape::multiOutput, DagShape::random };
+	std::vector<size_t> threads{ 1, 2, 4, 8, 16 };
+	size_t reps{ 3 };
+	uint64_t seed{ 1 };
+	size_t work{ 0 };
+	size_t codegenMax{ 10000 }; // codegen concatenates every node library, keep it sane
+	size_t libraryKb{ 200 };
+	size_t transients{ 10000 };
+	bool json{ false };
+	std::string out;
+};
+
+struct Result {
+	std::string benchmark;
+	const char* shape;
+	size_t nodes, edges, threads, reps;
+	double minMs, medianMs;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// timed results nothing reads go here, so the work behind them stays
+static volatile uint64_t g_sink = 0;
+
+static double elapsedMs(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void printUsage() {
+	std::cerr << "Usage: GraphBench [--sizes 10,100,1000] [--shapes chain,fan,diamond,multi_output,random]\n"
+		"                  [--threads 1,2,4,8,16] [--reps 3] [--seed 1] [--work 0]\n"
+		"                  [--codegen-max 10000] [--library-kb 200] [--transients 10000]\n"
+		"                  [--format csv|json] [--out file]\n";
+}
+
+// the whole of text as a number, false if there's anything else in it
+template<typename T>
+static bool parseNumber(std::string_view text, T& value) {
+	auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+	return ec == std::errc{} && end == text.data() + text.size() && !text.empty();
+}
+
+static bool parseList(std::string_view text, std::vector<size_t>& values) {
+	values.clear();
+	while (true) {
+		size_t comma = text.find(',');
+		size_t value = 0;
+		if (!parseNumber(text.substr(0, comma), value)) return false;
+		values.push_back(value);
+		if (comma == std::string_view::npos) return true;
+		text.remove_prefix(comma + 1);
+	}
+}
+
+static bool parseOptions(int argc, char** argv, Options& opts) {
+	static constexpr std::string_view known[] = {
+		"--sizes", "--threads", "--reps", "--seed", "--work", "--codegen-max",
+		"--library-kb", "--transients", "--format", "--out", "--shapes"
+	};
+
+	for (int i = 1; i < argc; i++) {
+		std::string_view arg = argv[i];
+		if (std::find(std::begin(known), std::end(known), arg) == std::end(known)) {
+			std::cerr << "unknown option: " << arg << "\n";
+			printUsage();
+			return false;
+		}
+		if (i + 1 >= argc) {
+			std::cerr << "missing a value for " << arg << "\n";
+			printUsage();
+			return false;
+		}
+
+		std::string_view value = argv[++i];
+		bool ok = true;
+		if (arg == "--sizes") ok = parseList(value, opts.sizes);
+		else if (arg == "--threads") ok = parseList(value, opts.threads);
+		else if (arg == "--reps") {
+			ok = parseNumber(value, opts.reps);
+			opts.reps = std::max<size_t>(1, opts.reps);
+		}
+		else if (arg == "--seed") ok = parseNumber(value, opts.seed);
+		else if (arg == "--work") ok = parseNumber(value, opts.work);
+		else if (arg == "--codegen-max") ok = parseNumber(value, opts.codegenMax);
+		else if (arg == "--library-kb") ok = parseNumber(value, opts.libraryKb);
+		else if (arg == "--transients") ok = parseNumber(value, opts.transients);
+		else if (arg == "--format") {
+			ok = value == "csv" || value == "json";
+			opts.json = value == "json";
+		}
+		else if (arg == "--out") opts.out = value;
+		else if (arg == "--shapes") {
+			opts.shapes.clear();
+			std::string_view names = value;
+			while (ok) {
+				size_t comma = names.find(',');
+				auto pos = std::find(std::begin(dagShapeNames), std::end(dagShapeNames), names.substr(0, comma));
+				ok = pos != std::end(dagShapeNames);
+				if (ok) opts.shapes.push_back(DagShape(std::distance(std::begin(dagShapeNames), pos)));
+				if (comma == std::string_view::npos) break;
+				names.remove_prefix(comma + 1);
+			}
+		}
+
+		if (!ok) {
+			std::cerr << "bad value for " << arg << ": " << value << "\n";
+			printUsage();
+			return false;
+		}
+	}
+	return true;
+}
+
+// node functions each calling their own helper, about `bytes` long
+static std::string makeLibrary(size_t bytes, size_t& nodeFunctions) {
+	std::string lib;
+	nodeFunctions = 0;
+	while (lib.size() < bytes) {
+		size_t i = nodeFunctions++;
+		lib += std::format(R"(// hash for node {}
+void bench_hash_{}(in vec2 p, float s, out float h) {{
+	h = fract(sin(dot(p, vec2(12.9898, 78.233)) * s) * 43758.5453);
+}}
+
+/* node {}, mixes the hash with a gradient
+   and keeps alpha at 1 */
+void bench_node_{}(in vec2 uv, float scale, in vec4 tint, out vec4 res) {{
+	float h;
+	bench_hash_{}(uv, scale, h);
+	if (h > 0.5) {{
+		res = vec4(mix(vec3(uv, 0.0), tint.rgb, h), 1.0);
+	}} else {{
+		res = vec4(tint.rgb * h, 1.0);
+	}}
+}}
+
+)", i, i, i, i, i);
+	}
+	return lib;
+}
+
+class Runner {
+public:
+	Runner(const Options& opts, std::ostream& out) : m_opts(opts), m_out(out) {
+		if (m_opts.json) return;
+		m_out << "benchmark,shape,nodes,edges,threads,reps,min_ms,median_ms,ns_per_node\n";
+	}
+
+	void runLibrary() {
+		size_t functions = 0;
+		const std::string lib = makeLibrary(m_opts.libraryKb * 1024, functions);
+
+		ShaderLibrary parsed{};
+		timeLibrary("parse_library", functions, [&]() {
+			auto start = Clock::now();
+			parsed = ShaderGen::parseLib(lib);
+			return elapsedMs(start);
+		});
+
+		LegacyShaderGen legacy{};
+		timeLibrary("parse_library_legacy", functions, [&]() {
+			legacy = {};
+			auto start = Clock::now();
+			legacy.loadLib(lib);
+			return elapsedMs(start);
+		});
+
+		timeLibrary("paste_library", functions, [&]() {
+			ShaderGen gen{};
+			gen.loadLib(parsed);
+			auto start = Clock::now();
+			for (size_t i = 0; i < functions; i++) {
+				gen.pasteFunction(std::format("bench_node_{}", i));
+			}
+			return elapsedMs(start);
+		});
+
+		timeLibrary("paste_library_legacy", functions, [&]() {
+			LegacyShaderGen gen = legacy;
+			auto start = Clock::now();
+			for (size_t i = 0; i < functions; i++) {
+				gen.pasteFunction(std::format("bench_node_{}", i), lib);
+			}
+			return elapsedMs(start);
+		});
+
+		bool same = parsed.functions.size() == legacy.m_shaderLib.size();
+		for (auto&& [name, func] : parsed.functions) {
+			auto other = legacy.m_shaderLib.find(name);
+			same = same && other != legacy.m_shaderLib.end()
+				&& other->second.stringIndex == func.stringIndex
+				&& other->second.stringLength == func.stringLength
+				&& other->second.parameterOrder.size() == func.parameterOrder.size();
+		}
+		if (!same) fail("parse_library: the parsers don't agree on the library");
+	}
+
+	// one pass texture written per pass, read by up to 8 passes after it, in two sizes
+	void runRenderGraph() {
+		const RenderGraph::TextureDesc descs[] = {
+			{ 1024, 1024, 0x8814, 16 }, // GL_RGBA32F
+			{ 512, 512, 0x8814, 16 }
+		};
+
+		std::mt19937_64 rng{ m_opts.seed };
+		std::vector<std::pair<size_t, size_t>> lifetimes; // first, last pass
+		std::vector<size_t> kinds;
+		for (size_t i = 0; i < m_opts.transients; i++) {
+			lifetimes.emplace_back(i, i + 1 + rng() % 8);
+			kinds.push_back(rng() % std::size(descs));
+		}
+
+		RenderGraph graph{};
+		std::vector<double> times;
+		for (size_t rep = 0; rep < m_opts.reps; rep++) {
+			graph.clear();
+			auto start = Clock::now();
+			for (size_t i = 0; i < lifetimes.size(); i++) {
+				size_t transient = graph.addTransient(descs[kinds[i]]);
+				graph.use(transient, lifetimes[i].first);
+				graph.use(transient, lifetimes[i].second);
+			}
+			graph.compile();
+			times.push_back(elapsedMs(start));
+		}
+		std::sort(times.begin(), times.end());
+
+		report({
+			.benchmark = "render_graph",
+			.shape = "transients",
+			.nodes = lifetimes.size(),
+			.edges = 0,
+			.threads = 1,
+			.reps = m_opts.reps,
+			.minMs = times.front(),
+			.medianMs = times[times.size() / 2]
+		});
+
+		// transients sharing a texture must fit it and must not be alive at once,
+		// and for lifetimes on a line the most alive at once is all it should take
+		std::vector<std::vector<size_t>> shared(graph.physical().size());
+		for (size_t i = 0; i < lifetimes.size(); i++) shared[graph.physicalOf(i)].push_back(i);
+
+		bool ok = true;
+		for (size_t p = 0; p < shared.size(); p++) {
+			for (size_t k = 0; k < shared[p].size(); k++) {
+				size_t i = shared[p][k];
+				ok = ok && graph.physical()[p] == descs[kinds[i]];
+				ok = ok && (k == 0 || graph.lastUse(shared[p][k - 1]) < graph.firstUse(i));
+			}
+		}
+
+		for (size_t kind = 0; kind < std::size(descs); kind++) {
+			std::vector<int> alive(lifetimes.size() + 10, 0);
+			for (size_t i = 0; i < lifetimes.size(); i++) {
+				if (kinds[i] != kind) continue;
+				alive[lifetimes[i].first]++;
+				alive[lifetimes[i].second + 1]--;
+			}
+			int current = 0, most = 0;
+			for (int delta : alive) most = std::max(most, current += delta);
+			ok = ok && size_t(most) == size_t(std::count(graph.physical().begin(), graph.physical().end(), descs[kind]));
+		}
+
+		if (!ok) fail("render_graph: the plan shares a texture it can't");
+
+		auto& stats = graph.stats();
+		std::cerr << std::format(
+			"render_graph: {} transients in {} textures, {} MB peak, {} MB pooled, {} MB naive\n",
+			stats.transients, stats.textures,
+			stats.peakBytes >> 20, stats.pooledBytes >> 20, stats.naiveBytes >> 20
+		);
+	}
+
+	// a chain of four mode nodes, with the modes compiled in and as uniform
+	// branches. The per pixel cost is ShaderLibrary::cost of what each node
+	// calls, a branching node pays for every mode it could take
+	void runSpecialization(size_t count = 50) {
+		size_t cost[2]{}, bytes[2]{};
+		for (bool specialize : { false, true }) {
+			g_benchSpecialize = specialize;
+
+			BenchGraph graph{};
+			GraphicsNode* prev = graph.create<BenchSourceNode>();
+			for (size_t i = 1; i < count; i++) {
+				GraphicsNode* node = graph.create<BenchModeNode>();
+				node->setParam("Mode", float(i % 4));
+				graph.connect(prev, 0, node, 0);
+				prev = node;
+			}
+
+			auto nodes = graph.liveFromLast();
+			for (GraphicsNode* node : nodes) cost[specialize] += node->parsedLibrary().cost(node->functionName());
+
+			std::vector<double> times;
+			for (size_t rep = 0; rep < m_opts.reps; rep++) {
+				auto start = Clock::now();
+				ShaderGen gen{};
+				graph.solveFor(gen, nodes, "main");
+				std::string src = gen.generate();
+				times.push_back(elapsedMs(start));
+				bytes[specialize] = src.size();
+			}
+			std::sort(times.begin(), times.end());
+
+			report({
+				.benchmark = specialize ? "codegen_specialized" : "codegen_branching",
+				.shape = "mode_chain",
+				.nodes = count,
+				.edges = count - 1,
+				.threads = 1,
+				.reps = m_opts.reps,
+				.minMs = times.front(),
+				.medianMs = times[times.size() / 2]
+			});
+		}
+		g_benchSpecialize = true;
+
+		std::cerr << std::format(
+			"specialization: {} nodes, {} per pixel specialized, {} branching ({:.1f}x), {} vs {} bytes of GLSL\n",
+			count, cost[1], cost[0], double(cost[0]) / double(std::max<size_t>(cost[1], 1)), bytes[1], bytes[0]
+		);
+	}
+
+	// a mode chain rendered on the CPU, on one thread and on all of them.
+	// Both renders have to give the same pixels
+	void runCpuRender(size_t count = 20, uint32_t size = 512) {
+		BenchGraph graph{};
+		GraphicsNode* prev = graph.create<BenchSourceNode>();
+		for (size_t i = 1; i < count; i++) {
+			GraphicsNode* node = graph.create<BenchModeNode>();
+			node->setParam("Mode", float(i % 4));
+			node->setParam("Amount", 0.9f);
+			graph.connect(prev, 0, node, 0);
+			prev = node;
+		}
+		graph.connect(prev, 0, graph.create<BenchOutputNode>(), 0);
+
+		std::vector<float> image[2];
+		double best[2]{};
+		size_t allThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		for (size_t pass = 0; pass < 2; pass++) {
+			size_t threads = pass == 0 ? 1 : allThreads;
+			image[pass].assign(size_t(size) * size * 4, 0.0f);
+
+			auto sink = [&](GraphicsNode*, const TextureNodeGraph::Tile& tile, std::span<const float> pixels) {
+				for (uint32_t y = 0; y < tile.height; y++) {
+					std::copy_n(pixels.data() + size_t(y) * tile.width * 4, tile.width * 4, image[pass].data() + (size_t(tile.y + y) * size + tile.x) * 4);
+				}
+			};
+
+			std::vector<double> times;
+			for (size_t rep = 0; rep < m_opts.reps; rep++) {
+				auto start = Clock::now();
+				if (!graph.renderCpu(size, size, sink, { .threads = threads })) {
+					fail("cpu render: " + graph.lastError());
+					return;
+				}
+				times.push_back(elapsedMs(start));
+			}
+			std::sort(times.begin(), times.end());
+			best[pass] = times.front();
+
+			report({
+				.benchmark = "cpu_render",
+				.shape = "mode_chain",
+				.nodes = count + 1,
+				.edges = count,
+				.threads = threads,
+				.reps = m_opts.reps,
+				.minMs = times.front(),
+				.medianMs = times[times.size() / 2]
+			});
+		}
+
+		if (image[0] != image[1]) fail("cpu render: the threaded render differs from the single thread one");
+		double pixels = double(size) * size;
+		std::cerr << std::format(
+			"cpu render: {}, {:.1f} Mpixel/s on 1 thread, {:.1f} on {}\n",
+			simd::isa, pixels / (best[0] * 1e3), pixels / (best[1] * 1e3), allThreads
+		);
+
+		// the branching chain's modes are params, the bytecode folds the
+		// branches away and should come out as the specialized one
+		BytecodeProgram code[2];
+		for (bool specialize : { false, true }) {
+			g_benchSpecialize = specialize;
+
+			BenchGraph chain{};
+			GraphicsNode* last = chain.create<BenchSourceNode>();
+			for (size_t i = 1; i < count; i++) {
+				GraphicsNode* node = chain.create<BenchModeNode>();
+				node->setParam("Mode", float(i % 4));
+				node->setParam("Amount", 0.9f);
+				chain.connect(last, 0, node, 0);
+				last = node;
+			}
+			chain.connect(last, 0, chain.create<BenchOutputNode>(), 0);
+
+			if (!chain.compileCpu(size, size, code[specialize])) {
+				fail("cpu bytecode: " + chain.lastError());
+				g_benchSpecialize = true;
+				return;
+			}
+
+			auto& stats = code[specialize].stats;
+			std::cerr << std::format(
+				"cpu bytecode, {}: {} instructions, {} registers, cost {} per pixel ({} emitted, {} folded, {} merged, {} dead)\n",
+				specialize ? "specialized" : "branching", code[specialize].code.size(), code[specialize].registers,
+				code[specialize].cost(), stats.emitted, stats.folded, stats.merged, stats.dead
+			);
+		}
+		g_benchSpecialize = true;
+
+		// the same ops in the same order, the registers may be numbered apart
+		bool folded = code[0].code.size() == code[1].code.size() && code[0].cost() == code[1].cost()
+			&& std::equal(code[0].code.begin(), code[0].code.end(), code[1].code.begin(), [](const Instruction& a, const Instruction& b) {
+				return a.op == b.op && a.aux == b.aux;
+			});
+		if (!folded) fail("cpu bytecode: the branching chain didn't fold to the specialized one");
+	}
+
+	// a random graph of `count` nodes created, connected and removed again in
+	// a shuffled order, `rounds` times on one graph. The first round grows the
+	// graph's bookkeeping (id map, slots, path), after that every round has to
+	// leave the heap where the first one did, and the heap has to be back at
+	// its baseline once the graph is gone
+	void checkRemoval(size_t count = 100000, size_t rounds = 4) {
+		DagGenerator generator{ m_opts.seed };
+		m_spec = generator.generate(DagShape::random, count);
+		m_shape = DagShape::random;
+
+		std::mt19937_64 rng{ m_opts.seed };
+		std::vector<double> times;
+		std::vector<size_t> held; // bytes over the empty graph after each round
+		times.reserve(rounds);
+		held.reserve(rounds);
+
+		// the per type caches (port symbols, parsed libraries) stay for good,
+		// one node of every kind fills them before the baseline
+		{
+			BenchGraph warm{};
+			for (size_t kind = 0; kind < std::size(dagInputCount); kind++) createBenchNode(warm, DagNodeKind(kind));
+			warm.solveValues();
+		}
+
+		bool ok = true;
+		const size_t baseline = g_heapBytes.load();
+		{
+			BenchGraph graph{};
+			const size_t empty = g_heapBytes.load();
+			for (size_t round = 0; round < rounds; round++) {
+				{
+					std::vector<GraphicsNode*> nodes;
+					graph.beginTransaction();
+					create(graph, nodes);
+					connect(graph, nodes);
+					graph.commitTransaction();
+					graph.solveValues();
+
+					std::shuffle(nodes.begin(), nodes.end(), rng);
+					auto start = Clock::now();
+					for (GraphicsNode* node : nodes) graph.remove(node);
+					times.push_back(elapsedMs(start));
+				}
+				ok &= graph.nodeCount() == 0;
+				held.push_back(g_heapBytes.load() - empty);
+			}
+		}
+		const size_t after = g_heapBytes.load();
+
+		for (size_t round = 1; round < rounds; round++) ok &= held[round] <= held[0];
+		if (!ok || after != baseline) {
+			fail(std::format(
+				"removal: the heap didn't come back, {} bytes held after the first round, {} after the last, {} after the graph",
+				held.front(), held.back(), ptrdiff_t(after - baseline)
+			));
+		}
+
+		std::sort(times.begin(), times.end());
+		std::cerr << std::format(
+			"removal: {} nodes, {} edges, {:.1f} ns per node, {} KB of bookkeeping left in the empty graph\n",
+			count, m_spec.edges.size(), times.front() * 1e6 / double(count), held.front() >> 10
+		);
+	}
+
+	// the classic voronoise kernel against the fast one, a batch of 8 pixels
+	// at a time like the VM calls them. The fast one has to match a scalar
+	// version of its formula, through the cache and without it, and look
+	// like the classic one: a different hash, the same distribution
+	void runNoise(uint32_t size = 512) {
+		const float u = 1.0f, v = 0.5f;
+		const float k = 1.0f + std::pow(1.0f - v, 4.0f) * 63.0f;
+		const size_t batches = size_t(size) * size / simd::width;
+
+		// the pixels in rows, or shuffled so no batch shares a row of cells
+		auto render = [&](simd::Float(*kernel)(const simd::Float*), float scale, bool shuffled, std::vector<float>& image) {
+			image.resize(size_t(size) * size);
+			alignas(32) float xs[simd::width], ys[simd::width];
+			for (size_t batch = 0; batch < batches; batch++) {
+				for (size_t lane = 0; lane < simd::width; lane++) {
+					size_t pixel = shuffled ? (lane * batches + batch) : batch * simd::width + lane;
+					xs[lane] = (float(pixel % size) + 0.5f) / float(size) * scale;
+					ys[lane] = (float(pixel / size) + 0.5f) / float(size) * scale;
+				}
+				simd::Float operands[4] = { simd::Float::load(xs), simd::Float::load(ys), u, k };
+				alignas(32) float out[simd::width];
+				kernel(operands).store(out);
+				for (size_t lane = 0; lane < simd::width; lane++) {
+					image[shuffled ? (lane * batches + batch) : batch * simd::width + lane] = out[lane];
+				}
+			}
+		};
+
+		// the fast formula one pixel at a time, with the standard library's math
+		auto reference = [&](float x, float y) {
+			float px = std::floor(x), py = std::floor(y);
+			float va = 0.0f, wt = 0.0f;
+			for (int j = -2; j <= 2; j++) {
+				for (int i = -2; i <= 2; i++) {
+					float o[3];
+					int_hash::hash3(int32_t(px) + i, int32_t(py) + j, o);
+					float rx = float(i) - (x - px) + o[0] * u, ry = float(j) - (y - py) + o[1] * u;
+					float t = std::clamp(std::sqrt(rx * rx + ry * ry) / 1.414f, 0.0f, 1.0f);
+					float ww = std::pow(1.0f - t * t * (3.0f - 2.0f * t), k);
+					va += o[2] * ww;
+					wt += ww;
+				}
+			}
+			return va / wt;
+		};
+
+		auto stats = [](const std::vector<float>& image) {
+			double sum = 0.0, squares = 0.0;
+			for (float value : image) {
+				sum += value;
+				squares += double(value) * value;
+			}
+			double mean = sum / double(image.size());
+			return std::pair{ mean, std::sqrt(std::max(squares / double(image.size()) - mean * mean, 0.0)) };
+		};
+
+		// a cell is about 20 pixels wide at 24, 2.5 at 200
+		const float timedScale = 24.0f;
+		std::vector<float> image[2];
+		double best[2]{};
+		for (size_t pass = 0; pass < 2; pass++) {
+			auto kernel = pass == 0 ? &voronoise::classic : &voronoise::fast;
+			std::vector<double> times;
+			for (size_t rep = 0; rep < m_opts.reps; rep++) {
+				auto start = Clock::now();
+				render(kernel, timedScale, false, image[pass]);
+				times.push_back(elapsedMs(start));
+			}
+			std::sort(times.begin(), times.end());
+			best[pass] = times.front();
+
+			report({
+				.benchmark = pass == 0 ? "noise_classic" : "noise_fast",
+				.shape = "voronoise",
+				.nodes = 1,
+				.edges = 0,
+				.threads = 1,
+				.reps = m_opts.reps,
+				.minMs = times.front(),
+				.medianMs = times[times.size() / 2]
+			});
+		}
+
+		double pixels = double(size) * size;
+		auto [classicMean, classicDev] = stats(image[0]);
+		auto [fastMean, fastDev] = stats(image[1]);
+		std::cerr << std::format(
+			"noise: {}, {:.1f} Mpixel/s classic, {:.1f} fast ({:.1f}x), mean {:.3f} vs {:.3f}, deviation {:.3f} vs {:.3f}\n",
+			simd::isa, pixels / (best[0] * 1e3), pixels / (best[1] * 1e3), best[0] / std::max(best[1], 1e-9),
+			classicMean, fastMean, classicDev, fastDev
+		);
+		if (std::abs(classicMean - fastMean) > 0.05 || std::abs(classicDev - fastDev) > 0.05) {
+			fail("noise: the integer hash doesn't look like the sin hash");
+		}
+
+		// the image diff, at both scales
+		for (float scale : { timedScale, 200.0f }) {
+			std::vector<float> cached, shuffled;
+			render(&voronoise::fast, scale, false, cached);
+			render(&voronoise::fast, scale, true, shuffled);
+
+			float maxError = 0.0f;
+			for (size_t pixel = 0; pixel < cached.size(); pixel++) {
+				float x = (float(pixel % size) + 0.5f) / float(size) * scale;
+				float y = (float(pixel / size) + 0.5f) / float(size) * scale;
+				maxError = std::max(maxError, std::abs(cached[pixel] - reference(x, y)));
+			}
+
+			if (cached != shuffled) {
+				fail(std::format("noise: at scale {}, the cached hashes give other pixels than the lanes' own", scale));
+			}
+			if (maxError > 1e-4f) {
+				fail(std::format("noise: at scale {}, off the scalar formula by {}", scale, maxError));
+			}
+		}
+	}
+
+	// the hashes against the reference implementations (the xxhash library,
+	// pcg3d as published), then every lane against the scalar version
+	void checkIntHash() {
+		struct Expected {
+			uint32_t x, y;
+			uint32_t xxhash;
+			uint32_t pcg[3]; // of (x, y, 0)
+		};
+		const Expected expected[] = {
+			{ 0, 0, 0xDEB39513u, { 0x9BAFD7C6u, 0xA8E88A6Bu, 0x3F15482Cu } },
+			{ 1, 2, 0x690B83DBu, { 0x707C922Cu, 0x05A4FEFFu, 0xE5E4175Bu } },
+			{ uint32_t(-5), 7, 0xD7D1A59Du, { 0xFDE2A20Du, 0x74B87598u, 0x51F42244u } },
+			{ 0xFFFFFFFFu, 7, 0x50413EF6u, { 0x232C0F0Du, 0x242E3573u, 0xD92F9BD5u } },
+		};
+
+		bool ok = true;
+		for (auto& e : expected) {
+			uint32_t x = e.x, y = e.y, z = 0;
+			int_hash::pcg3d(x, y, z);
+			ok &= int_hash::xxhash32(e.x, e.y) == e.xxhash;
+			ok &= x == e.pcg[0] && y == e.pcg[1] && z == e.pcg[2];
+		}
+
+		std::mt19937 rng{ uint32_t(m_opts.seed) };
+		for (size_t batch = 0; batch < 1000 && ok; batch++) {
+			alignas(32) int32_t xs[simd::width], ys[simd::width];
+			for (size_t lane = 0; lane < simd::width; lane++) {
+				xs[lane] = int32_t(rng());
+				ys[lane] = int32_t(rng());
+			}
+
+			simd::Int x, y;
+			std::memcpy(&x, xs, sizeof(xs));
+			std::memcpy(&y, ys, sizeof(ys));
+			simd::Float hashes[3];
+			int_hash::hash3(x, y, hashes);
+
+			alignas(32) float rands[simd::width], lanes[3][simd::width];
+			int_hash::rand(x, y).store(rands);
+			for (size_t c = 0; c < 3; c++) hashes[c].store(lanes[c]);
+
+			for (size_t lane = 0; lane < simd::width; lane++) {
+				float scalar[3];
+				int_hash::hash3(xs[lane], ys[lane], scalar);
+				ok &= rands[lane] == int_hash::rand(xs[lane], ys[lane]);
+				ok &= lanes[0][lane] == scalar[0] && lanes[1][lane] == scalar[1] && lanes[2][lane] == scalar[2];
+			}
+		}
+
+		if (!ok) fail(std::format("int hash: the {} lanes don't give the reference bits", simd::isa));
+	}
+
+	// the program cache's eviction and the structural hash it's keyed by. A
+	// value edit has to keep the key, anything codegen reads has to change it
+	void checkProgramCache() {
+		LruCache<uint64_t, int> lru{ 2 };
+		lru.insert(1, 1);
+		lru.insert(2, 2);
+		bool ok = lru.find(1) && *lru.find(1) == 1; // 2 is the least recently used now
+		lru.insert(3, 3);
+		ok = ok && lru.size() == 2 && lru.contains(1) && lru.contains(3) && !lru.contains(2);
+		if (!ok) fail("program cache: the LRU didn't drop the least recently used entry");
+
+		// source -> mode -> output, and a second source to rewire the mode to
+		struct Chain {
+			BenchGraph graph{};
+			GraphicsNode* sources[2];
+			GraphicsNode* mode;
+			BenchOutputNode* output;
+
+			Chain() {
+				sources[0] = graph.create<BenchSourceNode>();
+				sources[1] = graph.create<BenchSourceNode>();
+				mode = graph.create<BenchModeNode>();
+				output = graph.create<BenchOutputNode>();
+				graph.connect(sources[0], 0, mode, 0);
+				graph.connect(mode, 0, output, 0);
+			}
+		};
+
+		Chain chain{};
+		const uint64_t base = chain.graph.structuralHash();
+
+		auto expect = [&](bool same, const char* edit) {
+			if ((chain.graph.structuralHash() == base) != same) {
+				fail(std::format("structural hash: {} {} the key", edit, same ? "changed" : "didn't change"));
+			}
+		};
+
+		chain.mode->setParam("Amount", 0.9f);
+		expect(true, "a param value");
+
+		chain.mode->setParam("Mode", 2.0f);
+		expect(false, "a variant");
+		chain.mode->setParam("Mode", 0.0f);
+		expect(true, "the variant set back");
+
+		chain.output->format = StorageFormat::rgba8;
+		expect(false, "an output format");
+		chain.output->format.reset();
+		expect(true, "the output format set back");
+
+		// A -> B -> A, the way back has to find A's program
+		LruCache<uint64_t, int> programs{ 16 };
+		size_t compiles = 0;
+		auto solve = [&]() {
+			uint64_t key = chain.graph.structuralHash();
+			if (!programs.find(key)) {
+				programs.insert(key, 0);
+				compiles++;
+			}
+		};
+		solve();
+		chain.graph.removeConnection(chain.sources[0], 0, chain.mode, 0);
+		chain.graph.connect(chain.sources[1], 0, chain.mode, 0);
+		expect(false, "a connection");
+		solve();
+		chain.graph.removeConnection(chain.sources[1], 0, chain.mode, 0);
+		chain.graph.connect(chain.sources[0], 0, chain.mode, 0);
+		expect(true, "the connection set back");
+		solve();
+		if (compiles != 2) fail(std::format("program cache: A -> B -> A compiled {} times, not 2", compiles));
+
+		// nothing of the process (pointers, symbol ids) goes in, the same
+		// graph built again gets the same key
+		Chain again{};
+		again.mode->setParam("Amount", 0.9f);
+		if (again.graph.structuralHash() != base) fail("structural hash: the same graph built twice hashes apart");
+	}
+
+	// the packer against offsets worked out by hand from the std140 rules
+	void checkStd140() {
+		Std140Layout layout{};
+		const std::pair<ValueType, uint32_t> expected[] = {
+			{ ValueType::scalar, 0 },
+			{ ValueType::vec3, 16 }, // vec3 aligns to 16
+			{ ValueType::scalar, 28 }, // in the 4 bytes after the vec3
+			{ ValueType::vec2, 32 },
+			{ ValueType::scalar, 40 },
+			{ ValueType::vec4, 48 },
+			{ ValueType::vec2, 64 },
+			{ ValueType::vec3, 80 },
+		};
+
+		bool ok = layout.add("image", ValueType::image) == Std140Layout::none;
+		for (size_t i = 0; i < std::size(expected); i++) {
+			ok = ok && layout.add(std::format("m{}", i), expected[i].first) == expected[i].second;
+		}
+		ok = ok && layout.size() == 96; // 92 rounded up to 16
+
+		if (!ok) fail("std140: the packer disagrees with the layout rules");
+	}
+
+	void run(DagShape shape, size_t count) {
+		DagGenerator generator{ m_opts.seed };
+		m_spec = generator.generate(shape, count);
+		m_shape = shape;
+		g_benchSolveWork = m_opts.work;
+
+		measure("create", 1, [&](BenchGraph& graph, std::vector<GraphicsNode*>& nodes) {
+			auto start = Clock::now();
+			create(graph, nodes);
+			return elapsedMs(start);
+		}, false);
+
+		measure("connect", 1, [&](BenchGraph& graph, std::vector<GraphicsNode*>& nodes) {
+			create(graph, nodes);
+			auto start = Clock::now();
+			connect(graph, nodes);
+			return elapsedMs(start);
+		}, false);
+
+		measure("connect_transaction", 1, [&](BenchGraph& graph, std::vector<GraphicsNode*>& nodes) {
+			create(graph, nodes);
+			auto start = Clock::now();
+			graph.beginTransaction();
+			connect(graph, nodes);
+			graph.commitTransaction();
+			return elapsedMs(start);
+		}, false);
+
+		measure("build_node_path", 1, [&](BenchGraph& graph, std::vector<GraphicsNode*>&) {
+			auto start = Clock::now();
+			graph.buildNodePath();
+			return elapsedMs(start);
+		});
+
+		for (size_t threads : m_opts.threads) {
+			measure("solve_full", threads, [&](BenchGraph& graph, std::vector<GraphicsNode*>&) {
+				graph.setThreadCount(threads);
+				graph.markAllDirty();
+				auto start = Clock::now();
+				graph.solveValues();
+				return elapsedMs(start);
+			});
+		}
+
+		measure("solve_edit", 1, [&](BenchGraph& graph, std::vector<GraphicsNode*>& nodes) {
+			GraphicsNode* edited = nodes[nodes.size() / 2];
+			auto start = Clock::now();
+			graph.markDirty(edited);
+			graph.solveValues();
+			return elapsedMs(start);
+		});
+
+		// in a shuffled order, the work per node is its degree, past the
+		// caches it pays a few misses on top
+		measure("remove", 1, [&](BenchGraph& graph, std::vector<GraphicsNode*>& nodes) {
+			std::mt19937_64 rng{ m_opts.seed };
+			std::shuffle(nodes.begin(), nodes.end(), rng);
+			auto start = Clock::now();
+			for (GraphicsNode* node : nodes) graph.remove(node);
+			return elapsedMs(start);
+		});
+
+		// what a solve pays before it knows it can reuse a compiled program
+		measure("structural_hash", 1, [&](BenchGraph& graph, std::vector<GraphicsNode*>&) {
+			auto start = Clock::now();
+			g_sink = graph.structuralHash();
+			return elapsedMs(start);
+		});
+
+		if (count <= m_opts.codegenMax) {
+			measure("codegen", 1, [&](BenchGraph& graph, std::vector<GraphicsNode*>&) {
+				auto nodes = graph.pathNodes();
+				auto start = Clock::now();
+				ShaderGen gen{};
+				graph.solveFor(gen, nodes, "main");
+				std::string src = gen.generate();
+				return elapsedMs(start);
+			});
+
+			// pruning included, the nodes column is still the whole graph
+			measure("codegen_live", 1, [&](BenchGraph& graph, std::vector<GraphicsNode*>&) {
+				auto start = Clock::now();
+				ShaderGen gen{};
+				graph.solveFor(gen, graph.liveFromLast(), "main");
+				std::string src = gen.generate();
+				return elapsedMs(start);
+			});
+		}
+
+		const auto file = (std::filesystem::temp_directory_path() / "graph_bench.dat").string();
+
+		measure("save", 1, [&](BenchGraph& graph, std::vector<GraphicsNode*>&) {
+			auto start = Clock::now();
+			save(graph, file);
+			return elapsedMs(start);
+		});
+
+		measure("load", 1, [&](BenchGraph& graph, std::vector<GraphicsNode*>&) {
+			save(graph, file);
+
+			BenchGraph loaded{};
+			auto start = Clock::now();
+			bool ok = load(loaded, file);
+			double ms = elapsedMs(start);
+
+			if (!ok || loaded.nodeCount() != graph.nodeCount()) {
+				fail("load: the saved graph didn't load back as it was");
+			}
+			return ms;
+		});
+
+		std::filesystem::remove(file);
+	}
+
+	size_t failures() const { return m_failures; }
+
+private:
+	const Options& m_opts;
+	std::ostream& m_out;
+	size_t m_failures{ 0 };
+	DagSpec m_spec;
+	DagShape m_shape{ DagShape::chain };
+
+	void create(BenchGraph& graph, std::vector<GraphicsNode*>& nodes) {
+		nodes.reserve(m_spec.nodes.size());
+		for (DagNodeKind kind : m_spec.nodes) {
+			nodes.push_back(createBenchNode(graph, kind));
+		}
+	}
+
+	void connect(BenchGraph& graph, const std::vector<GraphicsNode*>& nodes) {
+		for (auto&& edge : m_spec.edges) {
+			graph.connect(nodes[edge.source], edge.sourceOutput, nodes[edge.destination], edge.destinationInput);
+		}
+	}
+
+	void save(BenchGraph& graph, const std::string& file) {
+		olc::utils::datafile out{};
+		graph.save(out);
+		for (Node* node : graph.nodes()) {
+			auto kind = static_cast<BenchNode*>(node)->kind();
+			out["nodes"][std::format("node_{}", node->id())]["type"].SetString(benchNodeTypes[size_t(kind)]);
+		}
+		olc::utils::datafile::Write(out, file);
+	}
+
+	// mirrors the editor's loader, minus the visual nodes
+	bool load(BenchGraph& graph, const std::string& file) {
+		olc::utils::datafile in{};
+		if (!olc::utils::datafile::Read(in, file)) return false;
+
+		graph.beginTransaction();
+
+		std::unordered_map<int32_t, GraphicsNode*> savedIds;
+		auto&& nodes = in["nodes"];
+		for (size_t i = 0; i < nodes.GetArraySize(); i++) {
+			auto&& val = nodes.GetArrayItem(i);
+			auto node = createBenchNode(graph, val["type"].GetString());
+			if (!node) continue;
+
+			node->loadFrom(val);
+			savedIds[val["id"].GetInt()] = node;
+		}
+
+		auto&& connections = in["connections"];
+		for (size_t i = 0; i < connections.GetArraySize(); i++) {
+			auto&& val = connections.GetArrayItem(i);
+			auto source = savedIds.find(val["source"].GetInt());
+			auto destination = savedIds.find(val["destination"].GetInt());
+			if (source == savedIds.end() || destination == savedIds.end()) continue;
+
+			graph.connect(
+				source->second,
+				val["sourceOutput"].GetInt(),
+				destination->second,
+				val["destinationInput"].GetInt()
+			);
+		}
+
+		return graph.commitTransaction();
+	}
+
+	void timeLibrary(const std::string& name, size_t functions, const std::function<double()>& op) {
+		std::vector<double> times;
+		for (size_t rep = 0; rep < m_opts.reps; rep++) {
+			times.push_back(op());
+		}
+		std::sort(times.begin(), times.end());
+
+		report({
+			.benchmark = name,
+			.shape = "library",
+			.nodes = functions * 2,
+			.edges = 0,
+			.threads = 1,
+			.reps = m_opts.reps,
+			.minMs = times.front(),
+			.medianMs = times[times.size() / 2]
+		});
+	}
+
+	// `prebuilt` hands the operation a graph that's already created and connected
+	void measure(
+		const std::string& name,
+		size_t threads,
+		const std::function<double(BenchGraph&, std::vector<GraphicsNode*>&)>& op,
+		bool prebuilt = true
+	) {
+		std::vector<double> times;
+		for (size_t rep = 0; rep < m_opts.reps; rep++) {
+			BenchGraph graph{};
+			std::vector<GraphicsNode*> nodes;
+			if (prebuilt) {
+				graph.beginTransaction();
+				create(graph, nodes);
+				connect(graph, nodes);
+				graph.commitTransaction();
+				graph.solveValues();
+			}
+			times.push_back(op(graph, nodes));
+		}
+		std::sort(times.begin(), times.end());
+
+		report({
+			.benchmark = name,
+			.shape = dagShapeNames[size_t(m_shape)],
+			.nodes = m_spec.nodes.size(),
+			.edges = m_spec.edges.size(),
+			.threads = threads,
+			.reps = m_opts.reps,
+			.minMs = times.front(),
+			.medianMs = times[times.size() / 2]
+		});
+	}
+
+	void fail(const std::string& message) {
+		std::cerr << message << "\n";
+		m_failures++;
+	}
+
+	void report(const Result& res) {
+		double nsPerNode = res.nodes ? res.minMs * 1e6 / double(res.nodes) : 0.0;
+		const char* shape = res.shape;
+
+		char line[512];
+		if (m_opts.json) {
+			std::snprintf(line, sizeof(line),
+				"{\"benchmark\":\"%s\",\"shape\":\"%s\",\"nodes\":%zu,\"edges\":%zu,\"threads\":%zu,"
+				"\"reps\":%zu,\"min_ms\":%.6f,\"median_ms\":%.6f,\"ns_per_node\":%.2f}\n",
+				res.benchmark.c_str(), shape, res.nodes, res.edges, res.threads,
+				res.reps, res.minMs, res.medianMs, nsPerNode
+			);
+		}
+		else {
+			std::snprintf(line, sizeof(line), "%s,%s,%zu,%zu,%zu,%zu,%.6f,%.6f,%.2f\n",
+				res.benchmark.c_str(), shape, res.nodes, res.edges, res.threads,
+				res.reps, res.minMs, res.medianMs, nsPerNode
+			);
+		}
+		m_out << line << std::flush;
+	}
+};
+
+int main(int argc, char** argv) {
+	Options opts{};
+	if (!parseOptions(argc, argv, opts)) return 1;
+
+	std::ofstream file;
+	if (!opts.out.empty()) {
+		file.open(opts.out);
+		if (!file) {
+			std::cerr << "can't write to " << opts.out << "\n";
+			return 1;
+		}
+	}
+	std::ostream& out = opts.out.empty() ? std::cout : file;
+
+	Runner runner{ opts, out };
+	if (opts.libraryKb > 0) runner.runLibrary();
+	if (opts.transients > 0) runner.runRenderGraph();
+	runner.checkStd140();
+	runner.checkProgramCache();
+	runner.checkIntHash();
+	runner.runSpecialization();
+	runner.runCpuRender();
+	runner.runNoise();
+	runner.checkRemoval();
+	for (DagShape shape : opts.shapes) {
+		for (size_t size : opts.sizes) {
+			runner.run(shape, size);
+		}
+	}
+
+	if (runner.failures() > 0) {
+		std::cerr << runner.failures() << " checks failed\n";
+		return 1;
+	}
+	return 0;
+}
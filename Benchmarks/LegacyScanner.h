@@ -0,0 +1,212 @@
+#pragma once
+
+#include "ShaderGen.h"
+
+#include <cctype>
+#include <regex>
+#include <vector>
+
+/*
+ * The regex based StringScanner and the library parsers built on it, as they
+ * were before GlslTokenizer. Kept only so the benchmarks can compare the two.
+ */
+
+template <typename Char = char>
+class StringScanner {
+public:
+	using Str = std::basic_string<Char>;
+	using RegExp = std::basic_regex<Char>;
+
+	StringScanner() = default;
+	StringScanner(const Str& input) {
+		m_data = std::vector<Char>(input.begin(), input.end());
+	}
+
+	Char peek(size_t offset = 0) const { return m_data.empty() ? '\0' : m_data[offset]; }
+	Char scan() {
+		if (m_data.empty()) return '\0';
+		Char tmp = m_data.front();
+		m_data.erase(m_data.begin());
+		m_position++;
+		return tmp;
+	}
+
+	std::string scanWhile(RegExp re) {
+		std::string ret = "";
+		while (peek() != '\0' && std::regex_match(Str(1, peek()), re)) {
+			ret += scan();
+		}
+		return ret;
+	}
+
+	std::string peekWhile(RegExp re) {
+		std::string ret = "";
+		size_t offset = 0;
+		while (peek(offset) != '\0' && std::regex_match(Str(1, peek(offset)), re)) {
+			ret += peek(offset++);
+		}
+		return ret;
+	}
+
+	void skipSpaces() {
+		scanWhile(std::basic_regex<Char>("\\s"));
+	}
+
+	size_t position() const { return m_position; }
+
+private:
+	std::vector<Char> m_data;
+	size_t m_position{ 0 };
+};
+
+class LegacyShaderGen : public ShaderGen {
+public:
+	// hide the new library tables, only the code targets are shared
+	std::unordered_map<std::string, ShaderFunction> m_shaderLib;
+	std::vector<std::string> m_pasted;
+
+	void loadLib(const std::string& src) {
+		const std::regex identifierName("[a-zA-Z0-9_]");
+		StringScanner ss{ src };
+
+		while (ss.peek()) {
+			size_t pos = ss.position();
+			char c = ss.scan();
+
+			if (std::isalpha(c)) { // check for functions
+				std::string retType = c + ss.scanWhile(identifierName);
+				ss.skipSpaces();
+
+				std::string identifier = ss.scanWhile(identifierName);
+				ss.skipSpaces();
+
+				if (ss.peek() != '(') { // expect function signature, otherwise it's not a function.
+					continue;
+				}
+
+				ss.scan(); // remove (
+				ss.skipSpaces();
+
+				ShaderFunction func{};
+				func.name = identifier;
+				func.stringIndex = pos;
+
+				// read parameters
+				while (ss.peek() != ')') {
+
+					// read param
+					std::vector<std::string> paramStr;
+					while (ss.peek() != ',' && ss.peek() != ')') {
+						paramStr.push_back(ss.scanWhile(identifierName));
+						ss.skipSpaces();
+					}
+					if (ss.peek() == ',') ss.scan(); // remove ,
+					ss.skipSpaces();
+
+					ShaderFunctionParam param;
+
+					switch (paramStr.size()) {
+						default: continue; break;
+						case 2: {
+							param.qualifier = ShaderFunctionParam::none;
+							for (size_t i = 0; i < std::size(typeStr); i++) {
+								if (typeStr[i] == paramStr[0]) {
+									param.type = ValueType(i);
+									break;
+								}
+							}
+							param.name = paramStr[1];
+						} break;
+						case 3: { // has qualifier
+							param.qualifier = ShaderFunctionParam::none;
+							if (paramStr[0] == "in") param.qualifier = ShaderFunctionParam::in;
+							else if (paramStr[0] == "out") param.qualifier = ShaderFunctionParam::out;
+
+							for (size_t i = 0; i < std::size(typeStr); i++) {
+								if (typeStr[i] == paramStr[1]) {
+									param.type = ValueType(i);
+									break;
+								}
+							}
+							param.name = paramStr[2];
+						} break;
+					}
+
+					param.symbol = param.name;
+					func.parameters[param.name] = param;
+					func.parameterOrder.push_back(param);
+				}
+
+				ss.skipSpaces();
+				ss.scan(); // remove )
+
+				ss.skipSpaces();
+
+				// skip function body
+				int braceCount = 0;
+				if (ss.scan() == '{') {
+					braceCount++;
+
+					while (true) {
+						char bc = ss.scan();
+						if (bc == '{') braceCount++;
+						else if (bc == '}') braceCount--;
+
+						if (braceCount <= 0) break;
+					}
+
+					if (ss.peek() == '}') ss.scan();
+				}
+
+				func.stringLength = ss.position() - func.stringIndex;
+				m_shaderLib[func.name] = func;
+
+				ss.skipSpaces();
+			}
+		}
+	}
+
+	void pasteFunction(const std::string& funcName, const std::string& shaderCode) {
+		if (std::find(m_pasted.begin(), m_pasted.end(), funcName) != m_pasted.end()) {
+			return;
+		}
+
+		if (m_shaderLib.find(funcName) == m_shaderLib.end()) { // not found? bleh
+			return;
+		}
+
+		auto func = m_shaderLib[funcName];
+		auto src = shaderCode.substr(func.stringIndex, func.stringLength);
+
+		// check for dependent functions
+		const std::regex identifierName("[a-zA-Z0-9_]");
+		StringScanner ss{ src };
+
+		while (ss.peek()) {
+			size_t pos = ss.position();
+			char c = ss.scan();
+
+			if (std::isalpha(c)) { // check for functions
+				std::string identifier = c + ss.scanWhile(identifierName);
+				ss.skipSpaces();
+
+				if (ss.peek() != '(') { // expect function signature, otherwise it's not a function.
+					continue;
+				}
+
+				while (ss.peek() != ')' && ss.peek() != 0) ss.scan();
+				if (ss.peek() == ')') ss.scan();
+				ss.skipSpaces();
+
+				if (ss.peek() == ';') {
+					pasteFunction(identifier, shaderCode);
+				}
+			}
+		}
+
+		m_targets[Target::definitions] += src;
+		m_targets[Target::definitions] += "\n\n";
+
+		m_pasted.push_back(funcName);
+	}
+};
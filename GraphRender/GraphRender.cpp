@@ -0,0 +1,370 @@
+#include "TextureNodeGraph.hpp"
+#include "TextureNodes.hpp"
+#include "ThreadPool.h"
+#include "olcUTIL_DataFile.h"
+
+#include "ImageFile.h"
+#include "OffscreenGL.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Headless graph renderer
+ * ====================================================
+ * Loads .dat graphs saved by the editor, renders every output node and
+ * writes the images, without a window or NanoVG. One file per output node,
+ * <graph>.<ext> when the graph has a single output and <graph>_<node>.<ext>
+ * otherwise (the node's id in the .dat), next to the graph or in --out.
+ *
+ * The CPU backend compiles every graph to bytecode first, on this thread
+ * (node creation interns symbols, which isn't thread safe), then renders
+ * bands of rows, the graphs' bands one after the other from the top down, a
+ * wave of them at a time on the pool, so the workers stay busy whether there
+ * is one graph or hundreds. Each wave goes to the files before the next one
+ * renders. The GPU backend renders the graphs one after the other on an
+ * offscreen GL context, tiled, and writes each row of tiles as it comes back.
+ * Either way only a wave or a row of tiles is in memory, never an image.
+ *
+ * Image nodes can't be rendered: a .dat keeps the texture's id, not the
+ * picture.
+ *
+ * Usage: GraphRender [--size 1024x1024] [--backend cpu|gpu] [--format png|pfm]
+ *                    [--out dir] [--threads 0] graph.dat...
+ */
+
+struct Options {
+	uint32_t width{ 1024 }, height{ 1024 };
+	bool gpu{ false };
+	bool pfm{ false };
+	std::filesystem::path out; // next to each graph when empty
+	size_t threads{ 0 }; // 0 is one per core
+	std::vector<std::filesystem::path> graphs;
+};
+
+// a graph of the batch, and what became of it
+struct Job {
+	std::filesystem::path path;
+	std::unique_ptr<TextureNodeGraph> graph;
+	std::unordered_map<GraphicsNode*, int32_t> savedIds;
+	std::string error;
+
+	BytecodeProgram code; // the CPU backend's
+	std::vector<GraphicsNode*> outputs; // in the order of the files
+	std::vector<std::unique_ptr<image_file::RowWriter>> files; // open while rendering
+};
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMs(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void printUsage() {
+	std::cerr << "Usage: GraphRender [--size 1024x1024] [--backend cpu|gpu] [--format png|pfm]\n"
+		"                   [--out dir] [--threads 0] graph.dat...\n";
+}
+
+// the whole of text as a number, false if there's anything else in it
+template<typename T>
+static bool parseNumber(std::string_view text, T& value) {
+	auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+	return ec == std::errc{} && end == text.data() + text.size() && !text.empty();
+}
+
+static bool parseOptions(int argc, char** argv, Options& opts) {
+	static constexpr std::string_view known[] = { "--size", "--backend", "--format", "--out", "--threads" };
+
+	for (int i = 1; i < argc; i++) {
+		std::string_view arg = argv[i];
+		if (!arg.starts_with("--")) {
+			opts.graphs.emplace_back(arg);
+			continue;
+		}
+
+		if (std::find(std::begin(known), std::end(known), arg) == std::end(known)) {
+			std::cerr << "unknown option: " << arg << "\n";
+			printUsage();
+			return false;
+		}
+		if (i + 1 >= argc) {
+			std::cerr << "missing a value for " << arg << "\n";
+			printUsage();
+			return false;
+		}
+
+		std::string_view value = argv[++i];
+		bool ok = true;
+		if (arg == "--size") {
+			size_t x = value.find('x');
+			ok = parseNumber(value.substr(0, x), opts.width);
+			if (x == std::string_view::npos) opts.height = opts.width;
+			else ok = ok && parseNumber(value.substr(x + 1), opts.height);
+			ok = ok && opts.width > 0 && opts.height > 0;
+		}
+		else if (arg == "--backend") {
+			ok = value == "cpu" || value == "gpu";
+			opts.gpu = value == "gpu";
+		}
+		else if (arg == "--format") {
+			ok = value == "png" || value == "pfm";
+			opts.pfm = value == "pfm";
+		}
+		else if (arg == "--out") opts.out = value;
+		else if (arg == "--threads") ok = parseNumber(value, opts.threads);
+
+		if (!ok) {
+			std::cerr << "bad value for " << arg << ": " << value << "\n";
+			printUsage();
+			return false;
+		}
+	}
+
+	if (opts.graphs.empty()) {
+		printUsage();
+		return false;
+	}
+	return true;
+}
+
+// the graph of the job's file, not solved
+static bool loadGraph(Job& job) {
+	olc::utils::datafile in{};
+	if (!olc::utils::datafile::Read(in, job.path.string())) {
+		job.error = "can't read the file";
+		return false;
+	}
+
+	job.graph = std::make_unique<TextureNodeGraph>();
+	auto savedIds = job.graph->load(in, [&](const std::string& type) {
+		GraphicsNode* node = createTextureNode(*job.graph, type);
+		if (!node) std::cerr << std::format("{}: skipping a node of unknown type '{}'\n", job.path.string(), type);
+		return node;
+	});
+	for (auto& [id, node] : savedIds) {
+		job.savedIds[node] = id;
+
+		// the texture it names is the editor's, and gone
+		if (dynamic_cast<ImageNode*>(node) && job.graph->getNodeOutputConnections(node).size() > 0) {
+			job.error = std::format("node {} is an image, the .dat doesn't keep the picture", id);
+			return false;
+		}
+	}
+	return true;
+}
+
+static std::filesystem::path imagePath(const Options& opts, const Job& job, GraphicsNode* output) {
+	std::filesystem::path dir = opts.out.empty() ? job.path.parent_path() : opts.out;
+	std::string name = job.path.stem().string();
+	if (job.outputs.size() > 1) name += std::format("_{}", job.savedIds.at(output));
+	return dir / (name + (opts.pfm ? ".pfm" : ".png"));
+}
+
+// a file per output of the job. False, with the job's error set, if one can't be created
+static bool openImages(const Options& opts, Job& job) {
+	for (GraphicsNode* output : job.outputs) {
+		std::unique_ptr<image_file::RowWriter> file;
+		if (opts.pfm) file = std::make_unique<image_file::PfmWriter>();
+		else file = std::make_unique<image_file::PngWriter>();
+
+		std::string path = imagePath(opts, job, output).string();
+		if (!file->open(path, opts.width, opts.height)) {
+			job.error = std::format("can't write {}", path);
+			job.files.clear();
+			return false;
+		}
+		job.files.push_back(std::move(file));
+	}
+	return true;
+}
+
+// rows of the job's output'th image, pixels has them from the bottom up
+static void writeRows(const Options& opts, Job& job, size_t output, const std::vector<float>& pixels, uint32_t rows) {
+	for (uint32_t row = rows; row-- > 0;) {
+		if (!job.files[output]->writeRow(pixels.data() + size_t(row) * opts.width * 4)) {
+			job.error = std::format("can't write {}", imagePath(opts, job, job.outputs[output]).string());
+			return;
+		}
+	}
+}
+
+// after the last row, prints the paths of the files written
+static void closeImages(const Options& opts, Job& job) {
+	for (size_t i = 0; i < job.files.size(); i++) {
+		std::string path = imagePath(opts, job, job.outputs[i]).string();
+		if (!job.files[i]->finish()) {
+			if (job.error.empty()) job.error = std::format("can't write {}", path);
+		}
+		else if (job.error.empty()) std::cout << path << "\n";
+	}
+	job.files.clear();
+}
+
+// compiles every graph, then renders the bands of all of them a wave at a
+// time over the whole pool, and writes each wave before the next
+static void renderCpu(const Options& opts, ThreadPool& pool, std::vector<Job>& jobs) {
+	std::vector<Job*> ready;
+	for (auto& job : jobs) {
+		if (!job.error.empty()) continue;
+		if (!job.graph->compileCpu(opts.width, opts.height, job.code)) {
+			job.error = job.graph->lastError().empty() ? "nothing to render" : job.graph->lastError();
+			continue;
+		}
+		for (auto& target : job.code.targets) job.outputs.push_back(target.node);
+		ready.push_back(&job);
+	}
+
+	// the files take the rows top first, so the bands go from the top down
+	struct Band {
+		Job* job;
+		uint32_t y, rows; // rows from y up
+		std::vector<std::vector<float>> pixels; // per output, while its wave is in flight
+	};
+	const uint32_t bandRows = 16;
+	std::vector<Band> bands;
+	for (Job* job : ready) {
+		for (uint32_t top = opts.height; top > 0;) {
+			uint32_t rows = std::min(top, bandRows);
+			top -= rows;
+			bands.push_back({ job, top, rows, {} });
+		}
+	}
+
+	// a couple of bands per worker, the pool's stealing evens out the slow ones
+	const size_t waveBands = pool.size() * 2;
+	for (size_t first = 0; first < bands.size(); first += waveBands) {
+		std::span<Band> wave(bands.data() + first, std::min(waveBands, bands.size() - first));
+		for (Band& band : wave) {
+			if (band.y + band.rows == opts.height) openImages(opts, *band.job);
+		}
+
+		std::vector<void*> seeds;
+		for (Band& band : wave) seeds.push_back(&band);
+		pool.run(seeds, seeds.size(), [&](void* item, size_t) {
+			Band& band = *static_cast<Band*>(item);
+			Job& job = *band.job;
+			if (!job.error.empty()) return;
+
+			band.pixels.assign(job.outputs.size(), std::vector<float>(size_t(opts.width) * band.rows * 4));
+			BytecodeVM vm{ job.code, opts.width };
+			std::vector<float*> rows(band.pixels.size());
+			for (uint32_t row = 0; row < band.rows; row++) {
+				for (size_t i = 0; i < rows.size(); i++) rows[i] = band.pixels[i].data() + size_t(row) * opts.width * 4;
+				vm.run(0, band.y + row, opts.width, rows.data());
+			}
+		});
+
+		// a job's bands in the wave are next to each other and in order, its files take them on one worker
+		seeds.clear();
+		for (size_t i = 0; i < wave.size(); i++) {
+			if (i == 0 || wave[i].job != wave[i - 1].job) seeds.push_back(&wave[i]);
+		}
+		pool.run(seeds, seeds.size(), [&](void* item, size_t) {
+			Job& job = *static_cast<Band*>(item)->job;
+			for (Band* band = static_cast<Band*>(item); band != wave.data() + wave.size() && band->job == &job; band++) {
+				for (size_t i = 0; i < band->pixels.size() && job.error.empty(); i++) {
+					writeRows(opts, job, i, band->pixels[i], band->rows);
+				}
+				band->pixels = {};
+			}
+		});
+
+		for (Band& band : wave) {
+			if (band.y == 0) closeImages(opts, *band.job);
+		}
+	}
+}
+
+// one graph at a time on the GL context, tiled
+static void renderGpu(const Options& opts, std::vector<Job>& jobs) {
+	OffscreenGL context;
+	std::string error;
+	if (!context.create(error)) {
+		for (auto& job : jobs) {
+			if (job.error.empty()) job.error = error;
+		}
+		return;
+	}
+
+	for (auto& job : jobs) {
+		if (!job.error.empty()) continue;
+
+		job.graph->compile();
+		if (!job.graph->generatedShader) {
+			job.error = "nothing to render";
+			continue;
+		}
+
+		std::unordered_map<GraphicsNode*, size_t> index;
+		for (GraphicsNode* node : job.graph->liveNodes()) {
+			if (!node->outputNode()) continue;
+			index[node] = job.outputs.size();
+			job.outputs.push_back(node);
+		}
+		if (!openImages(opts, job)) continue;
+
+		// the tiles come a row at a time from the top, a row of them goes to the files once it's whole
+		std::vector<std::vector<float>> strips(job.outputs.size());
+		auto sink = [&](GraphicsNode* output, const TextureNodeGraph::Tile& tile, std::span<const float> pixels) {
+			size_t i = index.at(output);
+			auto& strip = strips[i];
+			if (tile.x == 0) strip.resize(size_t(opts.width) * tile.height * 4);
+			for (uint32_t y = 0; y < tile.height; y++) {
+				std::copy_n(pixels.data() + size_t(y) * tile.width * 4, tile.width * 4, strip.data() + (size_t(y) * opts.width + tile.x) * 4);
+			}
+
+			if (tile.x + tile.width == opts.width && job.error.empty()) writeRows(opts, job, i, strip, tile.height);
+		};
+
+		if (!job.graph->renderTiled(opts.width, opts.height, sink)) {
+			job.error = "the tiled render failed";
+		}
+		closeImages(opts, job);
+	}
+}
+
+int main(int argc, char** argv) {
+	Options opts{};
+	if (!parseOptions(argc, argv, opts)) return 1;
+
+	if (!opts.out.empty()) {
+		std::error_code ec;
+		std::filesystem::create_directories(opts.out, ec);
+	}
+
+	size_t threads = opts.threads ? opts.threads : std::max(std::thread::hardware_concurrency(), 1u);
+	ThreadPool pool{ threads };
+
+	std::vector<Job> jobs(opts.graphs.size());
+	for (size_t i = 0; i < jobs.size(); i++) {
+		jobs[i].path = opts.graphs[i];
+		loadGraph(jobs[i]);
+	}
+
+	auto start = Clock::now();
+	if (opts.gpu) renderGpu(opts, jobs);
+	else renderCpu(opts, pool, jobs);
+
+	size_t failed = 0;
+	for (auto& job : jobs) {
+		if (job.error.empty()) continue;
+		std::cerr << std::format("{}: {}\n", job.path.string(), job.error);
+		failed++;
+	}
+	std::cerr << std::format(
+		"{} of {} graphs at {}x{} on the {} in {:.1f} ms\n",
+		jobs.size() - failed, jobs.size(), opts.width, opts.height, opts.gpu ? "gpu" : "cpu", elapsedMs(start)
+	);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/*
+ * Image files
+ * ====================================================
+ * The renders are rgba floats. The writers take them a row at a time, the
+ * top row first, so a render goes to the file a band or a tile row at a
+ * time and is never in memory whole.
+ *
+ * PNG keeps 8 bits per channel, clamped to 0..1 and not gamma corrected,
+ * the way an rgba8 output stores them. The deflate stream is stored blocks
+ * only: no compression, but no zlib either, and every row is an IDAT chunk
+ * of its own. PFM keeps the floats (rgb); its rows go bottom up, so each
+ * row is written at its place in the file.
+ */
+namespace image_file {
+
+inline uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+	static const auto table = [] {
+		std::array<uint32_t, 256> t{};
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			t[i] = c;
+		}
+		return t;
+	}();
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+inline void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+	out.push_back(uint8_t(value >> 24));
+	out.push_back(uint8_t(value >> 16));
+	out.push_back(uint8_t(value >> 8));
+	out.push_back(uint8_t(value));
+}
+
+inline void putChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+	putBigEndian(out, uint32_t(data.size()));
+	size_t start = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), data.begin(), data.end());
+	putBigEndian(out, crc32(out.data() + start, out.size() - start));
+}
+
+// an image file written a row at a time, top row first
+class RowWriter {
+public:
+	virtual ~RowWriter() = default;
+
+	// false if the file can't be created
+	virtual bool open(const std::string& path, uint32_t width, uint32_t height) = 0;
+	// width rgba pixels
+	virtual bool writeRow(const float* pixels) = 0;
+	// after the last row. False if a write failed or rows are missing
+	virtual bool finish() = 0;
+};
+
+class PngWriter : public RowWriter {
+public:
+	bool open(const std::string& path, uint32_t width, uint32_t height) override {
+		m_width = width;
+		m_height = height;
+		m_row = 0;
+		m_a = 1;
+		m_b = 0;
+
+		std::vector<uint8_t> header;
+		putBigEndian(header, width);
+		putBigEndian(header, height);
+		header.insert(header.end(), { 8, 6, 0, 0, 0 }); // 8 bits, rgba
+
+		std::vector<uint8_t> file{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		putChunk(file, "IHDR", header);
+
+		m_out.open(path, std::ios::binary);
+		return write(file);
+	}
+
+	bool writeRow(const float* pixels) override {
+		if (m_row == m_height) return false;
+
+		// the scanline, with filter type 0
+		m_raw.clear();
+		m_raw.push_back(0);
+		for (size_t i = 0; i < size_t(m_width) * 4; i++) {
+			m_raw.push_back(uint8_t(std::floor(std::clamp(pixels[i], 0.0f, 1.0f) * 255.0f + 0.5f)));
+		}
+
+		// the zlib header before the first row, stored blocks of up to 65535 bytes, adler32 after the last
+		m_zlib.clear();
+		if (m_row == 0) m_zlib.insert(m_zlib.end(), { 0x78, 0x01 });
+		bool lastRow = ++m_row == m_height;
+		size_t offset = 0;
+		do {
+			size_t size = std::min<size_t>(m_raw.size() - offset, 65535);
+			bool last = lastRow && offset + size == m_raw.size();
+			m_zlib.push_back(last ? 1 : 0);
+			m_zlib.push_back(uint8_t(size));
+			m_zlib.push_back(uint8_t(size >> 8));
+			m_zlib.push_back(uint8_t(~size));
+			m_zlib.push_back(uint8_t(~size >> 8));
+			for (size_t i = offset; i < offset + size; i++) {
+				m_zlib.push_back(m_raw[i]);
+				m_a = (m_a + m_raw[i]) % 65521;
+				m_b = (m_b + m_a) % 65521;
+			}
+			offset += size;
+		} while (offset < m_raw.size());
+		if (lastRow) putBigEndian(m_zlib, (m_b << 16) | m_a);
+
+		m_chunk.clear();
+		putChunk(m_chunk, "IDAT", m_zlib);
+		return write(m_chunk);
+	}
+
+	bool finish() override {
+		if (m_row != m_height) return false;
+		m_chunk.clear();
+		putChunk(m_chunk, "IEND", {});
+		bool ok = write(m_chunk);
+		m_out.close();
+		return ok && bool(m_out);
+	}
+
+private:
+	bool write(const std::vector<uint8_t>& bytes) {
+		m_out.write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+		return bool(m_out);
+	}
+
+	std::ofstream m_out;
+	uint32_t m_width{ 0 }, m_height{ 0 }, m_row{ 0 };
+	uint32_t m_a{ 1 }, m_b{ 0 }; // adler32
+	std::vector<uint8_t> m_raw, m_zlib, m_chunk;
+};
+
+// a negative scale is little endian
+class PfmWriter : public RowWriter {
+public:
+	bool open(const std::string& path, uint32_t width, uint32_t height) override {
+		m_width = width;
+		m_height = height;
+		m_row = 0;
+		m_rgb.resize(size_t(width) * 3);
+
+		m_out.open(path, std::ios::binary);
+		m_out << "PF\n" << width << " " << height << "\n-1.0\n";
+		m_data = m_out.tellp();
+		return bool(m_out);
+	}
+
+	bool writeRow(const float* pixels) override {
+		if (m_row == m_height) return false;
+		for (size_t x = 0; x < m_width; x++) {
+			m_rgb[x * 3 + 0] = pixels[x * 4 + 0];
+			m_rgb[x * 3 + 1] = pixels[x * 4 + 1];
+			m_rgb[x * 3 + 2] = pixels[x * 4 + 2];
+		}
+
+		// the file's rows go bottom up, the first one written is the last in the file
+		std::streamoff rowBytes = std::streamoff(m_rgb.size() * sizeof(float));
+		m_out.seekp(m_data + std::streamoff(m_height - 1 - m_row++) * rowBytes);
+		// written as the host stores them, which is little endian on every target of the app
+		m_out.write(reinterpret_cast<const char*>(m_rgb.data()), rowBytes);
+		return bool(m_out);
+	}
+
+	bool finish() override {
+		if (m_row != m_height) return false;
+		m_out.close();
+		return bool(m_out);
+	}
+
+private:
+	std::ofstream m_out;
+	std::streampos m_data{}; // where the rows start
+	uint32_t m_width{ 0 }, m_height{ 0 }, m_row{ 0 };
+	std::vector<float> m_rgb;
+};
+
+} // namespace image_file
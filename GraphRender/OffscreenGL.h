@@ -0,0 +1,151 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include <string>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include "glad/glad_wgl.h"
+#elif defined(GRAPHRENDER_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+/*
+ * Offscreen GL
+ * ====================================================
+ * A GL 4.6 core context without a window to show, for the compute passes:
+ * WGL on a hidden window on Windows, a surfaceless EGL display elsewhere
+ * (Mesa's, or any driver with EGL_KHR_surfaceless_context). The renders go
+ * to textures, there's no default framebuffer to draw to.
+ */
+class OffscreenGL {
+public:
+	OffscreenGL() = default;
+	OffscreenGL(const OffscreenGL&) = delete;
+	OffscreenGL& operator=(const OffscreenGL&) = delete;
+
+	~OffscreenGL() {
+#if defined(_WIN32)
+		if (m_context) {
+			wglMakeCurrent(m_dc, 0);
+			wglDeleteContext(m_context);
+		}
+		if (m_dc) ReleaseDC(m_window, m_dc);
+		if (m_window) DestroyWindow(m_window);
+#elif defined(GRAPHRENDER_EGL)
+		if (m_context != EGL_NO_CONTEXT) {
+			eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			eglDestroyContext(m_display, m_context);
+		}
+		if (m_display != EGL_NO_DISPLAY) eglTerminate(m_display);
+#endif
+	}
+
+	// makes the context current on this thread and loads GL. False with the reason
+	// in error if there's none to be had
+	bool create(std::string& error) {
+#if defined(_WIN32)
+		WNDCLASS wc = {
+			.style = CS_OWNDC,
+			.lpfnWndProc = DefWindowProc,
+			.hInstance = GetModuleHandle(0),
+			.lpszClassName = TEXT("GraphRender_Offscreen"),
+		};
+		RegisterClass(&wc);
+
+		m_window = CreateWindowEx(0, wc.lpszClassName, TEXT("GraphRender"), 0, 0, 0, 1, 1, 0, 0, wc.hInstance, 0);
+		if (!m_window) {
+			error = "can't create the hidden window";
+			return false;
+		}
+		m_dc = GetDC(m_window);
+
+		PIXELFORMATDESCRIPTOR pfd{};
+		pfd.nSize = sizeof(pfd);
+		pfd.nVersion = 1;
+		pfd.dwFlags = PFD_SUPPORT_OPENGL | PFD_DRAW_TO_WINDOW;
+		pfd.iPixelType = PFD_TYPE_RGBA;
+		pfd.cColorBits = 32;
+		pfd.iLayerType = PFD_MAIN_PLANE;
+		SetPixelFormat(m_dc, ChoosePixelFormat(m_dc, &pfd), &pfd);
+
+		// a legacy context first, it's what loads wglCreateContextAttribsARB
+		HGLRC legacy = wglCreateContext(m_dc);
+		wglMakeCurrent(m_dc, legacy);
+		gladLoadWGL(m_dc);
+		wglMakeCurrent(m_dc, 0);
+		wglDeleteContext(legacy);
+
+		if (!wglCreateContextAttribsARB) {
+			error = "WGL_ARB_create_context isn't supported";
+			return false;
+		}
+
+		int attribs[] = {
+			WGL_CONTEXT_MAJOR_VERSION_ARB, 4,
+			WGL_CONTEXT_MINOR_VERSION_ARB, 6,
+			0
+		};
+		m_context = wglCreateContextAttribsARB(m_dc, 0, attribs);
+		if (!m_context || !wglMakeCurrent(m_dc, m_context)) {
+			error = "no GL 4.6 context";
+			return false;
+		}
+
+		if (!gladLoadGL()) {
+			error = "can't load GL";
+			return false;
+		}
+		return true;
+#elif defined(GRAPHRENDER_EGL)
+		auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay) m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		if (m_display == EGL_NO_DISPLAY) m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+		EGLint major = 0, minor = 0;
+		if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, &major, &minor)) {
+			error = "no EGL display";
+			m_display = EGL_NO_DISPLAY;
+			return false;
+		}
+		if (!eglBindAPI(EGL_OPENGL_API)) {
+			error = "EGL can't bind desktop GL";
+			return false;
+		}
+
+		// no config and no surface, the context only renders to textures
+		const EGLint attribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, 6,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		m_context = eglCreateContext(m_display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+		if (m_context == EGL_NO_CONTEXT || !eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context)) {
+			error = std::string("no surfaceless GL 4.6 context on EGL ") + std::to_string(major) + "." + std::to_string(minor);
+			return false;
+		}
+
+		if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+			error = "can't load GL";
+			return false;
+		}
+		return true;
+#else
+		error = "built without an offscreen GL platform";
+		return false;
+#endif
+	}
+
+private:
+#if defined(_WIN32)
+	HWND m_window{ 0 };
+	HDC m_dc{ 0 };
+	HGLRC m_context{ 0 };
+#elif defined(GRAPHRENDER_EGL)
+	EGLDisplay m_display{ EGL_NO_DISPLAY };
+	EGLContext m_context{ EGL_NO_CONTEXT };
+#endif
+};
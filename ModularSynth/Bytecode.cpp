@@ -0,0 +1,366 @@
+#include "Bytecode.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
+thread_local BytecodeCompiler* BytecodeCompiler::s_current = nullptr;
+
+namespace {
+
+constexpr size_t opCount = size_t(Opcode::count);
+
+// operands of each op, a call takes as many as it was given
+constexpr uint8_t arity[opCount] = {
+	2, 2, 2, 2, 2, 2, 2, 2, 2, // add .. step
+	2, 2, 2, // comparisons
+	1, 1, 1, 1, 1, 1, 1, 1, // abs .. log2
+	3, 3, 3, 3, // mix, clamp, smoothstep, select
+	4, // call
+	4 // store
+};
+
+// per pixel, in rough ALU ops
+constexpr uint32_t opCost[opCount] = {
+	1, 1, 1, 4, 1, 1, 4, 24, 2,
+	1, 1, 1,
+	1, 2, 3, 4, 14, 14, 10, 10,
+	3, 2, 8, 1,
+	0, // the call's own
+	4
+};
+
+// the one place an op's math is written, the VM and the folding both run it
+template <Opcode op>
+inline simd::Float apply(const simd::Float* s, FusedFunction function) {
+	using namespace simd;
+
+	if constexpr (op == Opcode::add) return s[0] + s[1];
+	else if constexpr (op == Opcode::sub) return s[0] - s[1];
+	else if constexpr (op == Opcode::mul) return s[0] * s[1];
+	else if constexpr (op == Opcode::div) return s[0] / s[1];
+	else if constexpr (op == Opcode::min) return min(s[0], s[1]);
+	else if constexpr (op == Opcode::max) return max(s[0], s[1]);
+	else if constexpr (op == Opcode::mod) return mod(s[0], s[1]);
+	else if constexpr (op == Opcode::pow) return pow(s[0], s[1]);
+	else if constexpr (op == Opcode::step) return step(s[0], s[1]);
+	else if constexpr (op == Opcode::lessThan) return select(s[0] < s[1], Float(1.0f), Float(0.0f));
+	else if constexpr (op == Opcode::lessEqual) return select(s[0] <= s[1], Float(1.0f), Float(0.0f));
+	else if constexpr (op == Opcode::equal) return select(s[0] == s[1], Float(1.0f), Float(0.0f));
+	else if constexpr (op == Opcode::abs) return abs(s[0]);
+	else if constexpr (op == Opcode::floor) return floor(s[0]);
+	else if constexpr (op == Opcode::fract) return fract(s[0]);
+	else if constexpr (op == Opcode::sqrt) return sqrt(s[0]);
+	else if constexpr (op == Opcode::sin) return sin(s[0]);
+	else if constexpr (op == Opcode::cos) return cos(s[0]);
+	else if constexpr (op == Opcode::exp2) return exp2(s[0]);
+	else if constexpr (op == Opcode::log2) return log2(s[0]);
+	else if constexpr (op == Opcode::mix) return mix(s[0], s[1], s[2]);
+	else if constexpr (op == Opcode::clamp) return clamp(s[0], s[1], s[2]);
+	else if constexpr (op == Opcode::smoothstep) return smoothstep(s[0], s[1], s[2]);
+	else if constexpr (op == Opcode::select) return select(s[0] == Float(0.0f), s[2], s[1]);
+	else if constexpr (op == Opcode::call) return function(s);
+	else return s[0];
+}
+
+template <Opcode op>
+simd::Float applyOp(const simd::Float* s, FusedFunction function) {
+	return apply<op>(s, function);
+}
+
+using ApplyFn = simd::Float(*)(const simd::Float*, FusedFunction);
+
+template <size_t... I>
+constexpr std::array<ApplyFn, opCount> makeApplyTable(std::index_sequence<I...>) {
+	return { &applyOp<Opcode(I)>... };
+}
+
+constexpr auto applyTable = makeApplyTable(std::make_index_sequence<opCount>{});
+
+// a row being run
+struct Row {
+	float* registers;
+	size_t stride, batches, count;
+	float* const* targets;
+	const BytecodeProgram* program;
+};
+
+// one instruction over every batch of the row, the op is known at compile time
+template <Opcode op>
+void runOp(const Instruction& ins, const Row& row) {
+	constexpr size_t operands = arity[size_t(op)];
+	FusedFunction function = op == Opcode::call ? row.program->functions[ins.aux] : nullptr;
+
+	const float* src[4];
+	for (size_t i = 0; i < operands; i++) src[i] = row.registers + ins.src[i] * row.stride;
+	float* dst = row.registers + ins.dst * row.stride;
+
+	simd::Float s[4];
+	for (size_t b = 0; b < row.batches; b++) {
+		size_t offset = b * simd::width;
+		for (size_t i = 0; i < operands; i++) s[i] = simd::Float::load(src[i] + offset);
+		apply<op>(s, function).store(dst + offset);
+	}
+}
+
+// what the storage format keeps of the channels, then rgba per pixel. A one
+// channel target is grey, like the editor's swizzle shows it
+template <>
+void runOp<Opcode::store>(const Instruction& ins, const Row& row) {
+	StorageFormat format = row.program->targets[ins.aux].format;
+	float* out = row.targets[ins.aux];
+
+	alignas(32) float channels[4][simd::width];
+	for (size_t b = 0; b < row.batches; b++) {
+		size_t offset = b * simd::width;
+		for (size_t c = 0; c < 4; c++) {
+			simd::Float v = simd::Float::load(row.registers + ins.src[format == StorageFormat::r32f && c < 3 ? 0 : c] * row.stride + offset);
+			if (format == StorageFormat::r32f && c == 3) v = 1.0f;
+			else if (format == StorageFormat::rgba8) v = simd::floor(simd::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f) / 255.0f;
+			v.store(channels[c]);
+		}
+
+		size_t lanes = std::min(simd::width, row.count - std::min(row.count, offset));
+		for (size_t i = 0; i < lanes; i++) {
+			float* pixel = out + (offset + i) * 4;
+			pixel[0] = channels[0][i];
+			pixel[1] = channels[1][i];
+			pixel[2] = channels[2][i];
+			pixel[3] = channels[3][i];
+		}
+	}
+}
+
+using RunFn = void(*)(const Instruction&, const Row&);
+
+template <size_t... I>
+constexpr std::array<RunFn, opCount> makeRunTable(std::index_sequence<I...>) {
+	return { &runOp<Opcode(I)>... };
+}
+
+constexpr auto runTable = makeRunTable(std::make_index_sequence<opCount>{});
+
+} // namespace
+
+size_t BytecodeProgram::cost() const {
+	size_t total = 0;
+	for (auto& ins : code) {
+		total += ins.op == Opcode::call ? functionCosts[ins.aux] : opCost[size_t(ins.op)];
+	}
+	return total;
+}
+
+BytecodeCompiler::BytecodeCompiler(float width, float height) {
+	newValue(Value::input); // uvX
+	newValue(Value::input); // uvY
+	constant(0.0f);
+	constant(1.0f);
+	m_program.width = width;
+	m_program.height = height;
+}
+
+BytecodeCompiler::Reg BytecodeCompiler::newValue(Value::Kind kind, float constant) {
+	m_values.push_back({ kind, constant });
+	return Reg(m_values.size() - 1);
+}
+
+BytecodeCompiler::Reg BytecodeCompiler::constant(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	if (auto found = m_constants.find(bits); found != m_constants.end()) return found->second;
+
+	Reg reg = newValue(Value::constant, value);
+	m_constants[bits] = reg;
+	return reg;
+}
+
+BytecodeCompiler::Reg BytecodeCompiler::emit(Opcode op, Reg a, Reg b, Reg c) {
+	return record(op, 0, { a, b, c });
+}
+
+BytecodeCompiler::Reg BytecodeCompiler::call(FusedFunction function, uint32_t cost, std::initializer_list<Reg> operands) {
+	auto found = std::find(m_program.functions.begin(), m_program.functions.end(), function);
+	uint16_t index = uint16_t(std::distance(m_program.functions.begin(), found));
+	if (found == m_program.functions.end()) {
+		m_program.functions.push_back(function);
+		m_program.functionCosts.push_back(cost);
+	}
+	return record(Opcode::call, index, operands);
+}
+
+BytecodeCompiler::Reg BytecodeCompiler::record(Opcode op, uint16_t aux, std::initializer_list<Reg> operands) {
+	m_program.stats.emitted++;
+
+	Reg src[4] = { none, none, none, none };
+	size_t count = 0;
+	bool constants = true;
+	for (Reg reg : operands) {
+		if (reg == none || count == 4) continue;
+		src[count++] = reg;
+		constants = constants && isConstant(reg);
+	}
+	// an unused operand reads the zero register
+	for (size_t i = count; i < 4; i++) src[i] = zero;
+
+	if (op != Opcode::store) {
+		// the VM's math on the constants, lane 0 is as good as any
+		if (constants) {
+			simd::Float s[4];
+			for (size_t i = 0; i < 4; i++) s[i] = constantValue(src[i]);
+			alignas(32) float lanes[simd::width];
+			FusedFunction function = op == Opcode::call ? m_program.functions[aux] : nullptr;
+			applyTable[size_t(op)](s, function).store(lanes);
+			m_program.stats.folded++;
+			return constant(lanes[0]);
+		}
+
+		// a select on a known condition is one of its sides
+		if (op == Opcode::select && isConstant(src[0])) {
+			m_program.stats.folded++;
+			return constantValue(src[0]) != 0.0f ? src[1] : src[2];
+		}
+
+		// x * 1, x + 0, x - 0, x / 1
+		if ((op == Opcode::mul && src[1] == one) || ((op == Opcode::add || op == Opcode::sub) && src[1] == zero) || (op == Opcode::div && src[1] == one)) {
+			m_program.stats.folded++;
+			return src[0];
+		}
+		if ((op == Opcode::mul && src[0] == one) || (op == Opcode::add && src[0] == zero)) {
+			m_program.stats.folded++;
+			return src[1];
+		}
+
+		auto key = std::make_tuple(op, aux, src[0], src[1], src[2], src[3]);
+		if (auto found = m_numbering.find(key); found != m_numbering.end()) {
+			m_program.stats.merged++;
+			return found->second;
+		}
+
+		Reg dst = newValue(Value::computed);
+		m_code.push_back({ op, aux, dst, { src[0], src[1], src[2], src[3] } });
+		m_numbering[key] = dst;
+		return dst;
+	}
+
+	m_code.push_back({ op, aux, none, { src[0], src[1], src[2], src[3] } });
+	return none;
+}
+
+size_t BytecodeCompiler::addTarget(GraphicsNode* node, StorageFormat format) {
+	m_program.targets.push_back({ node, format });
+	return m_program.targets.size() - 1;
+}
+
+void BytecodeCompiler::store(GraphicsNode* node, Reg r, Reg g, Reg b, Reg a) {
+	auto& targets = m_program.targets;
+	for (size_t i = 0; i < targets.size(); i++) {
+		if (targets[i].node == node) record(Opcode::store, uint16_t(i), { r, g, b, a });
+	}
+}
+
+BytecodeProgram BytecodeCompiler::finish() {
+	BytecodeProgram program = std::move(m_program);
+
+	// live: the stores and what they read
+	std::vector<uint8_t> live(m_code.size(), 0), needed(m_values.size(), 0);
+	std::vector<size_t> producer(m_values.size(), size_t(-1));
+	for (size_t i = 0; i < m_code.size(); i++) {
+		if (m_code[i].dst != none) producer[m_code[i].dst] = i;
+	}
+	for (size_t i = m_code.size(); i-- > 0;) {
+		auto& ins = m_code[i];
+		if (ins.op != Opcode::store && !needed[ins.dst]) continue;
+		live[i] = 1;
+		for (Reg reg : ins.src) needed[reg] = 1;
+	}
+	program.stats.dead = size_t(std::count(live.begin(), live.end(), 0));
+
+	// inputs and constants first, they keep their registers for the whole run
+	std::vector<uint16_t> physical(m_values.size(), 0);
+	physical[uvX] = BytecodeProgram::uvX;
+	physical[uvY] = BytecodeProgram::uvY;
+	uint16_t next = BytecodeProgram::firstConstant;
+	for (Reg reg = 0; reg < m_values.size(); reg++) {
+		if (m_values[reg].kind != Value::constant || !(needed[reg] || reg == zero)) continue;
+		physical[reg] = next++;
+		program.constants.push_back(m_values[reg].value);
+	}
+
+	// the last instruction reading each value
+	std::vector<size_t> lastUse(m_values.size(), 0);
+	for (size_t i = 0; i < m_code.size(); i++) {
+		if (!live[i]) continue;
+		for (Reg reg : m_code[i].src) lastUse[reg] = i;
+	}
+
+	// a register is free again after its last reader, an op may write one it reads
+	std::vector<uint16_t> free;
+	for (size_t i = 0; i < m_code.size(); i++) {
+		if (!live[i]) continue;
+		auto& ins = m_code[i];
+
+		Instruction out{ ins.op, ins.aux };
+		for (size_t s = 0; s < 4; s++) out.src[s] = physical[ins.src[s]];
+
+		for (size_t s = 0; s < 4; s++) {
+			Reg reg = ins.src[s];
+			bool repeated = std::find(ins.src, ins.src + s, reg) != ins.src + s;
+			if (m_values[reg].kind == Value::computed && lastUse[reg] == i && !repeated) free.push_back(physical[reg]);
+		}
+
+		if (ins.dst != none) {
+			if (!free.empty()) {
+				physical[ins.dst] = free.back();
+				free.pop_back();
+			}
+			else {
+				physical[ins.dst] = next++;
+			}
+			out.dst = physical[ins.dst];
+
+			// nothing reads it, it still needs somewhere to go
+			if (lastUse[ins.dst] <= i) free.push_back(out.dst);
+		}
+		program.code.push_back(out);
+	}
+	program.registers = next;
+
+	m_code.clear();
+	m_numbering.clear();
+	return program;
+}
+
+BytecodeVM::BytecodeVM(const BytecodeProgram& program, size_t span) : m_program(program) {
+	m_stride = (std::max<size_t>(span, 1) + simd::width - 1) / simd::width * simd::width;
+	m_registers.assign(program.registers * m_stride, 0.0f);
+
+	for (size_t i = 0; i < program.constants.size(); i++) {
+		float* reg = m_registers.data() + (BytecodeProgram::firstConstant + i) * m_stride;
+		std::fill(reg, reg + m_stride, program.constants[i]);
+	}
+}
+
+void BytecodeVM::run(uint32_t x, uint32_t y, size_t count, float* const* targets) {
+	const simd::Float ramp = simd::Float::ramp();
+	std::vector<float*> chunkTargets(targets, targets + m_program.targets.size());
+
+	for (size_t done = 0; done < count; done += m_stride) {
+		size_t chunk = std::min(m_stride, count - done);
+		Row row{ m_registers.data(), m_stride, (chunk + simd::width - 1) / simd::width, chunk, chunkTargets.data(), &m_program };
+
+		// cUV, as the shaders compute it
+		float* uvX = m_registers.data() + BytecodeProgram::uvX * m_stride;
+		float* uvY = m_registers.data() + BytecodeProgram::uvY * m_stride;
+		simd::Float v = float(y) / m_program.height;
+		for (size_t b = 0; b < row.batches; b++) {
+			size_t offset = b * simd::width;
+			((ramp + float(x + done + offset)) / m_program.width).store(uvX + offset);
+			v.store(uvY + offset);
+		}
+
+		for (auto& ins : m_program.code) runTable[size_t(ins.op)](ins, row);
+
+		for (auto& target : chunkTargets) target += chunk * 4;
+	}
+}
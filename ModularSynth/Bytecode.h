@@ -0,0 +1,173 @@
+#pragma once
+
+#include "StorageFormat.h"
+#include "Simd.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <initializer_list>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+class GraphicsNode;
+
+/*
+ * Bytecode
+ * ====================================================
+ * The CPU kernels don't run per pixel. They run once per render on
+ * CpuScalars that record what they compute, and the recording is a register
+ * program the VM runs over a row of pixels at a time. An instruction loops
+ * over the whole row, so decoding it is paid once per row, not per pixel.
+ *
+ * A register holds one float per pixel of the row (structure of arrays).
+ * The first ones are the inputs (cUV) and the constants, the rest are
+ * handed out again once their last reader ran.
+ *
+ * The compiler folds an instruction whose operands are all constants, by
+ * running the VM's own code for it on them, so a folded value is the value
+ * the VM would have computed. Repeated instructions are merged and the ones
+ * no store depends on are dropped. Nodes with a tight inner loop (the noise)
+ * get a fused op: one instruction calling a function of their own, rather
+ * than hundreds of small ones.
+ */
+enum class Opcode : uint8_t {
+	add = 0,
+	sub,
+	mul,
+	div,
+	min,
+	max,
+	mod,
+	pow,
+	step,
+	lessThan, // 1.0 where it holds, 0.0 elsewhere
+	lessEqual,
+	equal,
+	abs,
+	floor,
+	fract,
+	sqrt,
+	sin,
+	cos,
+	exp2,
+	log2,
+	mix,
+	clamp,
+	smoothstep,
+	select, // b where a isn't 0, c elsewhere
+	call, // a node's fused function, up to 4 operands
+	store, // 4 channels to an output
+	count
+};
+
+// simd::width pixels of a node's fused function
+using FusedFunction = simd::Float(*)(const simd::Float* operands);
+
+struct Instruction {
+	Opcode op;
+	uint16_t aux{ 0 }; // the function of a call, the target of a store
+	uint16_t dst{ 0 };
+	uint16_t src[4]{};
+};
+
+class BytecodeProgram {
+public:
+	struct Target {
+		GraphicsNode* node;
+		StorageFormat format; // a store keeps the channels the format has
+	};
+
+	struct Stats {
+		size_t emitted{ 0 }; // instructions the kernels asked for
+		size_t folded{ 0 }, merged{ 0 }, dead{ 0 };
+	};
+
+	static constexpr uint16_t uvX = 0, uvY = 1, firstConstant = 2;
+
+	std::vector<Instruction> code;
+	std::vector<float> constants; // in the registers from firstConstant on
+	std::vector<FusedFunction> functions;
+	std::vector<uint32_t> functionCosts;
+	std::vector<Target> targets;
+	uint16_t registers{ 0 }; // inputs and constants included
+	float width{ 1.0f }, height{ 1.0f }; // the image cUV is relative to
+	Stats stats;
+
+	// per pixel, in rough ALU ops
+	size_t cost() const;
+};
+
+class BytecodeCompiler {
+public:
+	using Reg = uint32_t; // every instruction gets a new one, registers are assigned in finish()
+	static constexpr Reg none = Reg(-1);
+	static constexpr Reg uvX = 0, uvY = 1, zero = 2, one = 3;
+
+	BytecodeCompiler(float width, float height);
+
+	Reg constant(float value);
+	bool isConstant(Reg reg) const { return m_values[reg].kind == Value::constant; }
+	float constantValue(Reg reg) const { return m_values[reg].value; }
+
+	Reg emit(Opcode op, Reg a, Reg b = none, Reg c = none);
+	Reg call(FusedFunction function, uint32_t cost, std::initializer_list<Reg> operands);
+
+	size_t addTarget(GraphicsNode* node, StorageFormat format);
+	void store(GraphicsNode* node, Reg r, Reg g, Reg b, Reg a); // nodes that aren't a target are ignored
+
+	// drops the dead code and assigns the registers
+	BytecodeProgram finish();
+
+	// where CpuScalars record to, set for the thread by a Scope
+	static BytecodeCompiler& current() { return *s_current; }
+
+	class Scope {
+	public:
+		explicit Scope(BytecodeCompiler& compiler) : m_previous(s_current) { s_current = &compiler; }
+		~Scope() { s_current = m_previous; }
+	private:
+		BytecodeCompiler* m_previous;
+	};
+
+private:
+	struct Value {
+		enum Kind : uint8_t { input, constant, computed } kind;
+		float value{ 0.0f }; // of a constant
+	};
+
+	struct Recorded {
+		Opcode op;
+		uint16_t aux;
+		Reg dst;
+		Reg src[4];
+	};
+
+	std::vector<Value> m_values; // per Reg
+	std::vector<Recorded> m_code;
+	std::unordered_map<uint32_t, Reg> m_constants; // by bit pattern
+	std::map<std::tuple<Opcode, uint16_t, Reg, Reg, Reg, Reg>, Reg> m_numbering;
+	BytecodeProgram m_program;
+
+	Reg record(Opcode op, uint16_t aux, std::initializer_list<Reg> operands);
+	Reg newValue(Value::Kind kind, float constant = 0.0f);
+
+	static thread_local BytecodeCompiler* s_current;
+};
+
+// runs a program over rows. One per worker, the register file is its own
+class BytecodeVM {
+public:
+	// span is the most pixels run() gets at once
+	BytecodeVM(const BytecodeProgram& program, size_t span);
+
+	// pixels x to x + count of row y. The targets are rgba, one pointer per program
+	// target, at the pixel for x
+	void run(uint32_t x, uint32_t y, size_t count, float* const* targets);
+
+private:
+	const BytecodeProgram& m_program;
+	size_t m_stride; // floats per register, span rounded up to simd::width
+	std::vector<float> m_registers;
+};
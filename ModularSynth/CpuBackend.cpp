@@ -0,0 +1,89 @@
+#include "CpuBackend.h"
+
+#include "GraphicsNode.h"
+
+CpuValue convertValue(const CpuValue& value, ValueType from, ValueType to) {
+	if (from == to) return value;
+
+	const CpuScalar zero = 0.0f, one = 1.0f;
+	switch (to) {
+		case ValueType::scalar:
+			switch (from) {
+				case ValueType::vec2: return { value.x, zero, zero, zero };
+				case ValueType::vec3: return { rgbToFloat(value), zero, zero, zero };
+				case ValueType::vec4: return { rgbToFloat(value) * value.w, zero, zero, zero };
+				default: break;
+			}
+			break;
+		case ValueType::vec2:
+			switch (from) {
+				case ValueType::scalar: return { value.x, one, zero, zero };
+				case ValueType::vec3: return { rgbToFloat(value), one, zero, zero };
+				case ValueType::vec4: return { value.x * value.w, value.y * value.w, zero, zero };
+				default: break;
+			}
+			break;
+		case ValueType::vec3:
+			switch (from) {
+				case ValueType::scalar: return { value.x, value.x, value.x, zero };
+				case ValueType::vec2: return { value.x, value.y, zero, zero };
+				case ValueType::vec4: return { value.x, value.y, value.z, zero };
+				default: break;
+			}
+			break;
+		case ValueType::vec4:
+			switch (from) {
+				case ValueType::scalar: return { value.x, value.x, value.x, one };
+				case ValueType::vec2: return { value.x, value.y, zero, one };
+				case ValueType::vec3: return { value.x, value.y, value.z, one };
+				default: break;
+			}
+			break;
+		default: break;
+	}
+	return value;
+}
+
+GraphicsNode* CpuProgram::compile(const CpuInputs& inputs, CpuValue* result) const {
+	std::vector<CpuValue> frame(slots);
+
+	for (auto& step : steps) {
+		CpuArgs args{ step, inputs, frame };
+		if (!step.node->evaluate(args)) return step.node;
+		if (args.m_failed) return args.m_failed;
+	}
+
+	if (result) {
+		*result = returnsValue ? convertValue(frame[resultSlot], resultType, ValueType::vec4) : CpuValue{};
+	}
+	return nullptr;
+}
+
+CpuValue CpuArgs::get(size_t index) const {
+	if (index >= m_step.arguments.size()) return {};
+
+	auto& argument = m_step.arguments[index];
+	CpuValue value;
+	switch (argument.kind) {
+		case CpuProgram::Argument::source: value = m_frame[argument.slot]; break;
+		case CpuProgram::Argument::uv: value = m_inputs.uv; break;
+		default: {
+			auto& raw = argument.value;
+			value = { raw[0], raw[1], raw[2], raw[3] };
+			break;
+		}
+	}
+
+	if (argument.via == ValueType::none) return convertValue(value, argument.from, argument.to);
+	return convertValue(convertValue(value, argument.from, argument.via), argument.via, argument.to);
+}
+
+CpuValue CpuArgs::sample(const CpuValue& uv) const {
+	CpuValue result{};
+	if (!m_step.subtree) return result;
+
+	CpuInputs inputs = m_inputs;
+	inputs.uv = uv;
+	if (GraphicsNode* failed = m_step.subtree->compile(inputs, &result)) m_failed = failed;
+	return result;
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include "NodeGraph.h"
+#include "StorageFormat.h"
+#include "Bytecode.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+class GraphicsNode;
+
+/*
+ * CPU backend
+ * ====================================================
+ * Runs the node graph without a GPU. A node's evaluate() is its GLSL
+ * function written on CpuScalars: it reads its arguments from CpuArgs and
+ * sets its outputs. The graph turns the nodes into a CpuProgram the way
+ * solveFor turns them into GLSL, with every argument resolved up front
+ * (connected output, param, cUV, texture coords or zero).
+ *
+ * The kernels run once, when compiling. A CpuScalar is a register of the
+ * bytecode (see Bytecode.h) and its operators record instructions, so the
+ * program comes out as one flat list the VM runs over whole rows. The
+ * params are constants then, what only depends on them is folded away.
+ *
+ * Multipass nodes compile their input subtree per sample, like the inlined
+ * pass mode. Nodes that read textures have no kernel.
+ *
+ * Tolerance, against the GLSL path:
+ * - 1e-4 absolute for the analytic nodes (gradients, shapes, mix, UV,
+ *   threshold, normal map), away from discontinuities: a pixel sitting on a
+ *   step, a clamp edge or a fract() wrap can land on either side of it
+ * - the noise's integer hash (IntHash.h) gives the GPU's bits, what's left
+ *   is its pow: 1e-5. The sine hash, fract(sin(q) * 43758.5453), is only as
+ *   close as the GPU's sin at arguments in the hundreds: 1e-2 against Mesa's,
+ *   but drivers differ there by more than the result's whole range. A build
+ *   that fuses the hash's a * b + c into an FMA (GCC with -mfma) moves it as
+ *   much
+ * - an output gets the channels its storage format keeps, and rgba8 is
+ *   quantized
+ * - r32f comes out grey, (r, r, r, 1), on both paths
+ * - rgba16f outputs keep full floats, 2^-11 relative off the GPU's
+ * - a multipass node always samples its subtree directly, a split pass reads
+ *   it back at whole pixels and clamps at the edges, so the edges differ
+ */
+
+// a float per pixel, while compiling. Only valid inside a BytecodeCompiler::Scope
+class CpuScalar {
+public:
+	using Reg = BytecodeCompiler::Reg;
+
+	CpuScalar() : m_reg(BytecodeCompiler::zero) {}
+	CpuScalar(float value) : m_reg(BytecodeCompiler::current().constant(value)) {}
+	explicit CpuScalar(Reg reg) : m_reg(reg) {}
+
+	Reg reg() const { return m_reg; }
+
+	CpuScalar& operator+=(CpuScalar b);
+	CpuScalar& operator-=(CpuScalar b);
+	CpuScalar& operator*=(CpuScalar b);
+	CpuScalar& operator/=(CpuScalar b);
+
+private:
+	Reg m_reg;
+};
+
+namespace cpu_detail {
+	inline CpuScalar emit(Opcode op, CpuScalar a, CpuScalar b = {}, CpuScalar c = {}) {
+		return CpuScalar{ BytecodeCompiler::current().emit(op, a.reg(), b.reg(), c.reg()) };
+	}
+}
+
+inline CpuScalar operator+(CpuScalar a, CpuScalar b) { return cpu_detail::emit(Opcode::add, a, b); }
+inline CpuScalar operator-(CpuScalar a, CpuScalar b) { return cpu_detail::emit(Opcode::sub, a, b); }
+inline CpuScalar operator*(CpuScalar a, CpuScalar b) { return cpu_detail::emit(Opcode::mul, a, b); }
+inline CpuScalar operator/(CpuScalar a, CpuScalar b) { return cpu_detail::emit(Opcode::div, a, b); }
+inline CpuScalar operator-(CpuScalar a) { return CpuScalar(0.0f) - a; }
+
+inline CpuScalar& CpuScalar::operator+=(CpuScalar b) { return *this = *this + b; }
+inline CpuScalar& CpuScalar::operator-=(CpuScalar b) { return *this = *this - b; }
+inline CpuScalar& CpuScalar::operator*=(CpuScalar b) { return *this = *this * b; }
+inline CpuScalar& CpuScalar::operator/=(CpuScalar b) { return *this = *this / b; }
+
+// 1.0 where it holds, 0.0 elsewhere, for select()
+inline CpuScalar operator<(CpuScalar a, CpuScalar b) { return cpu_detail::emit(Opcode::lessThan, a, b); }
+inline CpuScalar operator<=(CpuScalar a, CpuScalar b) { return cpu_detail::emit(Opcode::lessEqual, a, b); }
+inline CpuScalar operator>(CpuScalar a, CpuScalar b) { return b < a; }
+inline CpuScalar operator>=(CpuScalar a, CpuScalar b) { return b <= a; }
+inline CpuScalar equal(CpuScalar a, CpuScalar b) { return cpu_detail::emit(Opcode::equal, a, b); }
+
+inline CpuScalar abs(CpuScalar x) { return cpu_detail::emit(Opcode::abs, x); }
+inline CpuScalar floor(CpuScalar x) { return cpu_detail::emit(Opcode::floor, x); }
+inline CpuScalar fract(CpuScalar x) { return cpu_detail::emit(Opcode::fract, x); }
+inline CpuScalar sqrt(CpuScalar x) { return cpu_detail::emit(Opcode::sqrt, x); }
+inline CpuScalar sin(CpuScalar x) { return cpu_detail::emit(Opcode::sin, x); }
+inline CpuScalar cos(CpuScalar x) { return cpu_detail::emit(Opcode::cos, x); }
+inline CpuScalar exp2(CpuScalar x) { return cpu_detail::emit(Opcode::exp2, x); }
+inline CpuScalar log2(CpuScalar x) { return cpu_detail::emit(Opcode::log2, x); }
+inline CpuScalar pow(CpuScalar x, CpuScalar y) { return cpu_detail::emit(Opcode::pow, x, y); }
+inline CpuScalar mod(CpuScalar x, CpuScalar y) { return cpu_detail::emit(Opcode::mod, x, y); }
+inline CpuScalar min(CpuScalar a, CpuScalar b) { return cpu_detail::emit(Opcode::min, a, b); }
+inline CpuScalar max(CpuScalar a, CpuScalar b) { return cpu_detail::emit(Opcode::max, a, b); }
+inline CpuScalar step(CpuScalar edge, CpuScalar x) { return cpu_detail::emit(Opcode::step, edge, x); }
+inline CpuScalar mix(CpuScalar a, CpuScalar b, CpuScalar t) { return cpu_detail::emit(Opcode::mix, a, b, t); }
+inline CpuScalar clamp(CpuScalar x, CpuScalar lo, CpuScalar hi) { return cpu_detail::emit(Opcode::clamp, x, lo, hi); }
+inline CpuScalar smoothstep(CpuScalar e0, CpuScalar e1, CpuScalar x) { return cpu_detail::emit(Opcode::smoothstep, e0, e1, x); }
+
+// a where condition isn't 0, b elsewhere
+inline CpuScalar select(CpuScalar condition, CpuScalar a, CpuScalar b) { return cpu_detail::emit(Opcode::select, condition, a, b); }
+
+// one instruction running a function of the node's own on up to 4 operands.
+// cost is per pixel, in the units of BytecodeProgram::cost
+inline CpuScalar fused(FusedFunction function, uint32_t cost, std::initializer_list<CpuScalar> operands) {
+	BytecodeCompiler::Reg regs[4] = { BytecodeCompiler::none, BytecodeCompiler::none, BytecodeCompiler::none, BytecodeCompiler::none };
+	size_t count = 0;
+	for (auto& operand : operands) {
+		if (count < 4) regs[count++] = operand.reg();
+	}
+	return CpuScalar{ BytecodeCompiler::current().call(function, cost, { regs[0], regs[1], regs[2], regs[3] }) };
+}
+
+// a vec4 per pixel, narrower types leave the rest unused
+struct CpuValue {
+	CpuScalar x, y, z, w;
+};
+
+// the conversions ShaderGen::convertType emits
+CpuValue convertValue(const CpuValue& value, ValueType from, ValueType to);
+
+inline CpuScalar rgbToFloat(const CpuValue& color) {
+	return color.x * 0.2126f + color.y * 0.7152f + color.z * 0.0722f;
+}
+
+// what the kernels compile against
+struct CpuInputs {
+	CpuValue uv; // cUV
+	CpuScalar width, height; // bOutputSize
+};
+
+class CpuProgram {
+public:
+	// where an argument of the node's function comes from, decided when building
+	struct Argument {
+		enum Kind : uint8_t {
+			constant = 0, // a param or a default
+			source, // the output of an earlier step
+			uv // cUV
+		} kind{ constant };
+
+		size_t slot{ 0 }; // of a source
+		ValueType from{ ValueType::vec2 }, via{ ValueType::none }, to{ ValueType::vec2 };
+		RawValue value{}; // of a constant, as from
+	};
+
+	struct Step {
+		GraphicsNode* node{ nullptr };
+		std::vector<Argument> arguments; // the function's in parameters, in order
+		std::vector<uint32_t> variants; // of the specialization params, in the order they were added
+		size_t slot{ 0 }; // of the first output in the frame
+		std::unique_ptr<CpuProgram> subtree; // what a multipass node samples
+	};
+
+	std::vector<Step> steps; // path order
+	size_t slots{ 0 };
+
+	// tree_() returns the first output of the last step, as a vec4
+	bool returnsValue{ false };
+	size_t resultSlot{ 0 };
+	ValueType resultType{ ValueType::vec4 };
+
+	// runs the kernels into the current compiler. Returns the node without
+	// a kernel, or null
+	GraphicsNode* compile(const CpuInputs& inputs, CpuValue* result = nullptr) const;
+};
+
+// what a node's kernel sees
+class CpuArgs {
+public:
+	CpuArgs(const CpuProgram::Step& step, const CpuInputs& inputs, std::vector<CpuValue>& frame)
+		: m_step(step), m_inputs(inputs), m_frame(frame) {}
+
+	// the index-th in parameter of the GLSL function, as the parameter's type
+	CpuValue get(size_t index) const;
+	CpuScalar scalar(size_t index) const { return get(index).x; }
+
+	// a specialization param, its value picks the variant
+	uint32_t variant(size_t index = 0) const {
+		return index < m_step.variants.size() ? m_step.variants[index] : 0;
+	}
+
+	const CpuValue& uv() const { return m_inputs.uv; } // cUV
+	CpuScalar width() const { return m_inputs.width; } // bOutputSize
+	CpuScalar height() const { return m_inputs.height; }
+
+	// the output as its port type
+	void set(size_t output, const CpuValue& value) { m_frame[m_step.slot + output] = value; }
+
+	// $TREE(uv), the input subtree of a multipass node, compiled in place for this uv
+	CpuValue sample(const CpuValue& uv) const;
+
+	// an output node writes its pixels
+	void emit(const CpuValue& color) const {
+		BytecodeCompiler::current().store(m_step.node, color.x.reg(), color.y.reg(), color.z.reg(), color.w.reg());
+	}
+
+private:
+	const CpuProgram::Step& m_step;
+	const CpuInputs& m_inputs;
+	std::vector<CpuValue>& m_frame;
+
+	// set by compile when a subtree's kernel is missing
+	mutable GraphicsNode* m_failed{ nullptr };
+	friend class CpuProgram;
+};
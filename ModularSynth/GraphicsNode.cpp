@@ -1,5 +1,6 @@
 #include "GraphicsNode.h"
 
+#include <cmath>
 #include <format>
 #include <ranges>
 #include <string_view>
@@ -7,6 +8,8 @@
 #include <iostream>
 #include <fstream>
 #include <functional>
+#include <typeindex>
+#include <unordered_map>
 
 // From https://helloacm.com/convert-a-string-to-camel-case-format-in-c/#:~:text=How%20to%20Convert%20a%20String%20into%20Camel%20Case%20in%20C%2B%2B%3F&text=function,end()%2C%20data.
 std::string toCamelCase(const std::string& text) {
@@ -37,15 +40,70 @@ std::string toCamelCase(const std::string& text) {
 	return ans;
 }
 
-void GraphicsNode::addParam(const std::string& name, ValueType type) {
-	m_params[name] = {
-		.value = RawValue(),
-		.type = type
-	};
+void GraphicsNode::addParam(Symbol name, ValueType type) {
+	NodeValue& param = paramRef(name);
+	param.value = RawValue();
+	param.type = type;
+}
+
+void GraphicsNode::addSpecializationParam(Symbol name, uint32_t variants) {
+	addParam(name, ValueType::scalar);
+	for (auto&& param : m_params) {
+		if (param.name == name) param.variants = std::max(variants, 1u);
+	}
+}
+
+uint32_t GraphicsNode::variant(Symbol name) const {
+	auto param = findParam(name);
+	if (!param || param->variants == 0) return 0;
+
+	float value = std::round(param->value.value[0]);
+	return uint32_t(std::clamp(value, 0.0f, float(param->variants - 1)));
+}
+
+void GraphicsNode::setParamFormat(Symbol name, StorageFormat format) {
+	for (auto&& param : m_params) {
+		if (param.name == name) {
+			param.format = format;
+			invalidateStructure();
+			return;
+		}
+	}
+}
+
+NodeValue& GraphicsNode::paramRef(Symbol name) {
+	for (auto&& param : m_params) {
+		if (param.name == name) return param.value;
+	}
+
+	m_params.push_back({
+		.name = name,
+		.key = toCamelCase(name.str())
+	});
+	return m_params.back().value;
+}
+
+void GraphicsNode::paramChanged(Symbol name) {
+	auto param = findParam(name);
+	if (param && param->variants > 0) invalidateStructure();
+	else invalidate();
 }
 
 void GraphicsNode::setup() {
 	onCreate();
+	m_bindings = parameters();
+}
+
+const ShaderLibrary& GraphicsNode::parsedLibrary() {
+	if (m_parsedLibrary) return *m_parsedLibrary;
+
+	// not thread safe, codegen runs on the main thread
+	static std::unordered_map<std::type_index, std::unique_ptr<const ShaderLibrary>> libraries;
+
+	auto& lib = libraries[typeid(*this)];
+	if (!lib) lib = std::make_unique<const ShaderLibrary>(ShaderGen::parseLib(library()));
+	m_parsedLibrary = lib.get();
+	return *m_parsedLibrary;
 }
 
 NodeValue GraphicsNode::solve() {
@@ -1,12 +1,16 @@
 #pragma once
 
 #include "NodeGraph.h"
+#include "ShaderGen.h"
 
 #include "olcUTIL_DataFile.h"
 
 #include <memory>
 #include <algorithm>
 #include <map>
+#include <optional>
+
+class CpuArgs;
 
 constexpr uint32_t previewSize = 128;
 
@@ -18,70 +22,118 @@ enum class SpecialType : uint8_t {
 	// TODO: add more as needed
 };
 
-using GraphicsNodeParams = std::map<std::string, std::pair<std::string, SpecialType>>;
+// function parameter -> (node input or param, special type)
+using GraphicsNodeParams = std::map<Symbol, std::pair<Symbol, SpecialType>>;
+
+struct GraphicsNodeParam {
+	Symbol name;
+	Symbol key; // camel case name, for uniforms and files
+	NodeValue value;
+	StorageFormat format{ StorageFormat::rgba32f }; // of the texture an image param holds
+	uint32_t variants{ 0 }; // not 0 for a specialization param, the values it takes
+};
 
 class GraphicsNode : public Node {
 public:
 	virtual std::string functionName() = 0;
 	virtual std::string library() = 0;
 	virtual bool multiPassNode() { return false; }
+	virtual uint32_t sampleRadius() { return 1; } // how many pixels away a multipass node samples its input
+	virtual bool outputNode() { return false; } // writes to an output image
+	virtual std::optional<StorageFormat> requestedFormat() { return std::nullopt; } // of the output image, none lets the graph pick
 	virtual GraphicsNodeParams parameters() = 0;
-	virtual bool render(uint32_t width, uint32_t height, size_t binding = 0) { return false; }
+	virtual bool render(uint32_t width, uint32_t height, size_t binding = 0, StorageFormat format = StorageFormat::rgba32f) { return false; }
+
+	// the node's function on the CPU, for a batch of pixels (see CpuBackend.h).
+	// False if the node has none, it only runs on the GPU then
+	virtual bool evaluate(CpuArgs& args) { return false; }
 
 	virtual void onCreate() = 0;
 
 	void setup() override final;
 	virtual NodeValue solve();
 
-	void addParam(const std::string& name, ValueType type);
+	// parameters() resolved once on setup
+	const GraphicsNodeParams& bindings() const { return m_bindings; }
+
+	// library() parsed once per node type and shared by all instances, so it
+	// has to be the same for all of them, per node bits go in placeholders
+	const ShaderLibrary& parsedLibrary();
+
+	void addParam(Symbol name, ValueType type);
+
+	// an enum like scalar that picks a code path, like a blend mode. It's compiled
+	// in rather than read per pixel, every value is a program of its own, so
+	// it's for values that change between renders, not during them
+	void addSpecializationParam(Symbol name, uint32_t variants);
+
+	// a specialization param's value as an index below its variant count
+	uint32_t variant(Symbol name) const;
 
-	const NodeValue& param(const std::string& name) { return m_params[name]; }
-	RawValue& paramValue(const std::string& name) { return m_params[name].value; }
+	const NodeValue& param(Symbol name) { return paramRef(name); }
+	RawValue& paramValue(Symbol name) { return paramRef(name).value; }
 
-	void setParam(const std::string& name, const RawValue& value) { m_params[name].value = value; m_changed = true; }
-	void setParam(const std::string& name, float v) { m_params[name].value[0] = v; m_changed = true; }
-	void setParam(const std::string& name, float x, float y) {
-		m_params[name].value[0] = x;
-		m_params[name].value[1] = y;
-		m_changed = true;
+	void setParam(Symbol name, const RawValue& value) { paramRef(name).value = value; paramChanged(name); }
+	void setParam(Symbol name, float v) { paramRef(name).value[0] = v; paramChanged(name); }
+	void setParam(Symbol name, float x, float y) {
+		auto& value = paramRef(name).value;
+		value[0] = x;
+		value[1] = y;
+		paramChanged(name);
 	}
-	void setParam(const std::string& name, float x, float y, float z) {
-		m_params[name].value[0] = x;
-		m_params[name].value[1] = y;
-		m_params[name].value[2] = z;
-		m_changed = true;
+	void setParam(Symbol name, float x, float y, float z) {
+		auto& value = paramRef(name).value;
+		value[0] = x;
+		value[1] = y;
+		value[2] = z;
+		paramChanged(name);
 	}
-	void setParam(const std::string& name, float x, float y, float z, float w) {
-		m_params[name].value[0] = x;
-		m_params[name].value[1] = y;
-		m_params[name].value[2] = z;
-		m_params[name].value[3] = w;
-		m_changed = true;
+	void setParam(Symbol name, float x, float y, float z, float w) {
+		auto& value = paramRef(name).value;
+		value[0] = x;
+		value[1] = y;
+		value[2] = z;
+		value[3] = w;
+		paramChanged(name);
 	}
-	void setParam(const std::string& name, size_t index, float v) { m_params[name].value[index] = v; m_changed = true; }
+	void setParam(Symbol name, size_t index, float v) { paramRef(name).value[index] = v; paramChanged(name); }
 
-	bool hasParam(const std::string& name) { return m_params.find(name) != m_params.end(); }
+	// the format of the texture an image param is set to, it's part of the generated code
+	void setParamFormat(Symbol name, StorageFormat format);
 
-	const std::map<std::string, NodeValue>& params() { return m_params; }
+	bool hasParam(Symbol name) const { return findParam(name) != nullptr; }
+
+	const GraphicsNodeParam* findParam(Symbol name) const {
+		for (auto&& param : m_params) {
+			if (param.name == name) return &param;
+		}
+		return nullptr;
+	}
+
+	const std::vector<GraphicsNodeParam>& params() const { return m_params; }
+
+	// an edit since the last solve changed the generated code (a variant, a
+	// format), not just values. The graph clears it when it compiles
+	bool structureChanged() const { return m_structureChanged; }
+	void clearStructureChanged() { m_structureChanged = false; }
 
 	virtual void saveTo(olc::utils::datafile& df) {
 		df["id"].SetInt(m_id);
-		for (auto& [pName, pData] : m_params) {
-			auto cName = toCamelCase(pName);
-			df[cName].SetReal(pData.value[0], 0);
-			df[cName].SetReal(pData.value[1], 1);
-			df[cName].SetReal(pData.value[2], 2);
-			df[cName].SetReal(pData.value[3], 3);
+		for (auto& param : m_params) {
+			auto& prop = df[param.key.str()];
+			prop.SetReal(param.value.value[0], 0);
+			prop.SetReal(param.value.value[1], 1);
+			prop.SetReal(param.value.value[2], 2);
+			prop.SetReal(param.value.value[3], 3);
 		}
 	}
 
+	// the saved "id" is only a reference for the saved connections,
+	// the graph assigns a fresh id on creation
 	virtual void loadFrom(olc::utils::datafile& df) {
-		m_id = df["id"].GetInt();
-		NodeGraph::g_NodeID = std::max(m_id, NodeGraph::g_NodeID);
-
-		for (auto& [pName, pData] : m_params) {
-			auto& prop = df[toCamelCase(pName)];
-			pData.value = {
+		for (auto& param : m_params) {
+			auto& prop = df[param.key.str()];
+			param.value.value = {
 				float(prop.GetReal(0)),
 				float(prop.GetReal(1)),
 				float(prop.GetReal(2)),
@@ -91,5 +143,20 @@ public:
 	}
 
 protected:
-	std::map<std::string, NodeValue> m_params;
+	std::vector<GraphicsNodeParam> m_params; // in the order they were added
+	GraphicsNodeParams m_bindings;
+	const ShaderLibrary* m_parsedLibrary{ nullptr };
+	bool m_structureChanged{ false };
+
+	// adds the param if it doesn't exist yet
+	NodeValue& paramRef(Symbol name);
+
+	// invalidate() for edits that need a new program
+	void invalidateStructure() {
+		m_structureChanged = true;
+		invalidate();
+	}
+
+	// a specialization param's value picks the code, the rest are uniforms
+	void paramChanged(Symbol name);
 };
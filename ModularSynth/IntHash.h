@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Simd.h"
+
+#include <cstdint>
+
+/*
+ * Integer hashes
+ * ====================================================
+ * The CPU side of the hashes in the shader template (ShaderGen.h): xxhash32
+ * of two words and pcg3d (Jarzynski and Olano, "Hash Functions for GPU
+ * Rendering"). They only use wrapping integer math, so the CPU lanes and the
+ * GPU get the same bits, where fract(sin(x) * 43758.5453) depends on the
+ * precision of each sin. Noise nodes that want matching renders use these
+ * in their GLSL and in their CPU kernels.
+ *
+ * The templates take uint32_t or simd::Int. The lanes are signed and their
+ * >> is arithmetic, so every right shift is masked back to a logical one.
+ *
+ * A cell is a floor()ed coordinate as an integer, negative ones wrap like
+ * GLSL's uint(int). The unit floats keep the top 24 bits, exact as floats.
+ *
+ *   GLSL                       C++
+ *   uint xxhash32(uvec2)       xxhash32(x, y)
+ *   uvec3 pcg3d(uvec3)         pcg3d(x, y, z)
+ *   float irand(vec2 cell)     rand(x, y)
+ *   vec3 ihash3(vec2 cell)     hash3(x, y, out)
+ */
+namespace int_hash {
+
+constexpr uint32_t prime2 = 2246822519u, prime3 = 3266489917u, prime4 = 668265263u, prime5 = 374761393u;
+
+// logical, whichever T
+template<typename T>
+inline T shiftRight(T h, int n) {
+	return (h >> n) & T(int32_t(0xFFFFFFFFu >> n));
+}
+
+template<typename T>
+inline T rotateLeft(T h, int n) {
+	return (h << n) | shiftRight(h, 32 - n);
+}
+
+// XXH32 of the 8 bytes of x and y (little endian), seed 0
+template<typename T>
+inline T xxhash32(T x, T y) {
+	T h = T(int32_t(prime5 + 8));
+	h = rotateLeft(h + x * T(int32_t(prime3)), 17) * T(int32_t(prime4));
+	h = rotateLeft(h + y * T(int32_t(prime3)), 17) * T(int32_t(prime4));
+	h = h ^ shiftRight(h, 15);
+	h = h * T(int32_t(prime2));
+	h = h ^ shiftRight(h, 13);
+	h = h * T(int32_t(prime3));
+	return h ^ shiftRight(h, 16);
+}
+
+template<typename T>
+inline void pcg3d(T& x, T& y, T& z) {
+	x = x * T(1664525) + T(1013904223);
+	y = y * T(1664525) + T(1013904223);
+	z = z * T(1664525) + T(1013904223);
+	x += y * z; y += z * x; z += x * y;
+	x ^= shiftRight(x, 16);
+	y ^= shiftRight(y, 16);
+	z ^= shiftRight(z, 16);
+	x += y * z; y += z * x; z += x * y;
+}
+
+// the top 24 bits, in [0, 1)
+inline float toUnit(uint32_t h) {
+	return float(h >> 8) * (1.0f / 16777216.0f);
+}
+
+inline simd::Float toUnit(simd::Int h) {
+	return simd::toFloat(shiftRight(h, 8)) * (1.0f / 16777216.0f);
+}
+
+inline float rand(int32_t x, int32_t y) {
+	return toUnit(xxhash32(uint32_t(x), uint32_t(y)));
+}
+
+inline simd::Float rand(simd::Int x, simd::Int y) {
+	return toUnit(xxhash32(x, y));
+}
+
+inline void hash3(int32_t x, int32_t y, float out[3]) {
+	uint32_t hx = uint32_t(x), hy = uint32_t(y), hz = 0;
+	pcg3d(hx, hy, hz);
+	out[0] = toUnit(hx);
+	out[1] = toUnit(hy);
+	out[2] = toUnit(hz);
+}
+
+inline void hash3(simd::Int x, simd::Int y, simd::Float out[3]) {
+	simd::Int z = 0;
+	pcg3d(x, y, z);
+	out[0] = toUnit(x);
+	out[1] = toUnit(y);
+	out[2] = toUnit(z);
+}
+
+} // namespace int_hash
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+
+// Map with a fixed capacity, inserting past it drops the least recently used entry
+template <typename Key, typename Value>
+class LruCache {
+public:
+	explicit LruCache(size_t capacity) : m_capacity(std::max<size_t>(capacity, 1)) {}
+
+	// counts as a use
+	Value* find(const Key& key) {
+		auto pos = m_index.find(key);
+		if (pos == m_index.end()) return nullptr;
+
+		m_items.splice(m_items.begin(), m_items, pos->second);
+		return &pos->second->second;
+	}
+
+	bool contains(const Key& key) const { return m_index.find(key) != m_index.end(); }
+
+	Value& insert(const Key& key, Value value) {
+		if (auto existing = find(key)) {
+			*existing = std::move(value);
+			return *existing;
+		}
+
+		m_items.emplace_front(key, std::move(value));
+		m_index[key] = m_items.begin();
+		evict();
+		return m_items.front().second;
+	}
+
+	void erase(const Key& key) {
+		auto pos = m_index.find(key);
+		if (pos == m_index.end()) return;
+
+		m_items.erase(pos->second);
+		m_index.erase(pos);
+	}
+
+	void clear() {
+		m_items.clear();
+		m_index.clear();
+	}
+
+	void setCapacity(size_t capacity) {
+		m_capacity = std::max<size_t>(capacity, 1);
+		evict();
+	}
+
+	size_t capacity() const { return m_capacity; }
+	size_t size() const { return m_items.size(); }
+
+private:
+	using Item = std::pair<Key, Value>;
+
+	size_t m_capacity;
+	std::list<Item> m_items; // most recently used first
+	std::unordered_map<Key, typename std::list<Item>::iterator> m_index;
+
+	void evict() {
+		while (m_items.size() > m_capacity) {
+			m_index.erase(m_items.back().first);
+			m_items.pop_back();
+		}
+	}
+};
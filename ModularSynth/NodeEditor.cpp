@@ -2,8 +2,6 @@
 
 #include <iostream>
 
-size_t NodeEditor::g_NodeID = 1;
-
 constexpr float titleFontSize = 15.0f;
 constexpr float bodyTextFontSize = 12.0f;
 constexpr int gapBetweenSides = 32;
@@ -242,7 +240,7 @@ void NodeEditor::onMouseDown(int button, int x, int y) {
 						if (node->node()->input(i).connected) 
 						{
 							auto connections = getConnectionsTo(node);
-							VisualConnection connection = { nullptr, nullptr, -1, -1 };
+							VisualConnection connection = { nullptr, nullptr, size_t(-1), size_t(-1) };
 							for (auto c : connections) {
 								if(c.destinationInput == i) {
 									connection = c;
@@ -337,7 +335,8 @@ void NodeEditor::onMouseUp(int button, int x, int y) {
 
 std::vector<VisualConnection> NodeEditor::getConnectionsTo(VisualNode* node) {
 	std::vector<VisualConnection> ret;
-	for (auto&& conn : m_connections) {
+	for (size_t link : node->m_links) {
+		const VisualConnection conn = m_connections[link];
 		if (conn.destination != node) continue;
 		ret.push_back(conn);
 
@@ -349,7 +348,8 @@ std::vector<VisualConnection> NodeEditor::getConnectionsTo(VisualNode* node) {
 
 std::vector<VisualConnection> NodeEditor::getConnectionsFrom(VisualNode* node) {
 	std::vector<VisualConnection> ret;
-	for (auto&& conn : m_connections) {
+	for (size_t link : node->m_links) {
+		const VisualConnection conn = m_connections[link];
 		if (conn.source != node) continue;
 		ret.push_back(conn);
 
@@ -404,6 +404,10 @@ bool NodeEditor::onKeyPress(int key) {
 		m_shiftPressed = true;
 		return true;
 	}
+	if (key == VK_DELETE && m_selectedNode) {
+		remove(get(m_selectedNode));
+		return true;
+	}
 	return false;
 }
 
@@ -655,22 +659,104 @@ void NodeEditor::connect(VisualNode* source, size_t sourceOutput, VisualNode* de
 	};
 
 	if(m_graph->connect(source->node(), sourceOutput, destination->node(), destinationInput)) {
-		m_connections.push_back(conn);
-		m_graph->solve();
+		addLink(conn);
+		if (!m_graph->inTransaction()) m_graph->solve();
 	}
 }
 
 void NodeEditor::removeConnection(VisualNode* source, size_t sourceOutput, VisualNode* destination, size_t destinationInput) {
-	auto pos = std::find_if(m_connections.begin(), m_connections.end(), [=](const VisualConnection& cn) {
+	auto& links = destination->m_links;
+	auto pos = std::find_if(links.begin(), links.end(), [=](size_t link) {
+		const VisualConnection& cn = m_connections[link];
 		return cn.destination == destination &&
 			cn.destinationInput == destinationInput &&
 			cn.source == source &&
 			cn.sourceOutput == sourceOutput;
 		});
-	if (pos == m_connections.end()) return;
-	m_connections.erase(pos);
+	if (pos == links.end()) return;
+	eraseLink(*pos);
 	m_graph->removeConnection(source->node(), sourceOutput, destination->node(), destinationInput);
-	m_graph->solve();
+	if (!m_graph->inTransaction()) m_graph->solve();
+}
+
+void NodeEditor::remove(VisualNode* node) {
+	if (!node || get(node->id()) != node) return;
+
+	if (onRemove) onRemove(node);
+
+	while (!node->m_links.empty()) eraseLink(node->m_links.back());
+
+	if (m_selectedNode == node->id()) {
+		m_selectedNode = 0;
+		m_state = NodeEditorState::idling;
+	}
+
+	m_visualIds.erase(node->node()->id());
+	m_graph->remove(node->node());
+	m_nodes.erase(node->id());
+
+	if (!m_graph->inTransaction()) {
+		rebuildDrawOrder();
+		m_graph->solve();
+	}
+}
+
+void NodeEditor::beginTransaction() {
+	m_graph->beginTransaction();
+}
+
+void NodeEditor::commitTransaction() {
+	if (!m_graph->inTransaction()) return;
+
+	if (!m_graph->commitTransaction()) {
+		// drop the links the graph rejected
+		std::erase_if(m_connections, [&](const VisualConnection& cn) {
+			auto conns = m_graph->getConnectionsToInput(cn.destination->node(), cn.destinationInput);
+			return conns.empty() || conns.front().source != cn.source->node();
+		});
+		rebuildLinks();
+	}
+
+	if (!m_graph->inTransaction()) {
+		rebuildDrawOrder();
+		m_graph->solve();
+	}
+}
+
+void NodeEditor::addLink(const VisualConnection& conn) {
+	size_t index = m_connections.size();
+	m_connections.push_back(conn);
+	conn.source->m_links.push_back(index);
+	if (conn.destination != conn.source) conn.destination->m_links.push_back(index);
+}
+
+void NodeEditor::eraseLink(size_t index) {
+	auto unlink = [](VisualNode* node, size_t link) {
+		std::erase(node->m_links, link);
+	};
+	auto relink = [](VisualNode* node, size_t from, size_t to) {
+		std::replace(node->m_links.begin(), node->m_links.end(), from, to);
+	};
+
+	const VisualConnection erased = m_connections[index];
+	unlink(erased.source, index);
+	unlink(erased.destination, index);
+
+	size_t last = m_connections.size() - 1;
+	if (index != last) {
+		const VisualConnection& moved = m_connections[last];
+		relink(moved.source, last, index);
+		if (moved.destination != moved.source) relink(moved.destination, last, index);
+		m_connections[index] = moved;
+	}
+	m_connections.pop_back();
+}
+
+void NodeEditor::rebuildLinks() {
+	for (auto&& node : m_nodes) node->m_links.clear();
+	std::vector<VisualConnection> connections = std::move(m_connections);
+	m_connections.clear();
+	for (auto&& conn : connections) addLink(conn);
 }
 
 void NodeEditor::rebuildDrawOrder() {
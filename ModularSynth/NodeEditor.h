@@ -10,8 +10,10 @@
 #include <memory>
 #include <algorithm>
 #include <functional>
+#include <unordered_map>
 
 #include "NodeGraph.h"
+#include "SlotMap.h"
 
 enum class NodeEditorState {
 	idling = 0,
@@ -55,6 +57,7 @@ protected:
 	std::string m_name{ "Node" }, m_code{ "NOD" };
 
 	Node* m_node{ nullptr };
+	std::vector<size_t> m_links; // into NodeEditor::m_connections, as either end
 };
 
 template <typename T>
@@ -86,19 +89,21 @@ public:
 		T* instance = new T();
 		U* node = m_graph->create<U>();
 
-		instance->m_id = g_NodeID++;
 		instance->m_node = node;
 		instance->m_name = name;
 		instance->m_color = color;
 		instance->m_code = code;
 
-		node->solve();
+		instance->m_id = m_nodes.insert(std::unique_ptr<VisualNode>(instance));
+		m_visualIds[node->id()] = instance->m_id;
 
-		m_nodes.push_back(std::unique_ptr<T>(instance));
-
-		rebuildDrawOrder();
+		// in a transaction the graph gets solved once on commit
+		if (!m_graph->inTransaction()) {
+			node->solve();
+			rebuildDrawOrder();
+		}
 
-		return dynamic_cast<T*>(m_nodes.back().get());
+		return instance;
 	}
 
 	int getClosestInput(Point p, VisualNode*& node, int& inputRectIndex);
@@ -106,21 +111,14 @@ public:
 	int getClosestOutput(Point p, VisualNode*& node, int& inputRectIndex);
 
 	VisualNode* get(size_t id) {
-		auto pos = std::find_if(m_nodes.begin(), m_nodes.end(), [id](const std::unique_ptr<VisualNode>& ob) {
-			return ob->id() == id;
-		});
-		if (pos != m_nodes.end()) {
-			return pos->get();
-		}
-		return nullptr;
+		auto node = m_nodes.get(id);
+		return node ? node->get() : nullptr;
 	}
 
 	VisualNode* getFromOriginalNodeId(size_t id) {
-		auto pos = std::find_if(m_nodes.begin(), m_nodes.end(), [id](const std::unique_ptr<VisualNode>& ob) {
-			return ob->node()->id() == id;
-			});
-		if (pos != m_nodes.end()) {
-			return pos->get();
+		auto pos = m_visualIds.find(id);
+		if (pos != m_visualIds.end()) {
+			return get(pos->second);
 		}
 		return nullptr;
 	}
@@ -128,14 +126,23 @@ public:
 	void connect(VisualNode* source, size_t sourceOutput, VisualNode* destination, size_t destinationInput);
 	void removeConnection(VisualNode* source, size_t sourceOutput, VisualNode* destination, size_t destinationInput);
 
+	/// removes the node, its connections and the graph node behind it
+	void remove(VisualNode* node);
+
+	/// defers ordering, validation and solving of the graph until commit (see NodeGraph)
+	void beginTransaction();
+	void commitTransaction();
+
 	NodeGraph* graph() { return m_graph.get(); }
 
 	std::function<void(VisualNode*)> onSelect{ nullptr };
 	std::function<void()> onParamChange{ nullptr };
+	std::function<void(VisualNode*)> onRemove{ nullptr }; // called right before the node is destroyed
 
 private:
-	std::vector<std::unique_ptr<VisualNode>> m_nodes;
-	std::vector<VisualConnection> m_connections;
+	SlotMap<std::unique_ptr<VisualNode>> m_nodes;
+	std::unordered_map<size_t, SlotHandle> m_visualIds; // graph node id -> visual node
+	std::vector<VisualConnection> m_connections; // unordered, see eraseLink
 
 	std::vector<size_t> m_drawOrders;
 
@@ -151,11 +158,15 @@ private:
 
 	void rebuildDrawOrder();
 
+	// m_connections and the nodes' indices into it, kept in step. Erasing
+	// moves the last link into the hole, so it costs the degree of the ends
+	void addLink(const VisualConnection& conn);
+	void eraseLink(size_t index);
+	void rebuildLinks();
+
 	std::vector<VisualConnection> getConnectionsTo(VisualNode* node);
 	std::vector<VisualConnection> getConnectionsFrom(VisualNode* node);
 	void moveNodeTree(VisualNode* node, int dx, int dy);
 
 	bool m_shiftPressed{ false };
-
-	static size_t g_NodeID;
 };
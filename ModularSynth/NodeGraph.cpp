@@ -1,40 +1,106 @@
 #include "NodeGraph.h"
 
+#include <algorithm>
 #include <cassert>
-#include <stack>
+#include <format>
 #include <queue>
 
-size_t NodeGraph::g_NodeID = 1;
+#ifdef _DEBUG
+#include <iostream>
+#endif
+
+NodeGraph::~NodeGraph() {
+	for (Node* node : m_nodes) {
+		m_pools[std::type_index(typeid(*node))]->destroy(node);
+	}
+	m_nodes.clear();
+}
 
-size_t Node::addInput(const std::string& name, ValueType type) {
-	m_inputs.push_back({ .type = type });
+size_t Node::addInput(Symbol name, ValueType type) {
 	m_inputNames.push_back(name);
-	return m_inputs.size() - 1;
+	return m_graph->addPort(m_graph->m_inputPorts, m_inputBase, m_inputCount, type);
 }
 
-size_t Node::addOutput(const std::string& name, ValueType type) {
-	m_outputs.push_back({ .type = type });
+size_t Node::addOutput(Symbol name, ValueType type) {
 	m_outputNames.push_back(name);
-	return m_outputs.size() - 1;
+	return m_graph->addPort(m_graph->m_outputPorts, m_outputBase, m_outputCount, type);
 }
 
-NodeValue& Node::texture(size_t index) {
-	return m_outputs[index];
+PortRef Node::texture(size_t index) {
+	auto& ports = m_graph->m_outputPorts;
+	PortHandle port = outputPort(index);
+	return { ports.values[port], ports.types[port], bool(ports.connected[port]) };
 }
 
-NodeValue& Node::input(size_t index) {
-	return m_inputs[index];
+PortRef Node::input(size_t index) {
+	auto& ports = m_graph->m_inputPorts;
+	PortHandle port = inputPort(index);
+	return { ports.values[port], ports.types[port], bool(ports.connected[port]) };
 }
 
-NodeValue* Node::input(const std::string& in) {
-	auto pos = std::find(m_inputNames.begin(), m_inputNames.end(), in);
-	if (pos == m_inputNames.end()) {
-		return nullptr;
+void Node::invalidate() {
+	m_changed = true;
+	if (m_graph) m_graph->markDirty(this);
+	else m_dirty = true;
+}
+
+std::optional<PortRef> Node::input(Symbol in) {
+	size_t index = inputIndex(in);
+	if (index == inputCount()) {
+		return std::nullopt;
 	}
-	auto dist = std::distance(m_inputNames.begin(), pos);
-	return &m_inputs[dist];
+	return input(index);
 }
 
+uint32_t NodeGraph::addPort(PortArray& ports, PortHandle& base, uint32_t& count, ValueType type) {
+	if (count == 0) {
+		base = PortHandle(ports.size());
+	}
+	else if (base + count != ports.size()) {
+		// ports added after another node got some, move the range to the end
+		PortHandle from = base;
+		base = PortHandle(ports.size());
+		for (uint32_t i = 0; i < count; i++) {
+			RawValue value = ports.values[from + i];
+			ports.append(value, ports.types[from + i], ports.connected[from + i]);
+		}
+		ports.holes += count;
+	}
+
+	ports.append(RawValue{ 0.0f }, type, 0);
+	return count++;
+}
+
+void NodeGraph::compactPorts() {
+	auto compact = [this](PortArray& ports, PortHandle Node::* base, uint32_t Node::* count) {
+		PortArray packed;
+		packed.values.reserve(ports.size() - ports.holes);
+		packed.types.reserve(ports.size() - ports.holes);
+		packed.connected.reserve(ports.size() - ports.holes);
+
+		// keep the path order, neighbours in the path end up close in memory
+		for (Node* node : m_nodePath) {
+			if (!node) continue;
+			PortHandle from = node->*base;
+			node->*base = PortHandle(packed.size());
+			for (uint32_t i = 0; i < node->*count; i++) {
+				packed.append(ports.values[from + i], ports.types[from + i], ports.connected[from + i]);
+			}
+		}
+		ports = std::move(packed);
+	};
+
+	compact(m_inputPorts, &Node::m_inputBase, &Node::m_inputCount);
+	compact(m_outputPorts, &Node::m_outputBase, &Node::m_outputCount);
+}
+
+static bool byInput(const Connection& a, const Connection& b) {
+	return a.destinationInput < b.destinationInput;
+}
+
+static bool byOutput(const Connection& a, const Connection& b) {
+	return a.sourceOutput < b.sourceOutput;
+}
 
 bool NodeGraph::connect(Node* source, size_t sourceOutput, Node* destination, size_t destinationInput) {
 	Connection conn{
@@ -43,106 +109,307 @@ bool NodeGraph::connect(Node* source, size_t sourceOutput, Node* destination, si
 		.destinationInput = destinationInput,
 		.sourceOutput = sourceOutput
 	};
-	source->m_outputs[sourceOutput].connected = true;
-	if (!destination->m_inputs[destinationInput].connected) 
+	if (!m_inputPorts.connected[destination->inputPort(destinationInput)]) 
 	{
-		destination->m_inputs[destinationInput].connected = true;
-		m_connections.push_back(conn);
-		buildNodePath();
+		bool ordered = source != destination;
+		if (ordered) {
+			if (m_transactionDepth > 0) m_pendingConnections.push_back(conn);
+			else ordered = reorder(source, destination);
+		}
+
+		if (!ordered) {
+			m_lastError = std::format(
+				"Connecting node {} to node {} would create a cycle.",
+				source->id(), destination->id()
+			);
+#ifdef _DEBUG
+			std::cout << m_lastError << "\n";
+#endif
+			return false;
+		}
+
+		m_outputPorts.connected[source->outputPort(sourceOutput)] = true;
+		m_inputPorts.connected[destination->inputPort(destinationInput)] = true;
+
+		auto& in = destination->m_incoming;
+		in.insert(std::upper_bound(in.begin(), in.end(), conn, byInput), conn);
+
+		auto& out = source->m_outgoing;
+		out.insert(std::upper_bound(out.begin(), out.end(), conn, byOutput), conn);
+
+		markDirty(destination);
 		return true;
 	}
 	return false;
 }
 
 void NodeGraph::removeConnection(Node* source, size_t sourceOutput, Node* destination, size_t destinationInput) {
-	auto pos = std::find_if(m_connections.begin(), m_connections.end(), [=](const Connection& cn) {
+	auto& in = destination->m_incoming;
+	auto inPos = std::find_if(in.begin(), in.end(), [=](const Connection& cn) {
+		return cn.destinationInput == destinationInput &&
+			cn.source == source &&
+			cn.sourceOutput == sourceOutput;
+	});
+	if (inPos == in.end()) return;
+	in.erase(inPos);
+
+	auto& out = source->m_outgoing;
+	auto outPos = std::find_if(out.begin(), out.end(), [=](const Connection& cn) {
 		return cn.destination == destination &&
 			cn.destinationInput == destinationInput &&
-			cn.source == source &&
 			cn.sourceOutput == sourceOutput;
 	});
-	if (pos == m_connections.end()) return;
-	source->m_outputs[sourceOutput].connected = false;
-	destination->m_inputs[destinationInput].connected = false;
-	m_connections.erase(pos);
+	if (outPos != out.end()) out.erase(outPos);
+
+	m_outputPorts.connected[source->outputPort(sourceOutput)] = !getConnectionsFromOutput(source, sourceOutput).empty();
+	m_inputPorts.connected[destination->inputPort(destinationInput)] = false;
+	markDirty(destination);
+}
+
+void NodeGraph::remove(Node* node) {
+	if (!node || resolve(node->m_handle) != node) return;
+
+	onRemove(node);
+
+	for (auto&& conn : node->m_incoming) {
+		Node* source = conn.source;
+		auto& out = source->m_outgoing;
+		auto pos = std::find_if(out.begin(), out.end(), [&](const Connection& cn) {
+			return cn.destination == node && cn.destinationInput == conn.destinationInput;
+		});
+		if (pos != out.end()) out.erase(pos);
+
+		m_outputPorts.connected[source->outputPort(conn.sourceOutput)] = !getConnectionsFromOutput(source, conn.sourceOutput).empty();
+	}
+
+	for (auto&& conn : node->m_outgoing) {
+		Node* destination = conn.destination;
+		auto& in = destination->m_incoming;
+		auto pos = std::find_if(in.begin(), in.end(), [&](const Connection& cn) {
+			return cn.source == node && cn.destinationInput == conn.destinationInput;
+		});
+		if (pos != in.end()) in.erase(pos);
+
+		m_inputPorts.connected[destination->inputPort(conn.destinationInput)] = false;
+		markDirty(destination);
+	}
+
+	node->m_incoming.clear();
+	node->m_outgoing.clear();
+
+	// swap with the last dirty node, the order of the roots doesn't matter
+	if (node->m_dirty) {
+		Node* last = m_dirtyNodes.back();
+		m_dirtyNodes[node->m_dirtyIndex] = last;
+		last->m_dirtyIndex = node->m_dirtyIndex;
+		m_dirtyNodes.pop_back();
+	}
+
+	if (m_transactionDepth > 0) {
+		std::erase_if(m_pendingConnections, [=](const Connection& cn) {
+			return cn.source == node || cn.destination == node;
+		});
+	}
+
+	// the relative order of the remaining nodes is still valid, just leave a hole
+	m_nodePath[node->m_order] = nullptr;
+	m_pathHoles++;
+	if (m_pathHoles * 2 > m_nodePath.size()) {
+		compactNodePath();
+	}
+
+	m_inputPorts.holes += node->m_inputCount;
+	m_outputPorts.holes += node->m_outputCount;
+	if ((m_inputPorts.holes + m_outputPorts.holes) * 2 > m_inputPorts.size() + m_outputPorts.size()) {
+		compactPorts();
+	}
+
+	m_ids.erase(node->m_id);
+	m_nodes.erase(node->m_handle);
+	m_pools[std::type_index(typeid(*node))]->destroy(node);
+}
+
+void NodeGraph::beginTransaction() {
+	m_transactionDepth++;
+}
+
+bool NodeGraph::commitTransaction() {
+	if (m_transactionDepth == 0 || --m_transactionDepth > 0) return true;
+
+	std::vector<Connection> pending = std::move(m_pendingConnections);
+	m_pendingConnections.clear();
+
+	if (buildNodePath()) return true;
+
+	// some of the new connections close a cycle, take them all out
+	// and add them back one by one so the offending ones get rejected
+	std::erase_if(pending, [&](const Connection& cn) {
+		auto conns = getConnectionsToInput(cn.destination, cn.destinationInput);
+		return conns.empty() || conns.front().source != cn.source || conns.front().sourceOutput != cn.sourceOutput;
+	});
+	for (auto&& conn : pending) {
+		removeConnection(conn.source, conn.sourceOutput, conn.destination, conn.destinationInput);
+	}
+
 	buildNodePath();
+
+	for (auto&& conn : pending) {
+		connect(conn.source, conn.sourceOutput, conn.destination, conn.destinationInput);
+	}
+	return false;
 }
 
 void NodeGraph::solve() {
-	if (m_nodePath.empty()) buildNodePath();
+	m_solveStats = {};
 
-	std::stack<Node*> nodes;
-	for (size_t i = m_nodePath.size(); i-- > 0;) {
-		Node* node = get(m_nodePath[i]);
-		node->m_solved = false;
-		node->m_changed = false;
-		nodes.push(node);
+	std::vector<Node*> roots = std::move(m_dirtyNodes);
+	m_dirtyNodes.clear();
+
+	if (m_pool && m_pool->size() > 1) {
+		solveParallel(std::move(roots));
+	}
+	else {
+		solveSerial(std::move(roots));
 	}
 
-	// solve nodes
+	m_solveStats.skipped = m_nodes.size() - m_solveStats.visited;
+}
+
+void NodeGraph::setThreadCount(size_t count) {
+	if (count == threadCount()) return;
+	m_pool = count > 1 ? std::make_unique<ThreadPool>(count) : nullptr;
+}
+
+void NodeGraph::solveSerial(std::vector<Node*> roots) {
+	// solve the dirty nodes and everything downstream of them, in path order
+	auto laterInPath = [](Node* a, Node* b) { return a->m_order > b->m_order; };
+	std::priority_queue<Node*, std::vector<Node*>, decltype(laterInPath)> nodes(laterInPath, std::move(roots));
+	RawValue* inputs = m_inputPorts.values.data();
+	const RawValue* outputs = m_outputPorts.values.data();
+
 	while (!nodes.empty()) {
 		Node* node = nodes.top(); nodes.pop();
-		if (!node->m_solved) {
-			node->solve();
-		}
+		node->m_solved = false;
+		node->solve();
+		node->m_dirty = false;
+		m_solveStats.visited++;
 
 		// set values
-		for (auto conn : getNodeOutputConnections(node)) {
-			Node* from = conn.source;
+		for (auto&& conn : getNodeOutputConnections(node)) {
 			Node* to = conn.destination;
-			to->input(conn.destinationInput).value = from->texture(conn.sourceOutput).value;
+			inputs[to->inputPort(conn.destinationInput)] = outputs[node->outputPort(conn.sourceOutput)];
+
+			if (!to->m_dirty) {
+				to->m_dirty = true;
+				nodes.push(to);
+			}
+		}
+	}
+}
+
+void NodeGraph::solveParallel(std::vector<Node*> roots) {
+	// collect the whole cone up front, every node in it is flagged dirty
+	std::vector<Node*>& cone = roots;
+	for (size_t i = 0; i < cone.size(); i++) {
+		for (auto&& conn : cone[i]->m_outgoing) {
+			Node* to = conn.destination;
+			if (!to->m_dirty) {
+				to->m_dirty = true;
+				cone.push_back(to);
+			}
+		}
+	}
+
+	// not worth waking the workers up
+	if (cone.size() < parallelSolveThreshold) {
+		solveSerial(std::move(cone));
+		return;
+	}
+
+	// a node is ready once all its dirty inputs are solved, the cone is closed
+	// downstream so a dirty source is always part of it
+	std::vector<std::atomic<uint32_t>> pending(cone.size());
+	std::vector<void*> ready;
+	for (size_t i = 0; i < cone.size(); i++) {
+		Node* node = cone[i];
+		node->m_coneIndex = i;
+
+		uint32_t count = 0;
+		for (auto&& conn : node->m_incoming) {
+			if (conn.source->m_dirty) count++;
 		}
+		pending[i].store(count, std::memory_order_relaxed);
+		if (count == 0) ready.push_back(node);
 	}
+
+	// solve() of a node must only touch the node itself while this runs,
+	// each input has a single connection so the writes below never overlap
+	RawValue* inputs = m_inputPorts.values.data();
+	const RawValue* outputs = m_outputPorts.values.data();
+	m_pool->run(ready, cone.size(), [&](void* item, size_t worker) {
+		Node* node = static_cast<Node*>(item);
+		node->m_solved = false;
+		node->solve();
+
+		for (auto&& conn : node->m_outgoing) {
+			Node* to = conn.destination;
+			inputs[to->inputPort(conn.destinationInput)] = outputs[node->outputPort(conn.sourceOutput)];
+
+			if (pending[to->m_coneIndex].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				m_pool->push(worker, to);
+			}
+		}
+	});
+
+	for (Node* node : cone) node->m_dirty = false;
+	m_solveStats.visited += cone.size();
+}
+
+void NodeGraph::markDirty(Node* node) {
+	if (node->m_dirty) return;
+	node->m_dirty = true;
+	node->m_dirtyIndex = m_dirtyNodes.size();
+	m_dirtyNodes.push_back(node);
 }
 
 bool NodeGraph::hasChanges() const {
-	for (auto&& node : m_nodes) {
+	for (Node* node : m_nodes) {
 		if (node->changed()) return true;
 	}
 	return false;
 }
 
 void NodeGraph::clearChanges() {
-	for (auto&& node : m_nodes) {
+	for (Node* node : m_nodes) {
 		if (node->changed()) node->m_changed = false;
 	}
 }
 
-std::vector<Connection> NodeGraph::getNodeInputConnections(Node* node) {
-	std::vector<Connection> ret;
-	for (auto&& conn : m_connections) {
-		if (conn.destination == node) {
-			ret.push_back(conn);
-		}
-	}
-	return ret;
+std::span<const Connection> NodeGraph::getNodeInputConnections(Node* node) const {
+	return node->m_incoming;
 }
 
-std::vector<Connection> NodeGraph::getNodeOutputConnections(Node* node) {
-	std::vector<Connection> ret;
-	for (auto&& conn : m_connections) {
-		if (conn.source == node) {
-			ret.push_back(conn);
-		}
-	}
-	return ret;
+std::span<const Connection> NodeGraph::getNodeOutputConnections(Node* node) const {
+	return node->m_outgoing;
 }
 
-std::vector<Connection> NodeGraph::getConnectionsToInput(Node* node, size_t input) {
-	std::vector<Connection> ret;
-	for (auto&& conn : m_connections) {
-		if (conn.destination == node && conn.destinationInput == input) {
-			ret.push_back(conn);
-		}
-	}
-	return ret;
+std::span<const Connection> NodeGraph::getConnectionsToInput(Node* node, size_t input) const {
+	Connection key{ .destinationInput = input };
+	auto [first, last] = std::equal_range(node->m_incoming.begin(), node->m_incoming.end(), key, byInput);
+	return { first, last };
+}
+
+std::span<const Connection> NodeGraph::getConnectionsFromOutput(Node* node, size_t output) const {
+	Connection key{ .sourceOutput = output };
+	auto [first, last] = std::equal_range(node->m_outgoing.begin(), node->m_outgoing.end(), key, byOutput);
+	return { first, last };
 }
 
 std::vector<size_t> NodeGraph::getPathFrom(Node* node) {
 	assert(node != nullptr);
 
 	std::vector<size_t> path;
-	for (auto conn : getNodeOutputConnections(node)) {
+	for (auto&& conn : getNodeOutputConnections(node)) {
 		path.push_back(conn.destination->id());
 	}
 	return path;
@@ -150,10 +417,8 @@ std::vector<size_t> NodeGraph::getPathFrom(Node* node) {
 
 std::vector<size_t> NodeGraph::getLeftMostNodes() {
 	std::vector<size_t> ret;
-	for (auto&& node : m_nodes) {
-		Node* nodePtr = node.get();
-		auto connections = getNodeInputConnections(nodePtr);
-		if (connections.empty()) {
+	for (Node* node : m_nodes) {
+		if (node->m_incoming.empty()) {
 			ret.push_back(node->id());
 		}
 	}
@@ -162,66 +427,56 @@ std::vector<size_t> NodeGraph::getLeftMostNodes() {
 
 std::vector<size_t> NodeGraph::getRightMostNodes() {
 	std::vector<size_t> ret;
-	for (auto&& node : m_nodes) {
-		Node* nodePtr = node.get();
-		for (size_t i = 0; i < node->m_outputs.size(); i++) {
-			auto connections = getNodeOutputConnections(nodePtr);
-			if (connections.empty()) {
-				ret.push_back(node->id());
-			}
+	for (Node* node : m_nodes) {
+		if (node->m_outgoing.empty()) {
+			ret.push_back(node->id());
 		}
 	}
 	return ret;
 }
 
-#ifdef _DEBUG
-#include <iostream>
-#endif
-
-void NodeGraph::buildNodePath() {
-#define nodeExistsVec(vec, nid) (std::find(vec.begin(), vec.end(), (nid)) != vec.end())
-#define nodeExists(nid) nodeExistsVec(m_nodePath, nid)
-	m_nodePath.clear();
-
-	std::vector<size_t> nodeQueue;
-	for (size_t nid : getLeftMostNodes()) {
-		nodeQueue.push_back(nid);
+bool NodeGraph::buildNodePath() {
+	// Kahn's algorithm, only needed to rebuild the order from scratch
+	std::vector<size_t> pending(m_nodes.size());
+	for (size_t i = 0; i < m_nodes.size(); i++) {
+		m_nodes[i]->m_order = i;
+		pending[i] = m_nodes[i]->m_incoming.size();
 	}
 
-	while (!nodeQueue.empty()) {
-		size_t pid = nodeQueue.front();
-		if (nodeExists(pid)) {
-			nodeQueue.erase(nodeQueue.begin());
-			continue;
+	m_nodePath.clear();
+	for (Node* node : m_nodes) {
+		if (pending[node->m_order] == 0) {
+			m_nodePath.push_back(node);
 		}
+	}
 
-		auto path = getPathFrom(get(pid));
-		for (size_t nid : path) nodeQueue.push_back(nid);
-
-		// are all the inputs processed?
-		bool ok = true;
-		for (const auto& conn : getNodeInputConnections(get(pid))) {
-			if (!nodeExists(conn.source->id())) {
-				ok = false;
-				break;
+	for (size_t head = 0; head < m_nodePath.size(); head++) {
+		for (auto&& conn : m_nodePath[head]->m_outgoing) {
+			if (--pending[conn.destination->m_order] == 0) {
+				m_nodePath.push_back(conn.destination);
 			}
 		}
+	}
 
-		if (ok) {
-			m_nodePath.push_back(pid);
-			nodeQueue.erase(nodeQueue.begin());
-		}
-		else {
-			nodeQueue.erase(nodeQueue.begin());
-			nodeQueue.insert(nodeQueue.end(), pid);
+	const bool acyclic = m_nodePath.size() == m_nodes.size();
+	if (!acyclic) {
+		// the rest is part of (or behind) a cycle, keep it in the path anyway
+		for (Node* node : m_nodes) {
+			if (pending[node->m_order] > 0) m_nodePath.push_back(node);
 		}
+		m_lastError = "The node graph has a cycle.";
+	}
+
+	for (size_t i = 0; i < m_nodePath.size(); i++) {
+		m_nodePath[i]->m_order = i;
 	}
+	m_pathHoles = 0;
 
 #ifdef _DEBUG
 	std::cout << "[ ";
 	size_t i = 0;
-	for (size_t pid : m_nodePath) {
-		std::cout << pid;
+	for (Node* node : m_nodePath) {
+		std::cout << node->id();
 		if (i < m_nodePath.size() - 1) {
 			std::cout << ", ";
 		}
@@ -229,4 +484,94 @@ void NodeGraph::buildNodePath() {
 	}
 	std::cout << "]\n";
 #endif
+
+	return acyclic;
+}
+
+void NodeGraph::compactNodePath() {
+	if (m_pathHoles == 0) return;
+
+	std::erase(m_nodePath, nullptr);
+	for (size_t i = 0; i < m_nodePath.size(); i++) {
+		m_nodePath[i]->m_order = i;
+	}
+	m_pathHoles = 0;
+}
+
+bool NodeGraph::reorder(Node* source, Node* destination) {
+	const size_t lowerBound = destination->m_order;
+	const size_t upperBound = source->m_order;
+
+	// already in order, nothing to do
+	if (lowerBound > upperBound) return true;
+	if (source == destination) return false;
+
+	std::vector<Node*> forward, backward, stack;
+
+	auto clearVisited = [&]() {
+		for (Node* node : forward) node->m_visited = false;
+		for (Node* node : backward) node->m_visited = false;
+	};
+
+	// nodes reachable from the destination that are currently placed before the source
+	destination->m_visited = true;
+	stack.push_back(destination);
+	while (!stack.empty()) {
+		Node* node = stack.back(); stack.pop_back();
+		forward.push_back(node);
+
+		for (auto&& conn : node->m_outgoing) {
+			Node* next = conn.destination;
+			if (next == source) {
+				for (Node* n : stack) n->m_visited = false;
+				clearVisited();
+				return false;
+			}
+			if (!next->m_visited && next->m_order < upperBound) {
+				next->m_visited = true;
+				stack.push_back(next);
+			}
+		}
+	}
+
+	// nodes reaching the source that are currently placed after the destination
+	source->m_visited = true;
+	stack.push_back(source);
+	while (!stack.empty()) {
+		Node* node = stack.back(); stack.pop_back();
+		backward.push_back(node);
+
+		for (auto&& conn : node->m_incoming) {
+			Node* prev = conn.source;
+			if (!prev->m_visited && prev->m_order > lowerBound) {
+				prev->m_visited = true;
+				stack.push_back(prev);
+			}
+		}
+	}
+
+	clearVisited();
+
+	auto byOrder = [](Node* a, Node* b) { return a->m_order < b->m_order; };
+	std::sort(forward.begin(), forward.end(), byOrder);
+	std::sort(backward.begin(), backward.end(), byOrder);
+
+	// reuse the same slots, backward set first, forward set after
+	std::vector<size_t> slots;
+	slots.reserve(forward.size() + backward.size());
+	for (Node* node : backward) slots.push_back(node->m_order);
+	for (Node* node : forward) slots.push_back(node->m_order);
+	std::sort(slots.begin(), slots.end());
+
+	size_t slot = 0;
+	for (Node* node : backward) {
+		node->m_order = slots[slot++];
+		m_nodePath[node->m_order] = node;
+	}
+	for (Node* node : forward) {
+		node->m_order = slots[slot++];
+		m_nodePath[node->m_order] = node;
+	}
+
+	return true;
 }
@@ -1,10 +1,20 @@
 #pragma once
 
 #include <array>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <cstdint>
 #include <memory>
+#include <span>
+#include <typeindex>
+#include <unordered_map>
+#include <optional>
+
+#include "SlotMap.h"
+#include "ObjectPool.h"
+#include "ThreadPool.h"
+#include "Symbol.h"
 
 using RawValue = std::array<float, 4>;
 
@@ -23,92 +33,234 @@ struct NodeValue {
 	bool connected{ false };
 };
 
+/*
+ * Port storage (structure of arrays)
+ * ====================================================
+ * The graph keeps the values, types and connected flags of every input (and
+ * separately every output) in parallel arrays. Each node owns one contiguous
+ * range per array, a port is addressed by the range base + its index.
+ */
+using PortHandle = uint32_t;
+
+struct PortArray {
+	std::vector<RawValue> values;
+	std::vector<ValueType> types;
+	std::vector<uint8_t> connected;
+	size_t holes{ 0 }; // ports of removed or relocated ranges
+
+	size_t size() const { return values.size(); }
+
+	PortHandle append(const RawValue& value, ValueType type, uint8_t isConnected) {
+		values.push_back(value);
+		types.push_back(type);
+		connected.push_back(isConnected);
+		return PortHandle(values.size() - 1);
+	}
+
+	void clear() {
+		values.clear();
+		types.clear();
+		connected.clear();
+		holes = 0;
+	}
+};
+
+// a port seen through the node, the value is written in place
+struct PortRef {
+	RawValue& value;
+	ValueType type;
+	bool connected;
+
+	operator NodeValue() const { return { value, type, connected }; }
+};
+
+class Node;
+class NodeGraph;
+
+struct Connection {
+	Node* source;
+	Node* destination;
+	size_t destinationInput;
+	size_t sourceOutput;
+};
+
 class Node {
 	friend class NodeGraph;
 public:
 	virtual ~Node() = default;
 
-	size_t addInput(const std::string& name, ValueType type);
-	size_t addOutput(const std::string& name, ValueType type);
+	size_t addInput(Symbol name, ValueType type);
+	size_t addOutput(Symbol name, ValueType type);
 
-	NodeValue& texture(size_t index);
-	NodeValue& input(size_t index);
-	NodeValue* input(const std::string& in);
+	PortRef texture(size_t index);
+	PortRef input(size_t index);
+	std::optional<PortRef> input(Symbol in);
 
 	virtual NodeValue solve() = 0;
 	virtual void setup() = 0;
 
 	size_t id() const { return m_id; }
-	size_t outputCount() const { return m_outputs.size(); }
-	size_t inputCount() const { return m_inputs.size(); }
+	SlotHandle handle() const { return m_handle; }
+	size_t outputCount() const { return m_outputCount; }
+	size_t inputCount() const { return m_inputCount; }
+
+	PortHandle inputPort(size_t index) const { return m_inputBase + PortHandle(index); }
+	PortHandle outputPort(size_t index) const { return m_outputBase + PortHandle(index); }
 
-	bool hasInput(const std::string& in) { return std::find(m_inputNames.begin(), m_inputNames.end(), in) != m_inputNames.end(); }
-	bool hasOutput(const std::string& out) { return std::find(m_outputNames.begin(), m_outputNames.end(), out) != m_outputNames.end(); }
+	bool hasInput(Symbol in) const { return inputIndex(in) < m_inputNames.size(); }
+	bool hasOutput(Symbol out) const { return outputIndex(out) < m_outputNames.size(); }
 
-	const std::string& inputName(size_t index) const { return m_inputNames[index]; }
-	const std::string& outputName(size_t index) const { return m_outputNames[index]; }
+	Symbol inputSymbol(size_t index) const { return m_inputNames[index]; }
+	Symbol outputSymbol(size_t index) const { return m_outputNames[index]; }
+	const std::string& inputName(size_t index) const { return m_inputNames[index].str(); }
+	const std::string& outputName(size_t index) const { return m_outputNames[index].str(); }
 
-	size_t inputIndex(const std::string& in) {
-		auto pos = std::find(m_inputNames.begin(), m_inputNames.end(), in);
-		return std::distance(m_inputNames.begin(), pos);
+	// inputCount()/outputCount() if there's no such port
+	size_t inputIndex(Symbol in) const {
+		return std::distance(m_inputNames.begin(), std::find(m_inputNames.begin(), m_inputNames.end(), in));
+	}
+	size_t outputIndex(Symbol out) const {
+		return std::distance(m_outputNames.begin(), std::find(m_outputNames.begin(), m_outputNames.end(), out));
 	}
 
 	bool changed() const { return m_changed; }
+	bool dirty() const { return m_dirty; }
 
 protected:
 	bool m_solved{ false };
 	bool m_changed{ false };
+	bool m_dirty{ false }; // needs to be solved again
+	bool m_visited{ false };
+
+	NodeGraph* m_graph{ nullptr };
+
+	void invalidate();
 
 	size_t m_id{ 0 };
-	std::vector<NodeValue> m_inputs, m_outputs;
-	std::vector<std::string> m_inputNames, m_outputNames;
+	SlotHandle m_handle{ SlotMap<Node*>::invalidHandle };
+	size_t m_order{ 0 }; // position in NodeGraph::m_nodePath
+	size_t m_coneIndex{ 0 }; // scratch slot of the parallel solve
+	size_t m_dirtyIndex{ 0 }; // position in NodeGraph::m_dirtyNodes while m_dirty, between solves
+
+	// port ranges in NodeGraph::m_inputPorts/m_outputPorts
+	PortHandle m_inputBase{ 0 }, m_outputBase{ 0 };
+	uint32_t m_inputCount{ 0 }, m_outputCount{ 0 };
+	std::vector<Symbol> m_inputNames, m_outputNames;
+
+	// adjacency, maintained by NodeGraph::connect/removeConnection
+	// m_incoming is sorted by destinationInput, m_outgoing by sourceOutput
+	std::vector<Connection> m_incoming, m_outgoing;
 };
 
 template <typename T>
 concept NodeObject = std::is_base_of<Node, T>::value;
 
-struct Connection {
-	Node* source;
-	Node* destination;
-	size_t destinationInput;
-	size_t sourceOutput;
-};
-
 class NodeGraph {
+	friend class Node;
 public:
+	NodeGraph() = default;
+	virtual ~NodeGraph();
+
 	template <NodeObject T>
 	T* create() {
-		T* instance = new T();
-		instance->m_id = g_NodeID++;
-		m_nodes.push_back(std::unique_ptr<Node>(instance));
-		m_nodes.back()->setup();
-		return dynamic_cast<T*>(m_nodes.back().get());
+		T* instance = pool<T>().create();
+		instance->m_id = m_nextId++;
+		instance->m_handle = m_nodes.insert(instance);
+		instance->m_order = m_nodePath.size();
+		instance->m_graph = this;
+		m_ids[instance->m_id] = instance->m_handle;
+		m_nodePath.push_back(instance);
+		instance->setup();
+		markDirty(instance);
+		return instance;
 	}
 
 	Node* get(size_t id) {
-		auto pos = std::find_if(m_nodes.begin(), m_nodes.end(), [id](const std::unique_ptr<Node>& ob) {
-			return ob->id() == id;
-		});
-		if (pos != m_nodes.end()) {
-			return pos->get();
+		auto pos = m_ids.find(id);
+		if (pos != m_ids.end()) {
+			return resolve(pos->second);
 		}
 		return nullptr;
 	}
 
+	/// O(1), returns nullptr if the node behind the handle is gone
+	Node* resolve(SlotHandle handle) {
+		Node** node = m_nodes.get(handle);
+		return node ? *node : nullptr;
+	}
+
+	size_t nodeCount() const { return m_nodes.size(); }
+
+	std::span<const Connection> getConnectionsToInput(Node* node, size_t input) const;
+	std::span<const Connection> getConnectionsFromOutput(Node* node, size_t output) const;
+
+	std::span<const Connection> getNodeInputConnections(Node* node) const;
+	std::span<const Connection> getNodeOutputConnections(Node* node) const;
+
 	bool connect(Node* source, size_t sourceOutput, Node* destination, size_t destinationInput);
 	void removeConnection(Node* source, size_t sourceOutput, Node* destination, size_t destinationInput);
 
+	/// detaches all the connections of the node and destroys it
+	void remove(Node* node);
+
+	/*
+	 * Batched edits: between beginTransaction() and commitTransaction() connect()
+	 * only records the edges, the node path is rebuilt and checked for cycles once
+	 * on commit. Connections that would close a cycle are dropped on commit, in
+	 * which case commitTransaction() returns false. Transactions can be nested.
+	 */
+	void beginTransaction();
+	bool commitTransaction();
+	bool inTransaction() const { return m_transactionDepth > 0; }
+
 	virtual void solve();
-	size_t lastNode() const { return m_nodePath.empty() ? 0 : m_nodePath.front(); }
+	void markDirty(Node* node);
+
+	/*
+	 * Parallel solve: with more than one thread the dirty cone is solved in
+	 * wavefronts, a node is scheduled on the work-stealing pool as soon as all
+	 * of its dirty inputs are solved. Node::solve() must not touch other nodes
+	 * or the graph then. 0 or 1 keeps the deterministic single-thread solve.
+	 */
+	void setThreadCount(size_t count);
+	size_t threadCount() const { return m_pool ? m_pool->size() : 1; }
+
+	struct SolveStats {
+		size_t visited{ 0 }, skipped{ 0 };
+	};
+	const SolveStats& solveStats() const { return m_solveStats; }
+	size_t lastNode() const {
+		for (Node* node : m_nodePath) {
+			if (node) return node->id();
+		}
+		return 0;
+	}
 
 	bool hasChanges() const;
 	void clearChanges();
 
-	static size_t g_NodeID;
+	const std::string& lastError() const { return m_lastError; }
 
 protected:
-	std::vector<std::unique_ptr<Node>> m_nodes;
-	std::vector<Connection> m_connections;
+	// called by remove() before the node is detached and destroyed
+	virtual void onRemove(Node* node) {}
+
+	SlotMap<Node*> m_nodes;
+	std::unordered_map<size_t, SlotHandle> m_ids;
+	std::unordered_map<std::type_index, std::unique_ptr<ObjectPoolBase<Node>>> m_pools;
+	size_t m_nextId{ 1 };
+
+	PortArray m_inputPorts, m_outputPorts;
+
+	uint32_t addPort(PortArray& ports, PortHandle& base, uint32_t& count, ValueType type);
+	void compactPorts();
+
+	template <NodeObject T>
+	ObjectPool<T, Node>& pool() {
+		auto& pool = m_pools[std::type_index(typeid(T))];
+		if (!pool) pool = std::make_unique<ObjectPool<T, Node>>();
+		return static_cast<ObjectPool<T, Node>&>(*pool);
+	}
 
 	/*
 	 * SOLVING A NODE GRAPH FROM LEFT TO RIGHT
@@ -120,15 +272,37 @@ protected:
 	 *		c. Solve the next node
 	 */
 
-	std::vector<size_t> m_nodePath;
+	/*
+	 * The node path is kept in topological order at all times (Pearce-Kelly):
+	 * - new nodes are appended at the end
+	 * - connect() only reorders the nodes between the source and the destination,
+	 *   and rejects the connection if it would close a cycle
+	 * - removeConnection() never invalidates the order
+	 * - remove() leaves a hole (nullptr) behind, call compactNodePath() before walking the path
+	 */
+	std::vector<Node*> m_nodePath;
+	size_t m_pathHoles{ 0 };
+
+	size_t m_transactionDepth{ 0 };
+	std::vector<Connection> m_pendingConnections;
+	std::string m_lastError;
+
+	// nodes changed since the last solve, the roots of the cone to evaluate
+	std::vector<Node*> m_dirtyNodes;
+	SolveStats m_solveStats;
+
+	// smaller cones are solved on the calling thread
+	static constexpr size_t parallelSolveThreshold = 64;
+	std::unique_ptr<ThreadPool> m_pool;
 
-	std::vector<Connection> getConnectionsToInput(Node* node, size_t input);
+	void solveSerial(std::vector<Node*> roots);
+	void solveParallel(std::vector<Node*> roots);
 
-	std::vector<Connection> getNodeInputConnections(Node* node);
-	std::vector<Connection> getNodeOutputConnections(Node* node);
 	std::vector<size_t> getLeftMostNodes();
 	std::vector<size_t> getRightMostNodes();
 	std::vector<size_t> getPathFrom(Node* node);
-	void buildNodePath();
+	bool buildNodePath();
+	void compactNodePath();
+	bool reorder(Node* source, Node* destination);
 
 };
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <utility>
+
+/*
+ * Fixed-size object pool
+ * ====================================================
+ * Objects of one type are constructed in place inside chunks of ChunkSize
+ * objects, destroyed objects leave their storage on a free list for reuse.
+ * Chunks are released once the last object is destroyed or with the pool,
+ * so every object must be destroyed through the pool before it goes away.
+ */
+
+template <typename Base>
+class ObjectPoolBase {
+public:
+	virtual ~ObjectPoolBase() = default;
+	virtual void destroy(Base* object) = 0;
+	virtual size_t liveCount() const = 0;
+};
+
+template <typename T, typename Base = T, size_t ChunkSize = 64>
+class ObjectPool : public ObjectPoolBase<Base> {
+public:
+	ObjectPool() = default;
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator=(const ObjectPool&) = delete;
+
+	template <typename... Args>
+	T* create(Args&&... args) {
+		void* storage = nullptr;
+		if (!m_free.empty()) {
+			storage = m_free.back();
+			m_free.pop_back();
+		}
+		else {
+			if (m_chunks.empty() || m_chunkUsed == ChunkSize) {
+				m_chunks.push_back(std::make_unique<Storage[]>(ChunkSize));
+				m_chunkUsed = 0;
+			}
+			storage = &m_chunks.back()[m_chunkUsed++];
+		}
+
+		m_live++;
+		return new (storage) T(std::forward<Args>(args)...);
+	}
+
+	void destroy(Base* object) override {
+		T* instance = static_cast<T*>(object);
+		instance->~T();
+		m_free.push_back(instance);
+		m_live--;
+
+		// nothing alive anymore, give the memory back
+		if (m_live == 0) {
+			m_chunks.clear();
+			m_free.clear();
+			m_free.shrink_to_fit();
+			m_chunkUsed = 0;
+		}
+	}
+
+	size_t liveCount() const override { return m_live; }
+
+private:
+	struct Storage {
+		alignas(T) std::byte data[sizeof(T)];
+	};
+
+	std::vector<std::unique_ptr<Storage[]>> m_chunks;
+	std::vector<void*> m_free;
+	size_t m_chunkUsed{ 0 };
+	size_t m_live{ 0 };
+};
@@ -0,0 +1,106 @@
+#include "ProgramCache.h"
+#include "StructureHash.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <format>
+#include <iostream>
+
+namespace {
+	struct BlobHeader {
+		char magic[4]{ 'M', 'S', 'P', 'B' };
+		uint32_t version{ 1 };
+		uint32_t format{ 0 };
+		uint32_t size{ 0 };
+		uint64_t key{ 0 };
+	};
+}
+
+std::shared_ptr<Shader> ProgramCache::find(uint64_t key) {
+	if (auto program = m_programs.find(key)) {
+		m_stats.hits++;
+		return *program;
+	}
+
+	if (auto program = load(key)) {
+		m_stats.diskHits++;
+		m_programs.insert(key, program);
+		return program;
+	}
+
+	m_stats.misses++;
+	return nullptr;
+}
+
+void ProgramCache::insert(uint64_t key, const std::shared_ptr<Shader>& program) {
+	if (!program || !program->valid()) return;
+
+	m_programs.insert(key, program);
+	store(key, *program);
+}
+
+void ProgramCache::setDirectory(const std::string& directory) {
+	m_directory = directory;
+	if (m_directory.empty()) return;
+
+	std::error_code err;
+	std::filesystem::create_directories(m_directory, err);
+	if (err) {
+#ifdef _DEBUG
+		std::cout << "program cache: can't use " << m_directory << ": " << err.message() << "\n";
+#endif
+		m_directory.clear();
+	}
+}
+
+std::string ProgramCache::blobPath(uint64_t key) {
+	if (!m_driverHash) { // needs a current context, so not in setDirectory
+		auto renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+		auto version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+		m_driverHash = StructureHash{}
+			.add(renderer ? renderer : "")
+			.add(version ? version : "")
+			.value();
+	}
+
+	uint64_t name = StructureHash{}.add(key).add(m_driverHash).value();
+	return (std::filesystem::path(m_directory) / std::format("{:016x}.bin", name)).string();
+}
+
+std::shared_ptr<Shader> ProgramCache::load(uint64_t key) {
+	if (m_directory.empty()) return nullptr;
+
+	std::ifstream in(blobPath(key), std::ios::binary);
+	if (!in) return nullptr;
+
+	BlobHeader header{}, expected{};
+	in.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!in || std::memcmp(header.magic, expected.magic, 4) != 0 || header.version != expected.version || header.key != key) {
+		return nullptr;
+	}
+
+	std::vector<uint8_t> data(header.size);
+	in.read(reinterpret_cast<char*>(data.data()), data.size());
+	if (!in) return nullptr;
+
+	auto program = std::make_shared<Shader>();
+	if (!program->loadBinary(header.format, data)) return nullptr; // driver changed, or a bad file
+
+	return program;
+}
+
+void ProgramCache::store(uint64_t key, const Shader& program) {
+	if (m_directory.empty()) return;
+
+	BlobHeader header{};
+	std::vector<uint8_t> data;
+	if (!program.binary(header.format, data)) return;
+
+	header.size = uint32_t(data.size());
+	header.key = key;
+
+	std::ofstream out(blobPath(key), std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
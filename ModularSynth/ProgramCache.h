@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Shader.h"
+#include "LruCache.h"
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+/*
+ * Program cache
+ * ====================================================
+ * Linked programs keyed by a structural hash of whatever they were generated
+ * from, so returning to a graph that was compiled before skips codegen and
+ * the compile. Past the capacity the least recently used program is dropped.
+ *
+ * With a directory set, programs are also written there as glGetProgramBinary
+ * blobs and looked up there on a miss. Blobs are only valid for the driver
+ * that made them, so the file names mix in the GL renderer and version, and
+ * a blob the driver rejects is just a miss.
+ */
+class ProgramCache {
+public:
+	struct Stats {
+		size_t hits{ 0 }, diskHits{ 0 }, misses{ 0 };
+	};
+
+	explicit ProgramCache(size_t capacity = 16) : m_programs(capacity) {}
+
+	std::shared_ptr<Shader> find(uint64_t key);
+	void insert(uint64_t key, const std::shared_ptr<Shader>& program);
+
+	// empty disables the disk tier
+	void setDirectory(const std::string& directory);
+	const std::string& directory() const { return m_directory; }
+
+	void setCapacity(size_t capacity) { m_programs.setCapacity(capacity); }
+	size_t size() const { return m_programs.size(); }
+	void clear() { m_programs.clear(); }
+
+	const Stats& stats() const { return m_stats; }
+
+private:
+	LruCache<uint64_t, std::shared_ptr<Shader>> m_programs;
+	std::string m_directory;
+	uint64_t m_driverHash{ 0 };
+	Stats m_stats;
+
+	std::string blobPath(uint64_t key);
+	std::shared_ptr<Shader> load(uint64_t key);
+	void store(uint64_t key, const Shader& program);
+};
@@ -0,0 +1,78 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <numeric>
+
+size_t RenderGraph::addTransient(const TextureDesc& desc) {
+	m_transients.push_back({ .desc = desc });
+	return m_transients.size() - 1;
+}
+
+void RenderGraph::use(size_t transient, size_t pass) {
+	auto& res = m_transients[transient];
+	res.first = res.first == none ? pass : std::min(res.first, pass);
+	res.last = std::max(res.last, pass);
+}
+
+void RenderGraph::compile() {
+	m_physical.clear();
+	m_stats = {};
+
+	std::vector<size_t> order;
+	for (size_t i = 0; i < m_transients.size(); i++) {
+		m_transients[i].physical = none;
+		if (m_transients[i].first != none) order.push_back(i); // never used, never allocated
+	}
+
+	// by first use, then the first texture that's free again is as good as any:
+	// for lifetimes on a line that's the fewest textures per description
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return m_transients[a].first < m_transients[b].first;
+	});
+
+	std::vector<size_t> busyUntil; // last pass of the transient in each physical texture
+	size_t passes = 0;
+	for (size_t i : order) {
+		auto& res = m_transients[i];
+		passes = std::max(passes, res.last + 1);
+
+		for (size_t p = 0; p < m_physical.size(); p++) {
+			if (busyUntil[p] < res.first && m_physical[p] == res.desc) {
+				res.physical = p;
+				break;
+			}
+		}
+		if (res.physical == none) {
+			res.physical = m_physical.size();
+			m_physical.push_back(res.desc);
+			busyUntil.push_back(0);
+		}
+		busyUntil[res.physical] = res.last;
+
+		m_stats.transients++;
+		m_stats.naiveBytes += res.desc.bytes();
+	}
+
+	// alive bytes per pass, as differences from the pass before
+	std::vector<int64_t> alive(passes + 1, 0);
+	for (size_t i : order) {
+		auto& res = m_transients[i];
+		alive[res.first] += int64_t(res.desc.bytes());
+		alive[res.last + 1] -= int64_t(res.desc.bytes());
+	}
+	int64_t current = 0;
+	for (int64_t delta : alive) {
+		current += delta;
+		m_stats.peakBytes = std::max(m_stats.peakBytes, size_t(current));
+	}
+
+	m_stats.textures = m_physical.size();
+	m_stats.pooledBytes = std::accumulate(m_physical.begin(), m_physical.end(), size_t(0),
+		[](size_t sum, const TextureDesc& desc) { return sum + desc.bytes(); });
+}
+
+void RenderGraph::clear() {
+	m_transients.clear();
+	m_physical.clear();
+	m_stats = {};
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
+ * Render graph
+ * ====================================================
+ * Plans where the transient textures of a multi-pass render live. A transient
+ * is written and read only within one render, so it is alive from the first
+ * pass that touches it to the last one. Transients with the same description
+ * whose lifetimes don't overlap share one physical texture.
+ *
+ * Pure bookkeeping: it never touches GL, the caller allocates the physical
+ * textures it asks for.
+ */
+class RenderGraph {
+public:
+	struct TextureDesc {
+		uint32_t width{ 0 }, height{ 0 };
+		uint32_t format{ 0 }; // a GL internal format, only compared
+		uint32_t texelBytes{ 0 };
+
+		size_t bytes() const { return size_t(width) * height * texelBytes; }
+		bool operator==(const TextureDesc&) const = default;
+	};
+
+	struct Stats {
+		size_t transients{ 0 }, textures{ 0 };
+		size_t naiveBytes{ 0 }; // a texture for every transient
+		size_t pooledBytes{ 0 }; // the physical textures
+		size_t peakBytes{ 0 }; // the most that is alive during one pass
+	};
+
+	static constexpr size_t none = size_t(-1);
+
+	// returns the transient's index
+	size_t addTransient(const TextureDesc& desc);
+
+	// a read or a write of the transient in the pass, passes are numbered in run order
+	void use(size_t transient, size_t pass);
+
+	// assigns the physical textures, run it after the last use()
+	void compile();
+
+	void clear();
+
+	size_t physicalOf(size_t transient) const { return m_transients[transient].physical; }
+	const std::vector<TextureDesc>& physical() const { return m_physical; }
+	const Stats& stats() const { return m_stats; }
+
+	size_t firstUse(size_t transient) const { return m_transients[transient].first; }
+	size_t lastUse(size_t transient) const { return m_transients[transient].last; }
+
+private:
+	struct Transient {
+		TextureDesc desc;
+		size_t first{ none }, last{ 0 }; // passes, inclusive
+		size_t physical{ none };
+	};
+
+	std::vector<Transient> m_transients;
+	std::vector<TextureDesc> m_physical;
+	Stats m_stats;
+};
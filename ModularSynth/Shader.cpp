@@ -1,6 +1,19 @@
 #include "Shader.h"
 
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <iostream>
+#endif
+
+static void logError(const char* log) {
+#ifdef _WIN32
+	OutputDebugStringA(log);
+	OutputDebugStringA("\n");
+#else
+	std::cerr << log << "\n";
+#endif
+}
 
 Shader::~Shader() {
 	if (!m_program) return;
@@ -22,7 +35,10 @@ void Shader::add(const std::string& src, GLenum type) {
 	m_shaders.push_back(shader);
 }
 
-void Shader::link() {
+bool Shader::link() {
+	if (m_program == 0) return false;
+
+	glProgramParameteri(m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(m_program);
 
 	GLint status;
@@ -31,11 +47,11 @@ void Shader::link() {
 		char log[1024];
 		glGetProgramInfoLog(m_program, 1024, nullptr, log);
 
-		OutputDebugStringA(log);
-		OutputDebugStringA("\n");
+		logError(log);
 
 		glDeleteProgram(m_program);
-		return;
+		m_program = 0;
+		return false;
 	}
 
 	/*for (auto shader : m_shaders) {
@@ -43,6 +59,38 @@ void Shader::link() {
 		glDeleteShader(shader);
 	}
 	m_shaders.clear();*/
+	return true;
+}
+
+bool Shader::binary(GLenum& format, std::vector<uint8_t>& data) const {
+	if (m_program == 0) return false;
+
+	GLint length = 0;
+	glGetProgramiv(m_program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return false;
+
+	data.resize(length);
+	GLsizei written = 0;
+	glGetProgramBinary(m_program, length, &written, &format, data.data());
+	data.resize(written);
+	return written > 0;
+}
+
+bool Shader::loadBinary(GLenum format, const std::vector<uint8_t>& data) {
+	if (m_program == 0) {
+		m_program = glCreateProgram();
+	}
+
+	glProgramBinary(m_program, format, data.data(), GLsizei(data.size()));
+
+	GLint status;
+	glGetProgramiv(m_program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE) { // rejected, the caller compiles from source instead
+		glDeleteProgram(m_program);
+		m_program = 0;
+		return false;
+	}
+	return true;
 }
 
 GLint Shader::getUniformLocation(const std::string& name) {
@@ -67,8 +115,7 @@ GLuint Shader::createShader(const std::string& src, GLenum type) {
 		char log[1024];
 		glGetShaderInfoLog(shader, 1024, nullptr, log);
 
-		OutputDebugStringA(log);
-		OutputDebugStringA("\n");
+		logError(log);
 
 		glDeleteShader(shader);
 		return 0;
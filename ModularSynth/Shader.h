@@ -4,6 +4,7 @@
 
 #include <vector>
 #include <array>
+#include <cstdint>
 #include <string>
 #include <functional>
 #include <cassert>
@@ -14,16 +15,25 @@ public:
 	virtual ~Shader();
 
 	void add(const std::string& src, GLenum type);
-	void link();
+	bool link();
+
+	// a linked program as a driver specific blob, and back
+	bool binary(GLenum& format, std::vector<uint8_t>& data) const;
+	bool loadBinary(GLenum format, const std::vector<uint8_t>& data);
 
 	GLint getUniformLocation(const std::string& name);
 	GLint getAttributeLocation(const std::string& name);
 
 	template <size_t S>
 	void uniform(const std::string& name, const std::array<float, S>& v) {
+		uniform<S>(getUniformLocation(name), v);
+	}
+
+	// by a location looked up once, for uniforms set every frame
+	template <size_t S>
+	void uniform(GLint loc, const std::array<float, S>& v) {
 		static_assert((S >= 1 && S <= 4) || S == 16 || S == 9);
 
-		GLint loc = getUniformLocation(name);
 		switch (S) {
 			default: break;
 			case 1: glUniform1f(loc, v[0]); break;
@@ -37,9 +47,13 @@ public:
 
 	template <size_t S>
 	void uniformInt(const std::string& name, const std::array<int, S>& v) {
+		uniformInt<S>(getUniformLocation(name), v);
+	}
+
+	template <size_t S>
+	void uniformInt(GLint loc, const std::array<int, S>& v) {
 		static_assert(S >= 1 && S <= 4);
 
-		GLint loc = getUniformLocation(name);
 		switch (S) {
 			default: break;
 			case 1: glUniform1i(loc, v[0]); break;
@@ -50,9 +64,10 @@ public:
 	}
 
 	GLuint id() const { return m_program; }
+	bool valid() const { return m_program != 0; }
 
 private:
-	GLuint m_program;
+	GLuint m_program{ 0 };
 	std::vector<GLuint> m_shaders;
 
 	GLuint createShader(const std::string& src, GLenum type);
@@ -1,113 +1,201 @@
 #include "ShaderGen.h"
+#include "StructureHash.h"
 
-#include <cctype>
 #include <format>
 #include <iostream>
 
-#include "Window.h"
-
 // HEAVILY INSPIRED BY https://github.com/UPBGE/upbge/blob/upbge0.2.5/source/blender/gpu/intern/gpu_codegen.c#L701
 
-void ShaderGen::loadLib(const std::string& src) {
-	const std::regex identifierName("[a-zA-Z0-9_]");
-	StringScanner ss{ src };
+static ShaderFunctionParam parseParameter(const std::vector<std::string_view>& words) {
+	// [qualifiers...] type name
+	ShaderFunctionParam param{};
+	param.qualifier = ShaderFunctionParam::none;
+	for (size_t i = 0; i + 2 < words.size(); i++) {
+		if (words[i] == "in") param.qualifier = ShaderFunctionParam::in;
+		else if (words[i] == "out") param.qualifier = ShaderFunctionParam::out;
+	}
 
-	while (ss.peek()) {
-		size_t pos = ss.position();
-		char c = ss.scan();
+	auto type = words[words.size() - 2];
+	for (size_t i = 0; i < std::size(typeStr); i++) {
+		if (typeStr[i] == type) {
+			param.type = ValueType(i);
+			break;
+		}
+	}
 
-		if (std::isalpha(c)) { // check for functions
-			std::string retType = c + ss.scanWhile(identifierName);
-			ss.skipSpaces();
+	param.name = words.back();
+	param.symbol = param.name;
+	return param;
+}
 
-			std::string identifier = ss.scanWhile(identifierName);
-			ss.skipSpaces();
+ShaderLibrary ShaderGen::parseLib(std::string src) {
+	ShaderLibrary lib{};
+	lib.source = std::move(src);
+	lib.hash = StructureHash{}.add(lib.source).value();
+	const std::string_view source = lib.source;
 
-			if (ss.peek() != '(') { // expect function signature, otherwise it's not a function.
-				continue;
+	for (size_t pos = source.find('$'); pos != std::string_view::npos; pos = source.find('$', pos + 1)) {
+		for (size_t kind = 0; kind < std::size(placeholderStr); kind++) {
+			if (source.substr(pos, placeholderStr[kind].size()) == placeholderStr[kind]) {
+				lib.placeholders.push_back({ pos, ShaderPlaceholder::Kind(kind) });
 			}
+		}
+	}
 
-			ss.scan(); // remove (
-			ss.skipSpaces();
+	GlslTokenizer tokens{ source };
 
-			ShaderFunction func{};
-			func.name = identifier;
-			func.stringIndex = pos;
+	// looking for "<qualifiers> type name ( params ) {" at the top level
+	size_t declStart = std::string::npos;
+	GlslToken type{}, name{};
 
-			// read parameters
-			while (ss.peek() != ')') {
+	for (auto tok = tokens.next(); tok.kind != GlslToken::end; tok = tokens.next()) {
+		if (tok.depth > 0) continue; // struct bodies and such
 
-				// read param
-				std::vector<std::string> paramStr;
-				while (ss.peek() != ',' && ss.peek() != ')') {
-					paramStr.push_back(ss.scanWhile(identifierName));
-					ss.skipSpaces();
-				}
-				if (ss.peek() == ',') ss.scan(); // remove ,
-				ss.skipSpaces();
-
-				ShaderFunctionParam param;
-
-				switch (paramStr.size()) {
-					default: continue; break;
-					case 2: {
-						param.qualifier = ShaderFunctionParam::none;
-						for (size_t i = 0; i < std::size(typeStr); i++) {
-							if (typeStr[i] == paramStr[0]) {
-								param.type = ValueType(i);
-								break;
-							}
-						}
-						param.name = paramStr[1];
-					} break;
-					case 3: { // has qualifier
-						param.qualifier = ShaderFunctionParam::none;
-						if (paramStr[0] == "in") param.qualifier = ShaderFunctionParam::in;
-						else if (paramStr[0] == "out") param.qualifier = ShaderFunctionParam::out;
-
-						for (size_t i = 0; i < std::size(typeStr); i++) {
-							if (typeStr[i] == paramStr[1]) {
-								param.type = ValueType(i);
-								break;
-							}
-						}
-						param.name = paramStr[2];
-					} break;
+		if (tok.kind == GlslToken::identifier) {
+			if (declStart == std::string::npos) declStart = tok.offset;
+			type = name;
+			name = tok;
+			continue;
+		}
+
+		if (!tok.is('(') || type.kind != GlslToken::identifier) { // anything else isn't a function head
+			declStart = std::string::npos;
+			type = name = {};
+			continue;
+		}
+
+		ShaderFunction func{};
+		func.name = name.text;
+		func.stringIndex = declStart;
+
+		// read parameters
+		std::vector<std::string_view> words;
+		int parens = 0;
+		for (tok = tokens.next(); tok.kind != GlslToken::end; tok = tokens.next()) {
+			if (tok.is('(')) parens++;
+			else if (tok.is(')') && parens > 0) parens--;
+			else if ((tok.is(',') || tok.is(')')) && parens == 0) {
+				if (words.size() >= 2) {
+					auto param = parseParameter(words);
+					func.parameters[param.name] = param;
+					func.parameterOrder.push_back(param);
 				}
+				words.clear();
+				if (tok.is(')')) break;
+			}
+			else if (tok.kind == GlslToken::identifier && parens == 0) words.push_back(tok.text);
+		}
 
-				func.parameters[param.name] = param;
-				func.parameterOrder.push_back(param.name);
+		// read the body for calls, a prototype isn't worth keeping
+		tok = tokens.next();
+		if (tok.is('{')) {
+			GlslToken prev{};
+			for (tok = tokens.next(); tok.kind != GlslToken::end && !(tok.is('}') && tok.depth == 0); tok = tokens.next()) {
+				if (tok.is('(') && prev.kind == GlslToken::identifier) {
+					if (std::find(func.calls.begin(), func.calls.end(), prev.text) == func.calls.end()) {
+						func.calls.emplace_back(prev.text);
+					}
+				}
+				prev = tok;
+				func.bodyTokens++;
 			}
 
-			ss.skipSpaces();
-			ss.scan(); // remove )
+			func.stringLength = tokens.position() - func.stringIndex;
 
-			ss.skipSpaces();
+			auto first = std::lower_bound(lib.placeholders.begin(), lib.placeholders.end(), func.stringIndex,
+				[](const ShaderPlaceholder& ph, size_t offset) { return ph.offset < offset; });
+			auto last = std::lower_bound(first, lib.placeholders.end(), func.stringIndex + func.stringLength,
+				[](const ShaderPlaceholder& ph, size_t offset) { return ph.offset < offset; });
+			func.placeholderBegin = std::distance(lib.placeholders.begin(), first);
+			func.placeholderEnd = std::distance(lib.placeholders.begin(), last);
 
-			// skip function body
-			int braceCount = 0;
-			if (ss.scan() == '{') {
-				braceCount++;
+			lib.functions[func.name] = std::move(func);
+		}
 
-				while (true) {
-					char bc = ss.scan();
-					if (bc == '{') braceCount++;
-					else if (bc == '}') braceCount--;
+		declStart = std::string::npos;
+		type = name = {};
+	}
 
-					if (braceCount <= 0) break;
-				}
+	return lib;
+}
 
-				if (ss.peek() == '}') ss.scan();
-			}
+size_t ShaderLibrary::cost(const std::string& function) const {
+	std::vector<const ShaderFunction*> stack;
+	std::unordered_set<const ShaderFunction*> counted;
+	if (auto func = functions.find(function); func != functions.end()) stack.push_back(&func->second);
+
+	size_t total = 0;
+	while (!stack.empty()) {
+		auto func = stack.back(); stack.pop_back();
+		if (!counted.insert(func).second) continue;
+
+		total += func->bodyTokens;
+		for (auto&& call : func->calls) {
+			if (auto callee = functions.find(call); callee != functions.end()) stack.push_back(&callee->second);
+		}
+	}
+	return total;
+}
+
+size_t ShaderLibrary::treeSamples(const std::string& function) const {
+	auto func = functions.find(function);
+	if (func == functions.end()) return 0;
 
-			func.stringLength = ss.position() - func.stringIndex;
-			m_shaderLib[func.name] = func;
+	return std::count_if(
+		placeholders.begin() + func->second.placeholderBegin,
+		placeholders.begin() + func->second.placeholderEnd,
+		[](const ShaderPlaceholder& ph) { return ph.kind == ShaderPlaceholder::tree; }
+	);
+}
+
+std::string ShaderGen::instantiate(std::string_view text, size_t nodeId, std::string_view treeName) {
+	std::string ret;
+	ret.reserve(text.size());
 
-			ss.skipSpaces();
+	for (size_t pos = 0; pos < text.size();) {
+		size_t next = text.find('$', pos);
+		ret += text.substr(pos, next - pos);
+		if (next == std::string_view::npos) break;
+
+		auto rest = text.substr(next);
+		if (rest.starts_with(placeholderStr[ShaderPlaceholder::node])) {
+			ret += std::to_string(nodeId);
+			pos = next + placeholderStr[ShaderPlaceholder::node].size();
+		}
+		else if (rest.starts_with(placeholderStr[ShaderPlaceholder::tree])) {
+			ret += treeName;
+			pos = next + placeholderStr[ShaderPlaceholder::tree].size();
 		}
+		else {
+			ret += '$';
+			pos = next + 1;
+		}
+	}
+	return ret;
+}
+
+void ShaderGen::loadLib(const ShaderLibrary& lib) {
+	if (std::find(m_libraries.begin(), m_libraries.end(), &lib) != m_libraries.end()) {
+		return;
+	}
+	m_libraries.push_back(&lib);
+
+	for (auto&& [name, func] : lib.functions) {
+		m_shaderLib.insert_or_assign(std::string_view(name), LoadedFunction{ &lib, &func });
 	}
 }
 
+void ShaderGen::loadLib(const std::string& src) {
+	m_ownedLibraries.push_back(std::make_shared<const ShaderLibrary>(parseLib(src)));
+	loadLib(*m_ownedLibraries.back());
+}
+
+const ShaderFunction& ShaderGen::getFunction(const std::string& name) {
+	static const ShaderFunction notFound{};
+	auto found = m_shaderLib.find(name);
+	return found == m_shaderLib.end() ? notFound : *found->second.function;
+}
+
 void ShaderGen::beginCodeBlock() {
 	m_userCodeBlocks.push("");
 }
@@ -127,48 +215,35 @@ void ShaderGen::endFunctionBlock(Target target) {
 	m_targets[target] += "}\n";
 }
 
-void ShaderGen::pasteFunction(const std::string& funcName, const std::string& shaderCode) {
-	if (std::find(m_pasted.begin(), m_pasted.end(), funcName) != m_pasted.end()) {
+void ShaderGen::pasteFunction(const std::string& funcName, size_t nodeId, const std::string& treeName) {
+	auto found = m_shaderLib.find(funcName);
+	if (found == m_shaderLib.end()) { // not found? bleh
 		return;
 	}
 
-	if (m_shaderLib.find(funcName) == m_shaderLib.end()) { // not found? bleh
+	auto& [lib, func] = found->second;
+	bool templated = func->placeholderBegin != func->placeholderEnd;
+	if (!m_pasted.insert(templated ? instantiate(funcName, nodeId, treeName) : funcName).second) {
 		return;
 	}
 
-	auto func = m_shaderLib[funcName];
-	auto src = shaderCode.substr(func.stringIndex, func.stringLength);
-
-	// check for dependent functions
-	const std::regex identifierName("[a-zA-Z0-9_]");
-	StringScanner ss{ src };
-
-	while (ss.peek()) {
-		size_t pos = ss.position();
-		char c = ss.scan();
-
-		if (std::isalpha(c)) { // check for functions
-			std::string identifier = c + ss.scanWhile(identifierName);
-			ss.skipSpaces();
-
-			if (ss.peek() != '(') { // expect function signature, otherwise it's not a function.
-				continue;
-			}
-
-			while (ss.peek() != ')' && ss.peek() != 0) ss.scan();
-			if (ss.peek() == ')') ss.scan();
-			ss.skipSpaces();
-
-			if (ss.peek() == ';') {
-				pasteFunction(identifier, shaderCode);
-			}
-		}
+	// functions called in the body go first
+	for (auto&& call : func->calls) {
+		pasteFunction(call, nodeId, treeName);
 	}
 
-	m_targets[Target::definitions] += src;
-	m_targets[Target::definitions] += "\n\n";
-
-	m_pasted.push_back(funcName);
+	auto&& defs = m_targets[Target::definitions];
+	const std::string_view source = lib->source;
+	size_t pos = func->stringIndex;
+	for (size_t i = func->placeholderBegin; i < func->placeholderEnd; i++) {
+		auto&& ph = lib->placeholders[i];
+		defs += source.substr(pos, ph.offset - pos);
+		if (ph.kind == ShaderPlaceholder::node) defs += std::to_string(nodeId);
+		else defs += treeName;
+		pos = ph.offset + placeholderStr[ph.kind].size();
+	}
+	defs += source.substr(pos, func->stringIndex + func->stringLength - pos);
+	defs += "\n\n";
 }
 
 void ShaderGen::convertType(ValueType from, ValueType to, const std::string& varName) {
@@ -208,9 +283,9 @@ void ShaderGen::convertType(ValueType from, ValueType to, const std::string& var
 	}
 }
 
-std::string ShaderGen::appendUniform(ValueType type, const std::string& name, size_t binding) {
+std::string ShaderGen::appendUniform(ValueType type, const std::string& name, size_t binding, StorageFormat format) {
 	if (type == ValueType::image) {
-		m_targets[Target::uniforms] += std::format("layout (rgba32f, binding={}) uniform image2D {};", binding, name);
+		m_targets[Target::uniforms] += std::format("layout ({}, binding={}) uniform image2D {};", formatInfo(format).qualifier, binding, name);
 	}
 	else {
 		m_targets[Target::uniforms] += std::format("uniform {} {};", typeStr[size_t(type)], name);
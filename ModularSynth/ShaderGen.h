@@ -1,11 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <regex>
+#include <unordered_set>
+#include <memory>
 #include <stack>
 
 #include "NodeGraph.h"
+#include "StorageFormat.h"
 
 const std::string typeStr[] = {
 	"", "float", "vec2", "vec3", "vec4", "image2D"
@@ -14,7 +19,9 @@ const std::string typeStr[] = {
 const std::string shaderTemplate = R"(#version 460
 layout (local_size_x=16, local_size_y=16) in;
 
-uniform vec2 bOutputSize;
+uniform vec2 bOutputSize; // of the whole image
+uniform ivec2 bTileOrigin; // the invocations cover this part of it
+uniform ivec2 bTileSize;
 
 <uniforms>
 
@@ -42,6 +49,33 @@ float rand(vec2 n) {
 	return fract(sin(dot(n, vec2(12.9898, 4.1414))) * 43758.5453);
 }
 
+// integer hashes, the same bits as IntHash.h on the CPU. A cell is a
+// floor()ed coordinate, the unit floats keep the top 24 bits
+uint xxhash32(uvec2 v) {
+	uint h = 374761393u + 8u;
+	h += v.x * 3266489917u; h = ((h << 17) | (h >> 15)) * 668265263u;
+	h += v.y * 3266489917u; h = ((h << 17) | (h >> 15)) * 668265263u;
+	h ^= h >> 15; h *= 2246822519u;
+	h ^= h >> 13; h *= 3266489917u;
+	return h ^ (h >> 16);
+}
+
+uvec3 pcg3d(uvec3 v) {
+	v = v * 1664525u + 1013904223u;
+	v.x += v.y * v.z; v.y += v.z * v.x; v.z += v.x * v.y;
+	v ^= v >> 16u;
+	v.x += v.y * v.z; v.y += v.z * v.x; v.z += v.x * v.y;
+	return v;
+}
+
+float irand(vec2 cell) {
+	return float(xxhash32(uvec2(ivec2(floor(cell)))) >> 8u) * (1.0 / 16777216.0);
+}
+
+vec3 ihash3(vec2 cell) {
+	return vec3(pcg3d(uvec3(ivec2(floor(cell)), 0)) >> 8u) * (1.0 / 16777216.0);
+}
+
 float rgb_to_float(vec3 color) {
 	return color.r * 0.2126 + color.g * 0.7152 + color.b * 0.0722;
 }
@@ -54,7 +88,8 @@ float rgba_to_float(vec4 color) {
 
 void main() {
 	ivec2 cCoords = ivec2(gl_GlobalInvocationID.xy);
-	vec2 cUV = vec2(cCoords) / vec2(gl_NumWorkGroups.xy * 16);
+	if (any(greaterThanEqual(cCoords, bTileSize))) return;
+	vec2 cUV = vec2(cCoords + bTileOrigin) / bOutputSize;
 	
 <body>
 }
@@ -68,13 +103,44 @@ struct ShaderFunctionParam {
 		out
 	} qualifier;
 	std::string name;
+	Symbol symbol;
 };
 
 struct ShaderFunction {
 	std::string name;
 	std::unordered_map<std::string, ShaderFunctionParam> parameters;
-	std::vector<std::string> parameterOrder;
+	std::vector<ShaderFunctionParam> parameterOrder;
+	std::vector<std::string> calls; // functions called in the body, in order
+	size_t bodyTokens{ 0 }; // a rough measure of what the body costs to run
 	size_t stringIndex{ 0 }, stringLength{ 0 };
+	size_t placeholderBegin{ 0 }, placeholderEnd{ 0 }; // range in ShaderLibrary::placeholders
+};
+
+// $NODE (node id) and $TREE (multipass subtree function) in a node library
+struct ShaderPlaceholder {
+	enum Kind : uint8_t {
+		node = 0,
+		tree
+	};
+
+	size_t offset;
+	Kind kind;
+};
+
+constexpr std::string_view placeholderStr[] = { "$NODE", "$TREE" };
+
+// a parsed node library, immutable once parsed
+struct ShaderLibrary {
+	std::string source;
+	std::unordered_map<std::string, ShaderFunction> functions;
+	std::vector<ShaderPlaceholder> placeholders; // sorted by offset
+	uint64_t hash{ 0 }; // of the source, see StructureHash
+
+	// body tokens of the function and of everything it calls in this library
+	size_t cost(const std::string& function) const;
+
+	// how many times the function evaluates $TREE
+	size_t treeSamples(const std::string& function) const;
 };
 
 class ShaderGen {
@@ -85,6 +151,13 @@ public:
 		uniforms
 	};
 
+	static ShaderLibrary parseLib(std::string src);
+
+	// replaces the placeholders in a short piece of text, like a function name
+	static std::string instantiate(std::string_view text, size_t nodeId, std::string_view treeName = "");
+
+	// makes the library's functions available, it has to outlive the generator
+	void loadLib(const ShaderLibrary& lib);
 	void loadLib(const std::string& src);
 
 	void beginCodeBlock();
@@ -93,8 +166,9 @@ public:
 	void beginFunctionBlock(const std::string& signature);
 	void endFunctionBlock(Target target);
 
-	void pasteFunction(const std::string& funcName, const std::string& shaderCode);
-	std::string appendUniform(ValueType type, const std::string& name, size_t binding = 0);
+	// funcName is the name in the library, placeholders and all
+	void pasteFunction(const std::string& funcName, size_t nodeId = 0, const std::string& treeName = "");
+	std::string appendUniform(ValueType type, const std::string& name, size_t binding = 0, StorageFormat format = StorageFormat::rgba32f);
 
 	void append(const std::string& str);
 	std::string appendVariable(ValueType type, const std::string& name);
@@ -103,65 +177,142 @@ public:
 
 	std::string generate();
 
-	const ShaderFunction& getFunction(const std::string& name) { return m_shaderLib[name]; }
+	const ShaderFunction& getFunction(const std::string& name);
 	std::string& target(Target target) { return m_targets[target]; }
 
 protected:
+	struct LoadedFunction {
+		const ShaderLibrary* library;
+		const ShaderFunction* function;
+	};
+
 	std::unordered_map<Target, std::string> m_targets;
 	std::stack<std::string> m_userCodeBlocks;
 
 	size_t m_tmpIndex{ 0 };
 
-	std::unordered_map<std::string, ShaderFunction> m_shaderLib;
-	std::vector<std::string> m_pasted;
+	std::vector<const ShaderLibrary*> m_libraries;
+	std::vector<std::shared_ptr<const ShaderLibrary>> m_ownedLibraries; // parsed by loadLib(src)
+	std::unordered_map<std::string_view, LoadedFunction> m_shaderLib;
+	std::unordered_set<std::string> m_pasted;
 
 
 };
 
-template <typename Char = char>
-class StringScanner {
-public:
-	using Str = std::basic_string<Char>;
-	using RegExp = std::basic_regex<Char>;
+/*
+ * GLSL tokenizer
+ * ====================================================
+ * One pass over the source without copying: tokens are views into it.
+ * Whitespace and comments are skipped, a preprocessor line comes out as a
+ * single token and operators come out one character at a time, the parsers
+ * only care about ( ) { } , ; anyway.
+ */
+struct GlslToken {
+	enum Kind : uint8_t {
+		end = 0,
+		identifier,
+		number,
+		punctuation,
+		preprocessor
+	};
 
-	StringScanner() = default;
-	StringScanner(const Str& input) {
-		m_data = std::vector<Char>(input.begin(), input.end());
-	}
+	Kind kind{ end };
+	std::string_view text;
+	size_t offset{ 0 };
+	int depth{ 0 }; // brace depth, a brace itself counts as the outer level
 
-	Char peek(size_t offset = 0) const { return m_data.empty() ? '\0' : m_data[offset]; }
-	Char scan() {
-		if (m_data.empty()) return '\0';
-		Char tmp = m_data.front();
-		m_data.erase(m_data.begin());
-		m_position++;
-		return tmp;
-	}
+	bool is(char c) const { return kind == punctuation && text[0] == c; }
 
-	std::string scanWhile(RegExp re) {
-		std::string ret = "";
-		while (peek() != '\0' && std::regex_match(Str(1, peek()), re)) {
-			ret += scan();
-		}
-		return ret;
+	bool qualifier() const {
+		static constexpr std::string_view qualifiers[] = {
+			"const", "in", "out", "inout", "highp", "mediump", "lowp", "precise",
+			"coherent", "volatile", "restrict", "readonly", "writeonly"
+		};
+		if (kind != identifier) return false;
+		return std::find(std::begin(qualifiers), std::end(qualifiers), text) != std::end(qualifiers);
 	}
+};
 
-	std::string peekWhile(RegExp re) {
-		std::string ret = "";
-		size_t offset = 0;
-		while (peek(offset) != '\0' && std::regex_match(Str(1, peek(offset)), re)) {
-			ret += peek(offset++);
+class GlslTokenizer {
+public:
+	GlslTokenizer(std::string_view src) : m_src(src) {}
+
+	GlslToken next() {
+		skipSpaces();
+
+		GlslToken tok{};
+		tok.offset = m_pos;
+		tok.depth = m_depth;
+		if (m_pos >= m_src.size()) return tok;
+
+		char c = m_src[m_pos];
+		if (identStart(c)) {
+			tok.kind = GlslToken::identifier;
+			while (m_pos < m_src.size() && identChar(m_src[m_pos])) m_pos++;
+		}
+		else if (digit(c) || (c == '.' && digit(at(m_pos + 1)))) {
+			tok.kind = GlslToken::number;
+			bool hex = c == '0' && (at(m_pos + 1) == 'x' || at(m_pos + 1) == 'X');
+			m_pos++;
+			while (m_pos < m_src.size()) {
+				char n = m_src[m_pos];
+				char p = m_src[m_pos - 1];
+				bool exponentSign = !hex && (n == '+' || n == '-') && (p == 'e' || p == 'E');
+				if (!identChar(n) && n != '.' && !exponentSign) break;
+				m_pos++;
+			}
+		}
+		else if (c == '#') {
+			tok.kind = GlslToken::preprocessor;
+			while (m_pos < m_src.size() && m_src[m_pos] != '\n') {
+				if (m_src[m_pos] == '\\') m_pos++; // line continuation
+				m_pos++;
+			}
+			m_pos = std::min(m_pos, m_src.size());
+		}
+		else {
+			tok.kind = GlslToken::punctuation;
+			m_pos++;
+			if (c == '{') m_depth++;
+			else if (c == '}' && m_depth > 0) tok.depth = --m_depth;
 		}
-		return ret;
-	}
 
-	void skipSpaces() {
-		scanWhile(std::basic_regex<Char>("\\s"));
+		tok.text = m_src.substr(tok.offset, m_pos - tok.offset);
+		return tok;
 	}
 
-	size_t position() const { return m_position; }
+	GlslToken peek() const { return GlslTokenizer{ *this }.next(); }
+
+	size_t position() const { return m_pos; }
+	int depth() const { return m_depth; }
 
 private:
-	std::vector<Char> m_data;
-	size_t m_position{ 0 };
+	std::string_view m_src;
+	size_t m_pos{ 0 };
+	int m_depth{ 0 };
+
+	static bool digit(char c) { return c >= '0' && c <= '9'; }
+	// $ isn't GLSL, it's allowed so placeholders like emit_out_$NODE stay one identifier
+	static bool identStart(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '$'; }
+	static bool identChar(char c) { return identStart(c) || digit(c); }
+
+	char at(size_t pos) const { return pos < m_src.size() ? m_src[pos] : '\0'; }
+
+	void skipSpaces() {
+		while (m_pos < m_src.size()) {
+			char c = m_src[m_pos];
+			if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v') {
+				m_pos++;
+			}
+			else if (c == '/' && at(m_pos + 1) == '/') {
+				m_pos = m_src.find('\n', m_pos);
+				if (m_pos == std::string_view::npos) m_pos = m_src.size();
+			}
+			else if (c == '/' && at(m_pos + 1) == '*') {
+				m_pos = m_src.find("*/", m_pos + 2);
+				m_pos = m_pos == std::string_view::npos ? m_src.size() : m_pos + 2;
+			}
+			else break;
+		}
+	}
 };
@@ -0,0 +1,447 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <cstring>
+
+#if defined(SIMD_FORCE_SCALAR) // to check the kernels against the plain lanes
+	#define SIMD_SCALAR 1
+#elif defined(__AVX2__)
+	#include <immintrin.h>
+	#define SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+	#include <arm_neon.h>
+	#define SIMD_NEON 1
+#else
+	#define SIMD_SCALAR 1
+#endif
+
+/*
+ * SIMD lanes
+ * ====================================================
+ * A batch of 8 floats and the math the node kernels need on them, one pixel
+ * per lane. The instruction set is picked when compiling: AVX2 (one 256 bit
+ * register), SSE2 and NEON (two 128 bit registers each) or plain arrays.
+ *
+ * Only the primitives differ per instruction set, the rest (sin, exp2, ...)
+ * is written once on top of them. The transcendentals are polynomials good
+ * to a few ulp over the ranges the kernels use; they are not std::sin.
+ */
+namespace simd {
+
+constexpr size_t width = 8;
+
+#if SIMD_AVX2
+constexpr const char* isa = "avx2";
+#elif SIMD_SSE2
+constexpr const char* isa = "sse2";
+#elif SIMD_NEON
+constexpr const char* isa = "neon";
+#else
+constexpr const char* isa = "scalar";
+#endif
+
+struct Float;
+struct Int;
+
+// lanes that passed a comparison, all bits set or all clear
+struct Mask {
+#if SIMD_AVX2
+	__m256 v;
+#elif SIMD_SSE2
+	__m128 v[2];
+#elif SIMD_NEON
+	uint32x4_t v[2];
+#else
+	bool v[width];
+#endif
+};
+
+struct Float {
+#if SIMD_AVX2
+	__m256 v;
+#elif SIMD_SSE2
+	__m128 v[2];
+#elif SIMD_NEON
+	float32x4_t v[2];
+#else
+	float v[width];
+#endif
+
+	Float() = default;
+	Float(float x) { *this = broadcast(x); }
+
+	static Float broadcast(float x) {
+		Float r;
+#if SIMD_AVX2
+		r.v = _mm256_set1_ps(x);
+#elif SIMD_SSE2
+		r.v[0] = r.v[1] = _mm_set1_ps(x);
+#elif SIMD_NEON
+		r.v[0] = r.v[1] = vdupq_n_f32(x);
+#else
+		for (size_t i = 0; i < width; i++) r.v[i] = x;
+#endif
+		return r;
+	}
+
+	static Float load(const float* p) {
+		Float r;
+#if SIMD_AVX2
+		r.v = _mm256_loadu_ps(p);
+#elif SIMD_SSE2
+		r.v[0] = _mm_loadu_ps(p);
+		r.v[1] = _mm_loadu_ps(p + 4);
+#elif SIMD_NEON
+		r.v[0] = vld1q_f32(p);
+		r.v[1] = vld1q_f32(p + 4);
+#else
+		std::memcpy(r.v, p, sizeof(r.v));
+#endif
+		return r;
+	}
+
+	void store(float* p) const {
+#if SIMD_AVX2
+		_mm256_storeu_ps(p, v);
+#elif SIMD_SSE2
+		_mm_storeu_ps(p, v[0]);
+		_mm_storeu_ps(p + 4, v[1]);
+#elif SIMD_NEON
+		vst1q_f32(p, v[0]);
+		vst1q_f32(p + 4, v[1]);
+#else
+		std::memcpy(p, v, sizeof(v));
+#endif
+	}
+
+	// 0, 1, 2 ... across the lanes
+	static Float ramp() {
+		alignas(32) static const float values[width] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+		return load(values);
+	}
+};
+
+// 32 bit integers in the same lanes, for the bit tricks of exp2 and log2
+// and the integer hashes. They wrap, and >> is arithmetic
+struct Int {
+#if SIMD_AVX2
+	__m256i v;
+#elif SIMD_SSE2
+	__m128i v[2];
+#elif SIMD_NEON
+	int32x4_t v[2];
+#else
+	int32_t v[width];
+#endif
+
+	Int() = default;
+	Int(int32_t x) {
+#if SIMD_AVX2
+		v = _mm256_set1_epi32(x);
+#elif SIMD_SSE2
+		v[0] = v[1] = _mm_set1_epi32(x);
+#elif SIMD_NEON
+		v[0] = v[1] = vdupq_n_s32(x);
+#else
+		for (size_t i = 0; i < width; i++) v[i] = x;
+#endif
+	}
+};
+
+// applies a 128 bit op to both halves
+#if SIMD_SSE2 || SIMD_NEON
+	#define SIMD_HALVES(T, a, b, op) T r; r.v[0] = op((a).v[0], (b).v[0]); r.v[1] = op((a).v[1], (b).v[1]); return r
+	#define SIMD_HALVES1(T, a, op) T r; r.v[0] = op((a).v[0]); r.v[1] = op((a).v[1]); return r
+#endif
+
+#if SIMD_AVX2
+inline Float operator+(Float a, Float b) { Float r; r.v = _mm256_add_ps(a.v, b.v); return r; }
+inline Float operator-(Float a, Float b) { Float r; r.v = _mm256_sub_ps(a.v, b.v); return r; }
+inline Float operator*(Float a, Float b) { Float r; r.v = _mm256_mul_ps(a.v, b.v); return r; }
+inline Float operator/(Float a, Float b) { Float r; r.v = _mm256_div_ps(a.v, b.v); return r; }
+inline Float min(Float a, Float b) { Float r; r.v = _mm256_min_ps(a.v, b.v); return r; }
+inline Float max(Float a, Float b) { Float r; r.v = _mm256_max_ps(a.v, b.v); return r; }
+inline Float sqrt(Float a) { Float r; r.v = _mm256_sqrt_ps(a.v); return r; }
+inline Float floor(Float a) { Float r; r.v = _mm256_floor_ps(a.v); return r; }
+inline Float abs(Float a) { Float r; r.v = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); return r; }
+
+inline Mask operator<(Float a, Float b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+inline Mask operator<=(Float a, Float b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+inline Mask operator>(Float a, Float b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+inline Mask operator>=(Float a, Float b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+inline Mask operator==(Float a, Float b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ) }; }
+inline Mask operator&(Mask a, Mask b) { return { _mm256_and_ps(a.v, b.v) }; }
+inline Mask operator|(Mask a, Mask b) { return { _mm256_or_ps(a.v, b.v) }; }
+
+// a where the mask is set, b elsewhere
+inline Float select(Mask m, Float a, Float b) { Float r; r.v = _mm256_blendv_ps(b.v, a.v, m.v); return r; }
+
+inline Int toInt(Float a) { Int r; r.v = _mm256_cvtps_epi32(a.v); return r; } // rounds to nearest
+inline Float toFloat(Int a) { Float r; r.v = _mm256_cvtepi32_ps(a.v); return r; }
+inline Int asInt(Float a) { Int r; r.v = _mm256_castps_si256(a.v); return r; }
+inline Float asFloat(Int a) { Float r; r.v = _mm256_castsi256_ps(a.v); return r; }
+inline Int operator+(Int a, Int b) { Int r; r.v = _mm256_add_epi32(a.v, b.v); return r; }
+inline Int operator-(Int a, Int b) { Int r; r.v = _mm256_sub_epi32(a.v, b.v); return r; }
+inline Int operator&(Int a, Int b) { Int r; r.v = _mm256_and_si256(a.v, b.v); return r; }
+inline Int operator|(Int a, Int b) { Int r; r.v = _mm256_or_si256(a.v, b.v); return r; }
+inline Int operator^(Int a, Int b) { Int r; r.v = _mm256_xor_si256(a.v, b.v); return r; }
+inline Int operator*(Int a, Int b) { Int r; r.v = _mm256_mullo_epi32(a.v, b.v); return r; } // the low 32 bits
+inline Int operator<<(Int a, int n) { Int r; r.v = _mm256_slli_epi32(a.v, n); return r; }
+inline Int operator>>(Int a, int n) { Int r; r.v = _mm256_srai_epi32(a.v, n); return r; }
+inline Mask operator==(Int a, Int b) { return { _mm256_castsi256_ps(_mm256_cmpeq_epi32(a.v, b.v)) }; }
+
+inline bool any(Mask m) { return _mm256_movemask_ps(m.v) != 0; }
+inline bool all(Mask m) { return _mm256_movemask_ps(m.v) == 0xFF; }
+
+#elif SIMD_SSE2
+inline Float operator+(Float a, Float b) { SIMD_HALVES(Float, a, b, _mm_add_ps); }
+inline Float operator-(Float a, Float b) { SIMD_HALVES(Float, a, b, _mm_sub_ps); }
+inline Float operator*(Float a, Float b) { SIMD_HALVES(Float, a, b, _mm_mul_ps); }
+inline Float operator/(Float a, Float b) { SIMD_HALVES(Float, a, b, _mm_div_ps); }
+inline Float min(Float a, Float b) { SIMD_HALVES(Float, a, b, _mm_min_ps); }
+inline Float max(Float a, Float b) { SIMD_HALVES(Float, a, b, _mm_max_ps); }
+inline Float sqrt(Float a) { SIMD_HALVES1(Float, a, _mm_sqrt_ps); }
+inline Float abs(Float a) { Float sign = Float::broadcast(-0.0f); SIMD_HALVES(Float, sign, a, _mm_andnot_ps); }
+
+inline Mask operator<(Float a, Float b) { SIMD_HALVES(Mask, a, b, _mm_cmplt_ps); }
+inline Mask operator<=(Float a, Float b) { SIMD_HALVES(Mask, a, b, _mm_cmple_ps); }
+inline Mask operator>(Float a, Float b) { SIMD_HALVES(Mask, a, b, _mm_cmpgt_ps); }
+inline Mask operator>=(Float a, Float b) { SIMD_HALVES(Mask, a, b, _mm_cmpge_ps); }
+inline Mask operator==(Float a, Float b) { SIMD_HALVES(Mask, a, b, _mm_cmpeq_ps); }
+inline Mask operator&(Mask a, Mask b) { SIMD_HALVES(Mask, a, b, _mm_and_ps); }
+inline Mask operator|(Mask a, Mask b) { SIMD_HALVES(Mask, a, b, _mm_or_ps); }
+
+inline __m128 selectHalf(__m128 m, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+inline Float select(Mask m, Float a, Float b) {
+	Float r;
+	r.v[0] = selectHalf(m.v[0], a.v[0], b.v[0]);
+	r.v[1] = selectHalf(m.v[1], a.v[1], b.v[1]);
+	return r;
+}
+
+inline Int toInt(Float a) { SIMD_HALVES1(Int, a, _mm_cvtps_epi32); }
+inline Float toFloat(Int a) { SIMD_HALVES1(Float, a, _mm_cvtepi32_ps); }
+inline Int asInt(Float a) { SIMD_HALVES1(Int, a, _mm_castps_si128); }
+inline Float asFloat(Int a) { SIMD_HALVES1(Float, a, _mm_castsi128_ps); }
+inline Int operator+(Int a, Int b) { SIMD_HALVES(Int, a, b, _mm_add_epi32); }
+inline Int operator-(Int a, Int b) { SIMD_HALVES(Int, a, b, _mm_sub_epi32); }
+inline Int operator&(Int a, Int b) { SIMD_HALVES(Int, a, b, _mm_and_si128); }
+inline Int operator|(Int a, Int b) { SIMD_HALVES(Int, a, b, _mm_or_si128); }
+inline Int operator^(Int a, Int b) { SIMD_HALVES(Int, a, b, _mm_xor_si128); }
+
+// no 32 bit multiply before SSE4.1: the even and odd lanes as 64 bit products, low halves put back together
+inline __m128i mulLow(__m128i a, __m128i b) {
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+inline Int operator*(Int a, Int b) { SIMD_HALVES(Int, a, b, mulLow); }
+inline Int operator<<(Int a, int n) { Int r; r.v[0] = _mm_slli_epi32(a.v[0], n); r.v[1] = _mm_slli_epi32(a.v[1], n); return r; }
+inline Int operator>>(Int a, int n) { Int r; r.v[0] = _mm_srai_epi32(a.v[0], n); r.v[1] = _mm_srai_epi32(a.v[1], n); return r; }
+inline Mask operator==(Int a, Int b) {
+	Mask r;
+	r.v[0] = _mm_castsi128_ps(_mm_cmpeq_epi32(a.v[0], b.v[0]));
+	r.v[1] = _mm_castsi128_ps(_mm_cmpeq_epi32(a.v[1], b.v[1]));
+	return r;
+}
+
+inline bool any(Mask m) { return (_mm_movemask_ps(m.v[0]) | _mm_movemask_ps(m.v[1])) != 0; }
+inline bool all(Mask m) { return (_mm_movemask_ps(m.v[0]) & _mm_movemask_ps(m.v[1])) == 0xF; }
+
+// SSE2 has no floor: truncate, then step down where that went up
+inline Float floor(Float a) {
+	Float t;
+	for (size_t i = 0; i < 2; i++) {
+		__m128 trunc = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v[i]));
+		__m128 over = _mm_and_ps(_mm_cmpgt_ps(trunc, a.v[i]), _mm_set1_ps(1.0f));
+		t.v[i] = _mm_sub_ps(trunc, over);
+	}
+	return t;
+}
+
+#elif SIMD_NEON
+inline Float operator+(Float a, Float b) { SIMD_HALVES(Float, a, b, vaddq_f32); }
+inline Float operator-(Float a, Float b) { SIMD_HALVES(Float, a, b, vsubq_f32); }
+inline Float operator*(Float a, Float b) { SIMD_HALVES(Float, a, b, vmulq_f32); }
+inline Float operator/(Float a, Float b) { SIMD_HALVES(Float, a, b, vdivq_f32); }
+inline Float min(Float a, Float b) { SIMD_HALVES(Float, a, b, vminq_f32); }
+inline Float max(Float a, Float b) { SIMD_HALVES(Float, a, b, vmaxq_f32); }
+inline Float sqrt(Float a) { SIMD_HALVES1(Float, a, vsqrtq_f32); }
+inline Float floor(Float a) { SIMD_HALVES1(Float, a, vrndmq_f32); }
+inline Float abs(Float a) { SIMD_HALVES1(Float, a, vabsq_f32); }
+
+inline Mask operator<(Float a, Float b) { SIMD_HALVES(Mask, a, b, vcltq_f32); }
+inline Mask operator<=(Float a, Float b) { SIMD_HALVES(Mask, a, b, vcleq_f32); }
+inline Mask operator>(Float a, Float b) { SIMD_HALVES(Mask, a, b, vcgtq_f32); }
+inline Mask operator>=(Float a, Float b) { SIMD_HALVES(Mask, a, b, vcgeq_f32); }
+inline Mask operator==(Float a, Float b) { SIMD_HALVES(Mask, a, b, vceqq_f32); }
+inline Mask operator&(Mask a, Mask b) { SIMD_HALVES(Mask, a, b, vandq_u32); }
+inline Mask operator|(Mask a, Mask b) { SIMD_HALVES(Mask, a, b, vorrq_u32); }
+
+inline Float select(Mask m, Float a, Float b) {
+	Float r;
+	r.v[0] = vbslq_f32(m.v[0], a.v[0], b.v[0]);
+	r.v[1] = vbslq_f32(m.v[1], a.v[1], b.v[1]);
+	return r;
+}
+
+inline Int toInt(Float a) { SIMD_HALVES1(Int, a, vcvtnq_s32_f32); }
+inline Float toFloat(Int a) { SIMD_HALVES1(Float, a, vcvtq_f32_s32); }
+inline Int asInt(Float a) { SIMD_HALVES1(Int, a, vreinterpretq_s32_f32); }
+inline Float asFloat(Int a) { SIMD_HALVES1(Float, a, vreinterpretq_f32_s32); }
+inline Int operator+(Int a, Int b) { SIMD_HALVES(Int, a, b, vaddq_s32); }
+inline Int operator-(Int a, Int b) { SIMD_HALVES(Int, a, b, vsubq_s32); }
+inline Int operator&(Int a, Int b) { SIMD_HALVES(Int, a, b, vandq_s32); }
+inline Int operator|(Int a, Int b) { SIMD_HALVES(Int, a, b, vorrq_s32); }
+inline Int operator^(Int a, Int b) { SIMD_HALVES(Int, a, b, veorq_s32); }
+inline Int operator*(Int a, Int b) { SIMD_HALVES(Int, a, b, vmulq_s32); }
+inline Int operator<<(Int a, int n) { Int r; r.v[0] = vshlq_s32(a.v[0], vdupq_n_s32(n)); r.v[1] = vshlq_s32(a.v[1], vdupq_n_s32(n)); return r; }
+inline Int operator>>(Int a, int n) { Int r; r.v[0] = vshlq_s32(a.v[0], vdupq_n_s32(-n)); r.v[1] = vshlq_s32(a.v[1], vdupq_n_s32(-n)); return r; }
+inline Mask operator==(Int a, Int b) { SIMD_HALVES(Mask, a, b, vceqq_s32); }
+
+// folded to two lanes, then one; the pairwise ops are on 32 bit ARM too
+inline bool any(Mask m) {
+	uint32x4_t x = vorrq_u32(m.v[0], m.v[1]);
+	uint32x2_t h = vpmax_u32(vget_low_u32(x), vget_high_u32(x));
+	return vget_lane_u32(vpmax_u32(h, h), 0) != 0;
+}
+inline bool all(Mask m) {
+	uint32x4_t x = vandq_u32(m.v[0], m.v[1]);
+	uint32x2_t h = vpmin_u32(vget_low_u32(x), vget_high_u32(x));
+	return vget_lane_u32(vpmin_u32(h, h), 0) != 0;
+}
+
+#else
+#define SIMD_LANES(T, expr) T r; for (size_t i = 0; i < width; i++) r.v[i] = (expr); return r
+
+inline Float operator+(Float a, Float b) { SIMD_LANES(Float, a.v[i] + b.v[i]); }
+inline Float operator-(Float a, Float b) { SIMD_LANES(Float, a.v[i] - b.v[i]); }
+inline Float operator*(Float a, Float b) { SIMD_LANES(Float, a.v[i] * b.v[i]); }
+inline Float operator/(Float a, Float b) { SIMD_LANES(Float, a.v[i] / b.v[i]); }
+inline Float min(Float a, Float b) { SIMD_LANES(Float, b.v[i] < a.v[i] ? b.v[i] : a.v[i]); }
+inline Float max(Float a, Float b) { SIMD_LANES(Float, b.v[i] > a.v[i] ? b.v[i] : a.v[i]); }
+inline Float sqrt(Float a) { SIMD_LANES(Float, std::sqrt(a.v[i])); }
+inline Float floor(Float a) { SIMD_LANES(Float, std::floor(a.v[i])); }
+inline Float abs(Float a) { SIMD_LANES(Float, std::fabs(a.v[i])); }
+
+inline Mask operator<(Float a, Float b) { SIMD_LANES(Mask, a.v[i] < b.v[i]); }
+inline Mask operator<=(Float a, Float b) { SIMD_LANES(Mask, a.v[i] <= b.v[i]); }
+inline Mask operator>(Float a, Float b) { SIMD_LANES(Mask, a.v[i] > b.v[i]); }
+inline Mask operator>=(Float a, Float b) { SIMD_LANES(Mask, a.v[i] >= b.v[i]); }
+inline Mask operator==(Float a, Float b) { SIMD_LANES(Mask, a.v[i] == b.v[i]); }
+inline Mask operator&(Mask a, Mask b) { SIMD_LANES(Mask, a.v[i] && b.v[i]); }
+inline Mask operator|(Mask a, Mask b) { SIMD_LANES(Mask, a.v[i] || b.v[i]); }
+inline Float select(Mask m, Float a, Float b) { SIMD_LANES(Float, m.v[i] ? a.v[i] : b.v[i]); }
+
+inline Int toInt(Float a) { SIMD_LANES(Int, int32_t(std::nearbyint(a.v[i]))); }
+inline Float toFloat(Int a) { SIMD_LANES(Float, float(a.v[i])); }
+inline Int asInt(Float a) { Int r; std::memcpy(r.v, a.v, sizeof(r.v)); return r; }
+inline Float asFloat(Int a) { Float r; std::memcpy(r.v, a.v, sizeof(r.v)); return r; }
+inline Int operator+(Int a, Int b) { SIMD_LANES(Int, int32_t(uint32_t(a.v[i]) + uint32_t(b.v[i]))); }
+inline Int operator-(Int a, Int b) { SIMD_LANES(Int, int32_t(uint32_t(a.v[i]) - uint32_t(b.v[i]))); }
+inline Int operator&(Int a, Int b) { SIMD_LANES(Int, a.v[i] & b.v[i]); }
+inline Int operator|(Int a, Int b) { SIMD_LANES(Int, a.v[i] | b.v[i]); }
+inline Int operator^(Int a, Int b) { SIMD_LANES(Int, a.v[i] ^ b.v[i]); }
+inline Int operator*(Int a, Int b) { SIMD_LANES(Int, int32_t(uint32_t(a.v[i]) * uint32_t(b.v[i]))); }
+inline Int operator<<(Int a, int n) { SIMD_LANES(Int, int32_t(uint32_t(a.v[i]) << n)); }
+inline Int operator>>(Int a, int n) { SIMD_LANES(Int, a.v[i] >> n); }
+inline Mask operator==(Int a, Int b) { SIMD_LANES(Mask, a.v[i] == b.v[i]); }
+
+inline bool any(Mask m) {
+	for (size_t i = 0; i < width; i++) if (m.v[i]) return true;
+	return false;
+}
+inline bool all(Mask m) {
+	for (size_t i = 0; i < width; i++) if (!m.v[i]) return false;
+	return true;
+}
+
+#undef SIMD_LANES
+#endif
+
+#undef SIMD_HALVES
+#undef SIMD_HALVES1
+
+// the rest is the same for every instruction set, GLSL's names and meanings
+
+inline Float operator-(Float a) { return Float(0.0f) - a; }
+inline Float& operator+=(Float& a, Float b) { return a = a + b; }
+inline Float& operator-=(Float& a, Float b) { return a = a - b; }
+inline Float& operator*=(Float& a, Float b) { return a = a * b; }
+inline Float& operator/=(Float& a, Float b) { return a = a / b; }
+inline Int& operator+=(Int& a, Int b) { return a = a + b; }
+inline Int& operator^=(Int& a, Int b) { return a = a ^ b; }
+
+inline Float fract(Float x) { return x - floor(x); }
+inline Float mod(Float x, Float y) { return x - y * floor(x / y); }
+inline Float clamp(Float x, Float lo, Float hi) { return min(max(x, lo), hi); }
+inline Float mix(Float a, Float b, Float t) { return a + (b - a) * t; }
+inline Float step(Float edge, Float x) { return select(x < edge, Float(0.0f), Float(1.0f)); }
+
+inline Float smoothstep(Float e0, Float e1, Float x) {
+	Float t = clamp((x - e0) / (e1 - e0), 0.0f, 1.0f);
+	return t * t * (Float(3.0f) - Float(2.0f) * t);
+}
+
+// reduced to [-pi/4, pi/4] around the nearest multiple of pi/2, in three
+// parts so the reduction stays exact for arguments in the thousands
+inline Float sinQuadrant(Float x, Int offset) {
+	Float j = floor(x * 0.636619772f + 0.5f);
+	Float y = x - j * 1.5703125f;
+	y = y - j * 4.837512969970703125e-4f;
+	y = y - j * 7.54978995489188216e-8f;
+	Int quadrant = (toInt(j) + offset) & Int(3);
+
+	Float z = y * y;
+	Float s = y + y * z * ((Float(-1.9515295891e-4f) * z + 8.3321608736e-3f) * z - 1.6666654611e-1f);
+	Float c = Float(1.0f) - z * 0.5f + z * z * ((Float(2.443315711809948e-5f) * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f);
+
+	Float r = select((quadrant & Int(1)) == Int(1), c, s);
+	return select((quadrant & Int(2)) == Int(2), -r, r);
+}
+
+inline Float sin(Float x) { return sinQuadrant(x, Int(0)); }
+inline Float cos(Float x) { return sinQuadrant(x, Int(1)); }
+
+// 2^x, the integer part goes in the exponent bits
+inline Float exp2(Float x) {
+	x = clamp(x, -126.0f, 126.0f);
+	Float i = floor(x + 0.5f);
+	Float f = x - i; // [-0.5, 0.5]
+	Float p = Float(1.5403530393381606e-4f);
+	p = p * f + 1.3333558146428443e-3f;
+	p = p * f + 9.6181291076284772e-3f;
+	p = p * f + 5.5504108664821580e-2f;
+	p = p * f + 2.4022650695910071e-1f;
+	p = p * f + 6.9314718055994531e-1f;
+	p = p * f + 1.0f;
+	return p * asFloat((toInt(i) + Int(127)) << 23);
+}
+
+// for x > 0, the exponent bits and a series for the mantissa in [0.707, 1.414]
+inline Float log2(Float x) {
+	Int bits = asInt(x);
+	Float e = toFloat((bits >> 23) - Int(127));
+	Float m = asFloat((bits & Int(0x007fffff)) | Int(0x3f800000));
+
+	Mask big = m > 1.41421356f;
+	m = select(big, m * 0.5f, m);
+	e = select(big, e + 1.0f, e);
+
+	Float t = (m - 1.0f) / (m + 1.0f);
+	Float t2 = t * t;
+	Float series = t * (Float(2.0f) + t2 * (Float(0.666666667f) + t2 * (Float(0.4f) + t2 * (Float(0.285714286f) + t2 * 0.222222222f))));
+	return e + series * 1.44269504f;
+}
+
+// GLSL leaves x < 0 undefined, 0 ^ y is 0 here for y > 0
+inline Float pow(Float x, Float y) {
+	return select(x == Float(0.0f), Float(0.0f), exp2(y * log2(x)));
+}
+
+} // namespace simd
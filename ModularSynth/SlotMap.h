@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+/*
+ * Generational slot map
+ * ====================================================
+ * Values are kept densely packed in one vector (iteration is a linear walk),
+ * handles point at a slot that knows where its value currently lives.
+ * Erasing moves the last value into the hole and bumps the slot generation,
+ * so every handle to the erased value becomes stale instead of dangling.
+ *
+ * A handle packs the generation in the high 32 bits and the slot index in the
+ * low 32 bits. Generations start at 1, so a valid handle is never 0.
+ */
+
+using SlotHandle = uint64_t;
+
+template <typename T>
+class SlotMap {
+public:
+	static constexpr SlotHandle invalidHandle = 0;
+
+	SlotHandle insert(T value) {
+		uint32_t slotIndex;
+		if (!m_freeSlots.empty()) {
+			slotIndex = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else {
+			slotIndex = uint32_t(m_slots.size());
+			m_slots.push_back({ .dense = 0, .generation = 1 });
+		}
+
+		Slot& slot = m_slots[slotIndex];
+		slot.dense = uint32_t(m_values.size());
+
+		m_values.push_back(std::move(value));
+		m_denseToSlot.push_back(slotIndex);
+
+		return makeHandle(slotIndex, slot.generation);
+	}
+
+	bool erase(SlotHandle handle) {
+		if (!contains(handle)) return false;
+
+		uint32_t slotIndex = indexOf(handle);
+		Slot& slot = m_slots[slotIndex];
+
+		// move the last value into the hole
+		uint32_t last = uint32_t(m_values.size() - 1);
+		if (slot.dense != last) {
+			m_values[slot.dense] = std::move(m_values[last]);
+			m_denseToSlot[slot.dense] = m_denseToSlot[last];
+			m_slots[m_denseToSlot[slot.dense]].dense = slot.dense;
+		}
+		m_values.pop_back();
+		m_denseToSlot.pop_back();
+
+		slot.generation++;
+		if (slot.generation == 0) slot.generation = 1; // wrapped around
+		m_freeSlots.push_back(slotIndex);
+		return true;
+	}
+
+	bool contains(SlotHandle handle) const {
+		uint32_t slotIndex = indexOf(handle);
+		return slotIndex < m_slots.size() && m_slots[slotIndex].generation == generationOf(handle);
+	}
+
+	T* get(SlotHandle handle) {
+		if (!contains(handle)) return nullptr;
+		return &m_values[m_slots[indexOf(handle)].dense];
+	}
+
+	const T* get(SlotHandle handle) const {
+		if (!contains(handle)) return nullptr;
+		return &m_values[m_slots[indexOf(handle)].dense];
+	}
+
+	void clear() {
+		for (uint32_t slotIndex : m_denseToSlot) {
+			m_slots[slotIndex].generation++;
+			if (m_slots[slotIndex].generation == 0) m_slots[slotIndex].generation = 1;
+			m_freeSlots.push_back(slotIndex);
+		}
+		m_values.clear();
+		m_denseToSlot.clear();
+	}
+
+	void reserve(size_t count) {
+		m_values.reserve(count);
+		m_denseToSlot.reserve(count);
+		m_slots.reserve(count);
+	}
+
+	size_t size() const { return m_values.size(); }
+	bool empty() const { return m_values.empty(); }
+
+	T& operator[](size_t denseIndex) { return m_values[denseIndex]; }
+	const T& operator[](size_t denseIndex) const { return m_values[denseIndex]; }
+
+	auto begin() { return m_values.begin(); }
+	auto end() { return m_values.end(); }
+	auto begin() const { return m_values.begin(); }
+	auto end() const { return m_values.end(); }
+
+	static uint32_t indexOf(SlotHandle handle) { return uint32_t(handle & 0xFFFFFFFFull); }
+	static uint32_t generationOf(SlotHandle handle) { return uint32_t(handle >> 32); }
+	static SlotHandle makeHandle(uint32_t index, uint32_t generation) {
+		return (SlotHandle(generation) << 32) | SlotHandle(index);
+	}
+
+private:
+	struct Slot {
+		uint32_t dense;
+		uint32_t generation;
+	};
+
+	std::vector<T> m_values;
+	std::vector<uint32_t> m_denseToSlot;
+	std::vector<Slot> m_slots;
+	std::vector<uint32_t> m_freeSlots;
+};
@@ -0,0 +1,51 @@
+#include "Std140Layout.h"
+
+#include "ShaderGen.h"
+
+#include <format>
+
+uint32_t Std140Layout::alignOf(ValueType type) {
+	switch (type) {
+		case ValueType::scalar: return 4;
+		case ValueType::vec2: return 8;
+		case ValueType::vec3:
+		case ValueType::vec4: return 16;
+		default: return 0;
+	}
+}
+
+uint32_t Std140Layout::sizeOf(ValueType type) {
+	switch (type) {
+		case ValueType::scalar: return 4;
+		case ValueType::vec2: return 8;
+		case ValueType::vec3: return 12;
+		case ValueType::vec4: return 16;
+		default: return 0;
+	}
+}
+
+uint32_t Std140Layout::add(const std::string& name, ValueType type) {
+	uint32_t align = alignOf(type);
+	if (align == 0) return none;
+
+	uint32_t offset = (m_end + align - 1) & ~(align - 1);
+	m_members.push_back({ name, type, offset });
+	m_end = offset + sizeOf(type);
+	return offset;
+}
+
+void Std140Layout::clear() {
+	m_members.clear();
+	m_end = 0;
+}
+
+std::string Std140Layout::declaration(std::string_view blockName, uint32_t binding) const {
+	if (m_members.empty()) return "";
+
+	std::string decl = std::format("layout (std140, binding={}) uniform {} {{\n", binding, blockName);
+	for (auto& member : m_members) {
+		decl += std::format("\t{} {}; // offset {}\n", typeStr[size_t(member.type)], member.name, member.offset);
+	}
+	decl += "};\n";
+	return decl;
+}
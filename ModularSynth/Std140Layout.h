@@ -0,0 +1,50 @@
+#pragma once
+
+#include "NodeGraph.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * std140 layout
+ * ====================================================
+ * Packs values into a uniform block the way std140 lays it out, so the CPU
+ * side can write a buffer the shader reads as is. Scalars align to 4 bytes,
+ * vec2 to 8, vec3 and vec4 to 16; a float may sit in the 4 bytes after a
+ * vec3. The block's size is rounded up to 16.
+ *
+ * Pure bookkeeping like RenderGraph: it never touches GL.
+ */
+class Std140Layout {
+public:
+	struct Member {
+		std::string name;
+		ValueType type;
+		uint32_t offset; // in bytes from the start of the block
+	};
+
+	static uint32_t alignOf(ValueType type);
+	static uint32_t sizeOf(ValueType type); // bytes the value takes, not counting padding
+
+	// returns the member's offset, images can't go in a block and return none
+	uint32_t add(const std::string& name, ValueType type);
+
+	void clear();
+
+	// the block's GLSL, no instance name so members are read by their own name.
+	// Empty for an empty layout, GLSL has no empty blocks
+	std::string declaration(std::string_view blockName, uint32_t binding) const;
+
+	const std::vector<Member>& members() const { return m_members; }
+	uint32_t size() const { return (m_end + 15) & ~15u; }
+	bool empty() const { return m_members.empty(); }
+
+	static constexpr uint32_t none = uint32_t(-1);
+
+private:
+	std::vector<Member> m_members;
+	uint32_t m_end{ 0 }; // past the last member
+};
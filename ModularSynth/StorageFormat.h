@@ -0,0 +1,32 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include <cstdint>
+#include <string_view>
+
+// image formats the generated shaders read and write
+enum class StorageFormat : uint8_t {
+	rgba32f = 0,
+	rgba16f,
+	rgba8,
+	r32f
+};
+
+struct StorageFormatInfo {
+	std::string_view qualifier; // in layout ()
+	std::string_view name;
+	GLenum internalFormat;
+	uint32_t texelBytes;
+};
+
+constexpr StorageFormatInfo storageFormats[] = {
+	{ "rgba32f", "RGBA32F", GL_RGBA32F, 16 },
+	{ "rgba16f", "RGBA16F", GL_RGBA16F, 8 },
+	{ "rgba8", "RGBA8", GL_RGBA8, 4 },
+	{ "r32f", "R32F", GL_R32F, 4 }
+};
+
+constexpr const StorageFormatInfo& formatInfo(StorageFormat format) {
+	return storageFormats[size_t(format)];
+}
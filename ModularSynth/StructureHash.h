@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+
+// FNV-1a, the same on every run so it can name files on disk
+class StructureHash {
+public:
+	StructureHash& add(const void* data, size_t size) {
+		auto bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++) {
+			m_hash ^= bytes[i];
+			m_hash *= 1099511628211ull;
+		}
+		return *this;
+	}
+
+	// length first, so "ab" + "c" and "a" + "bc" differ
+	StructureHash& add(std::string_view text) {
+		add(uint64_t(text.size()));
+		return add(text.data(), text.size());
+	}
+
+	template <typename T> requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+	StructureHash& add(T value) {
+		return add(&value, sizeof(T));
+	}
+
+	uint64_t value() const { return m_hash; }
+
+private:
+	uint64_t m_hash{ 14695981039346656037ull };
+};
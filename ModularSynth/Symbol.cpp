@@ -0,0 +1,34 @@
+#include "Symbol.h"
+
+#include <deque>
+#include <unordered_map>
+
+namespace {
+	struct SymbolTable {
+		std::deque<std::string> names{ "" }; // deque keeps the views below valid
+		std::unordered_map<std::string_view, uint32_t> ids{ { names.front(), 0 } };
+	};
+
+	SymbolTable& symbolTable() {
+		static SymbolTable table;
+		return table;
+	}
+}
+
+Symbol::Symbol(std::string_view name) {
+	auto& table = symbolTable();
+
+	auto pos = table.ids.find(name);
+	if (pos != table.ids.end()) {
+		m_id = pos->second;
+		return;
+	}
+
+	m_id = uint32_t(table.names.size());
+	table.names.emplace_back(name);
+	table.ids[table.names.back()] = m_id;
+}
+
+const std::string& Symbol::str() const {
+	return symbolTable().names[m_id];
+}
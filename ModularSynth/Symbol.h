@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <compare>
+#include <functional>
+
+/*
+ * Interned names
+ * ====================================================
+ * Port and parameter names are interned once (at setup) into a process-wide
+ * table, after that they are compared and looked up as plain integers.
+ * Constructing a Symbol from a string interns it, that's the only place
+ * where a string gets hashed. The table is not thread safe, intern on the
+ * main thread (setup, GUI) only.
+ */
+class Symbol {
+public:
+	constexpr Symbol() = default; // the empty name
+
+	Symbol(std::string_view name);
+	Symbol(const std::string& name) : Symbol(std::string_view(name)) {}
+	Symbol(const char* name) : Symbol(std::string_view(name)) {}
+
+	uint32_t id() const { return m_id; }
+	const std::string& str() const;
+	bool empty() const { return m_id == 0; }
+
+	bool operator==(const Symbol&) const = default;
+	auto operator<=>(const Symbol&) const = default;
+
+private:
+	uint32_t m_id{ 0 };
+};
+
+template <>
+struct std::hash<Symbol> {
+	size_t operator()(const Symbol& symbol) const noexcept { return symbol.id(); }
+};
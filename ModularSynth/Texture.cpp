@@ -46,4 +46,10 @@ void Texture::init(size_t dimensions) {
 	// TODO: Set filter
 	glTextureParameteri(m_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTextureParameteri(m_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// single channel textures preview as grey instead of red
+	if (m_internalFormat == GL_R32F) {
+		glTextureParameteri(m_id, GL_TEXTURE_SWIZZLE_G, GL_RED);
+		glTextureParameteri(m_id, GL_TEXTURE_SWIZZLE_B, GL_RED);
+	}
 }
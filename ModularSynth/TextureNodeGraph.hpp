@@ -2,73 +2,407 @@
 
 #include "NodeGraph.h"
 #include "GraphicsNode.h"
+#include "CpuBackend.h"
 #include "ShaderGen.h"
 #include "Shader.h"
+#include "ProgramCache.h"
+#include "LruCache.h"
+#include "RenderGraph.h"
+#include "Std140Layout.h"
+#include "StructureHash.h"
 #include "Texture.h"
 
+#include <array>
+#include <cstring>
 #include <format>
 #include <fstream>
-#include <stack>
-#include <regex>
-
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+
+/*
+ * Passes
+ * ====================================================
+ * A multipass node samples its input through $TREE, inlined that is a
+ * function running the whole input subtree, once per sample. Stacked
+ * multipass nodes multiply that: n normal maps over a noise run the noise
+ * 3^n times per pixel.
+ *
+ * A split multipass node gets a pass of its own instead: a dispatch that
+ * renders its input subtree to a texture once, and $TREE reads that texture
+ * back in the passes after it. Every split node adds a dispatch and a full
+ * size texture, so in the automatic mode a node is split only when its
+ * samples of the subtree cost more than running the subtree once and reading
+ * it back. Costs are per pixel in library tokens, see ShaderLibrary::cost.
+ *
+ * A pass texture is only alive from the pass writing it to the last pass
+ * reading it, the render graph lets the ones that don't overlap share
+ * a texture. The output nodes' textures are kept, they're the result.
+ *
+ * Tiles
+ * ====================================================
+ * renderTiled() runs the passes one tile at a time, for images too big to
+ * render in one go. Every pixel is computed from its position in the whole
+ * image (bTileOrigin + the invocation), so a tile matches the same part of a
+ * full render. A pass also renders a margin around the tile, as wide as the
+ * multipass nodes after it reach, so the samples at the tile edges find the
+ * same texels they'd find in a full render.
+ *
+ * Params
+ * ====================================================
+ * The value params of the live nodes live in one std140 uniform block that
+ * every pass declares, so a param edit is a write to a buffer rather than a
+ * new program or a uniform call per pass. The values are mirrored in a CPU
+ * side copy of the buffer; once per render the params that differ from it
+ * are copied in and only the bytes between the first and the last change are
+ * uploaded. Images can't go in a block, they keep their image units.
+ *
+ * Specialization params are the exception: they pick a code path, so their
+ * value is part of the program. A node picks a variant function by it in
+ * functionName(), and where a function takes one anyway it gets a literal the
+ * compiler folds. A new value is a new structural hash, and the program cache
+ * keeps the variants that were compiled.
+ *
+ * CPU
+ * ====================================================
+ * renderCpu() computes the same outputs without GL, see CpuBackend.h. The
+ * nodes become a CpuProgram with every argument resolved the way solveFor
+ * resolves it, its kernels compile to one bytecode program (Bytecode.h) and
+ * the tiles are shared out to a thread pool, a VM per worker running rows.
+ * Multipass nodes always run their subtree inline there.
+ */
 class TextureNodeGraph : public NodeGraph {
+public:
+	enum class PassMode {
+		inlined = 0, // one dispatch, subtrees are evaluated per sample
+		split, // every multipass node with an input gets a pass
+		automatic // split where the cost estimate says it pays off
+	};
+
+	// the uniforms of a pass program, looked up once per program instead of
+	// by name per dispatch or per solve
+	struct PassLocations {
+		std::weak_ptr<Shader> program; // the one they're from, a recompile or a reload needs new ones
+		GLint outputSize{ -1 }, tileOrigin{ -1 }, tileSize{ -1 };
+		std::unordered_map<size_t, GLint> passOrigins; // by id, of the split nodes the pass reads
+	};
+
+	struct RenderPass {
+		GraphicsNode* target{ nullptr }; // renders the input of this node, null for the final pass
+		std::vector<GraphicsNode*> nodes; // path order
+		std::shared_ptr<Shader> program;
+		uint32_t margin{ 0 }; // pixels past the tile, for the samples of the passes after it
+		StorageFormat format{ StorageFormat::rgba32f }; // of the texture a split pass writes
+		std::shared_ptr<const PassLocations> locations;
+	};
+
+	// in pixels, y as in the textures
+	struct Tile {
+		uint32_t x{ 0 }, y{ 0 }, width{ 0 }, height{ 0 };
+	};
+
+	struct TiledRenderOptions {
+		uint32_t tileSize{ 1024 }; // halved until the tile fits the budget
+		size_t memoryBudget{ size_t(512) << 20 }; // pass textures, tile outputs and the readback buffer
+	};
+
+	// gets every tile of every output node, tile.width * tile.height rgba floats, rows from tile.y up.
+	// A one channel (r32f) output comes as grey, (r, r, r, 1), the way the editor shows it
+	using TileSink = std::function<void(GraphicsNode* output, const Tile& tile, std::span<const float> pixels)>;
+
+	struct CpuRenderOptions {
+		uint32_t tileSize{ 64 };
+		size_t threads{ 0 }; // 0 is one per core
+	};
+
 private:
 	size_t m_imgId{ 0 }; // 0 is the final output
 	std::map<size_t, std::string> m_subtreeNames;
 	std::map<size_t, std::string> m_subtreeFunctions;
+	ProgramCache m_programs;
+	LruCache<uint64_t, std::shared_ptr<const PassLocations>> m_locations{ 16 }; // by pass key, like the programs
+
+	// nodes feeding an output node, in path order. Only these get code,
+	// uniforms and image bindings
+	std::vector<GraphicsNode*> m_liveNodes;
+	bool m_timeDispatch{ false }; // debug builds time the first dispatch of a new program
+
+	PassMode m_passMode{ PassMode::automatic };
+	std::unordered_map<Node*, size_t> m_splitNodes; // -> the pass rendering its input
+	std::vector<RenderPass> m_passes; // in the order they run, the final pass last
+
+	RenderGraph m_renderGraph;
+	std::unordered_map<Node*, size_t> m_passTransients; // split node -> transient in m_renderGraph
+	std::vector<std::unique_ptr<Texture>> m_transientTextures; // the render graph's physical textures
+	std::array<uint32_t, 4> m_transientSize{ 0, 0, 0, 0 }; // image, tile
+	bool m_transientsPlanned{ false };
+
+	Std140Layout m_paramLayout;
+	std::vector<std::pair<GraphicsNode*, size_t>> m_paramSources; // node and param index, per member
+	std::vector<uint8_t> m_paramShadow; // what the buffer holds
+	GLuint m_paramBuffer{ 0 };
+	size_t m_paramBufferSize{ 0 };
+	uint64_t m_paramsKey{ 0 }; // the structural hash the layout was planned for
+	static constexpr GLuint paramBlockBinding = 1; // nanovg's block is on 0
+
+	std::unique_ptr<ThreadPool> m_cpuPool;
+
+	// per pixel, in the units of ShaderLibrary::cost
+	static constexpr size_t sampleCost = 16; // reading a pass texture back
+	static constexpr size_t passCost = 64; // writing it, and the dispatch
 
 public:
+	struct CodegenStats {
+		size_t pathNodes{ 0 }, liveNodes{ 0 };
+		size_t uniforms{ 0 }, prunedUniforms{ 0 };
+		size_t passes{ 0 };
+		size_t outputBytes{ 0 }, outputBytesFull{ 0 }; // per pixel of all outputs, and as rgba32f
+	};
+
+	~TextureNodeGraph() {
+		if (m_paramBuffer) glDeleteBuffers(1, &m_paramBuffer);
+	}
 
-	void solveFor(ShaderGen& gen, size_t nodeId, const std::string& funcName, bool appendFunctions = true, bool inclusive = true) {
-		if (m_nodePath.empty()) buildNodePath();
+	// the roots and every node they depend on, in path order. A split node
+	// reads its input from its pass, so only the inputs its function takes
+	// directly are followed. Without sampledInputs no multipass node's are,
+	// for callers that run the subtrees on their own
+	std::vector<GraphicsNode*> collectNodes(std::span<Node* const> roots, bool sampledInputs = true) {
+		compactNodePath();
+
+		std::unordered_set<Node*> reached(roots.begin(), roots.end());
+		std::vector<Node*> stack(roots.begin(), roots.end());
+		while (!stack.empty()) {
+			Node* node = stack.back(); stack.pop_back();
+			bool split = m_splitNodes.count(node) > 0 || (!sampledInputs && static_cast<GraphicsNode*>(node)->multiPassNode());
+
+			for (auto&& conn : getNodeInputConnections(node)) {
+				if (split && !takesInput(static_cast<GraphicsNode*>(node), conn.destinationInput)) continue;
+				if (reached.insert(conn.source).second) stack.push_back(conn.source);
+			}
+		}
 
-		gen.beginFunctionBlock("vec4 tree_" + funcName + "(vec2 cUV)");
-		
-		std::string lib = "";
+		std::vector<GraphicsNode*> nodes;
+		nodes.reserve(reached.size());
+		for (Node* node : m_nodePath) {
+			if (reached.count(node)) nodes.push_back(static_cast<GraphicsNode*>(node));
+		}
+		return nodes;
+	}
 
-		for (size_t i = m_nodePath.size(); i-- > 0;) {
-			auto node = dynamic_cast<GraphicsNode*>(get(m_nodePath[i]));
+	const std::vector<GraphicsNode*>& findLiveNodes() {
+		m_splitNodes.clear(); // live is everything an output needs, whichever pass runs it
+		m_liveNodes = collectNodes(outputNodes());
+		return m_liveNodes;
+	}
+
+	// picks the split nodes among the live ones and lays out the passes
+	void planPasses() {
+		m_splitNodes.clear();
+		m_passes.clear();
 
-			// replace $ vars
-			std::string nodeLib = node->library();
-			nodeLib = std::regex_replace(nodeLib, std::regex("\\$NODE"), std::to_string(node->id()));
+		// per pixel, with the samples of inlined subtrees
+		std::unordered_map<Node*, size_t> evalCost;
+		for (GraphicsNode* node : m_liveNodes) { // path order, the inputs are decided first
+			auto& lib = node->parsedLibrary();
+			size_t cost = lib.cost(node->functionName());
 
-			// multipass nodes need a subtree function to sample from it multiple times
 			if (node->multiPassNode()) {
-				std::string treeName = std::format("tree_sub_{}", node->id());
-				nodeLib = std::regex_replace(nodeLib, std::regex("\\$TREE"), treeName);
+				auto sources = inputSources(node);
+				size_t samples = lib.treeSamples(node->functionName());
+
+				size_t subtree = 0;
+				for (GraphicsNode* source : collectNodes(sources)) subtree += evalCost[source];
+
+				bool split = false;
+				if (!sources.empty()) {
+					if (m_passMode == PassMode::split) split = true;
+					else if (m_passMode == PassMode::automatic) {
+						split = samples * subtree > subtree + samples * sampleCost + passCost;
+					}
+				}
+
+				if (split) {
+					m_splitNodes[node] = m_passes.size();
+					cost += samples * sampleCost;
+					m_passes.push_back({ node, collectNodes(sources) });
+					m_passes.back().format = passFormat(m_passes.back());
+				}
+				else {
+					cost += samples * subtree;
+				}
+			}
+
+			evalCost[node] = cost;
+		}
+
+		m_passes.push_back({ nullptr, collectNodes(outputNodes()) });
+
+		// a pass covers what the passes reading it sample, readers come later
+		for (size_t i = m_passes.size(); i-- > 0;) {
+			for (GraphicsNode* node : m_passes[i].nodes) {
+				if (auto split = m_splitNodes.find(node); split != m_splitNodes.end()) {
+					auto& margin = m_passes[split->second].margin;
+					margin = std::max(margin, m_passes[i].margin + node->sampleRadius());
+				}
+			}
+		}
+
+		m_transientsPlanned = false;
+	}
+
+	// a pass texture lives from the pass writing it to the last pass reading it,
+	// and is as big as the pass renders for a tile
+	void planTransients(uint32_t width, uint32_t height, uint32_t tileWidth, uint32_t tileHeight) {
+		m_renderGraph.clear();
+		m_passTransients.clear();
+
+		for (size_t i = 0; i < m_passes.size(); i++) {
+			if (auto target = m_passes[i].target) {
+				uint32_t margin = m_passes[i].margin * 2;
+				auto& format = formatInfo(m_passes[i].format);
+				const RenderGraph::TextureDesc desc{
+					std::min(tileWidth + margin, width), std::min(tileHeight + margin, height),
+					format.internalFormat, format.texelBytes
+				};
+				m_passTransients[target] = m_renderGraph.addTransient(desc);
+				m_renderGraph.use(m_passTransients[target], i);
+			}
+			for (GraphicsNode* node : m_passes[i].nodes) {
+				if (auto transient = m_passTransients.find(node); transient != m_passTransients.end()) {
+					m_renderGraph.use(transient->second, i);
+				}
+			}
+		}
+		m_renderGraph.compile();
 
-				if (m_subtreeNames.find(node->id()) == m_subtreeNames.end()) {
-					m_subtreeNames[node->id()] = treeName;
+		m_transientSize = { width, height, tileWidth, tileHeight };
+		m_transientsPlanned = true;
+	}
+
+	void allocateTransients() {
+		// textures that still fit are kept
+		auto& physical = m_renderGraph.physical();
+		m_transientTextures.resize(physical.size());
+		for (size_t i = 0; i < physical.size(); i++) {
+			auto& texture = m_transientTextures[i];
+			if (!texture || texture->size()[0] != physical[i].width || texture->size()[1] != physical[i].height
+				|| texture->internalFormat() != physical[i].format) {
+				texture = std::unique_ptr<Texture>(new Texture({ physical[i].width, physical[i].height }, physical[i].format));
+			}
+		}
+
+#ifdef _DEBUG
+		auto& stats = m_renderGraph.stats();
+		if (stats.transients > 0) {
+			std::cout << std::format(
+				"transients: {} in {} textures, {:.1f} MB peak, {:.1f} MB pooled, {:.1f} MB naive\n",
+				stats.transients, stats.textures,
+				stats.peakBytes / 1048576.0, stats.pooledBytes / 1048576.0, stats.naiveBytes / 1048576.0
+			);
+		}
+#endif
+	}
+
+	void setPassMode(PassMode mode) { m_passMode = mode; } // takes effect on the next solve
+	PassMode passMode() const { return m_passMode; }
+	const std::vector<RenderPass>& passes() const { return m_passes; }
+	const RenderGraph& renderGraph() const { return m_renderGraph; }
+
+	CodegenStats codegenStats() {
+		CodegenStats stats{ .pathNodes = m_nodePath.size(), .liveNodes = m_liveNodes.size(), .passes = m_passes.size() };
+		for (GraphicsNode* node : m_liveNodes) {
+			stats.uniforms += node->params().size();
+			if (node->outputNode()) {
+				stats.outputBytes += formatInfo(outputFormat(node)).texelBytes;
+				stats.outputBytesFull += formatInfo(StorageFormat::rgba32f).texelBytes;
+			}
+		}
+		for (Node* node : m_nodePath) {
+			stats.prunedUniforms += static_cast<GraphicsNode*>(node)->params().size();
+		}
+		stats.prunedUniforms -= stats.uniforms;
+		return stats;
+	}
+
+	// emits tree_<funcName>() running `nodes`, given in path order. The top level
+	// tree also pastes the node functions and declares the uniforms, subtrees
+	// only need the calls
+	void solveFor(ShaderGen& gen, const std::vector<GraphicsNode*>& nodes, const std::string& funcName, bool topLevel = true) {
+		gen.beginFunctionBlock("vec4 tree_" + funcName + "(vec2 cUV)");
+
+		for (size_t i = nodes.size(); i-- > 0;) {
+			auto node = nodes[i];
+
+			// parsed once per node type, $NODE and $TREE are filled in when pasting
+			gen.loadLib(node->parsedLibrary());
+
+			// multipass nodes need a subtree function to sample from it multiple times,
+			// a split node's subtree was rendered by an earlier pass and is read back
+			if (node->multiPassNode() && m_subtreeNames.find(node->id()) == m_subtreeNames.end()) {
+				if (auto split = m_splitNodes.find(node); split != m_splitNodes.end()) {
+					// a one channel pass holds a scalar, spread back out like convertType does
+					bool scalar = m_passes[split->second].format == StorageFormat::r32f;
+					m_subtreeNames[node->id()] = std::format("pass_{}", node->id());
+					m_subtreeFunctions[node->id()] = std::format(
+						"vec4 pass_{0}(vec2 uv) {{\n"
+						"\tivec2 pixel = clamp(ivec2(uv * bOutputSize), ivec2(0), ivec2(bOutputSize) - 1);\n"
+						"\treturn {1};\n"
+						"}}\n",
+						node->id(),
+						scalar
+							? std::format("vec4(vec3(imageLoad(bPass{0}, pixel - bPassOrigin{0}).r), 1.0)", node->id())
+							: std::format("imageLoad(bPass{0}, pixel - bPassOrigin{0})", node->id())
+					);
+				}
+				else {
+					m_subtreeNames[node->id()] = std::format("tree_sub_{}", node->id());
 
 					ShaderGen subtreeGen{};
-					solveFor(subtreeGen, node->id(), std::format("sub_{}", node->id()), false, false);
+					solveFor(subtreeGen, collectNodes(inputSources(node)), std::format("sub_{}", node->id()), false);
 
 					m_subtreeFunctions[node->id()] = subtreeGen.target(ShaderGen::Target::definitions);
 				}
 			}
 
-			// Output nodes
-			if (dynamic_cast<OutputNode*>(node)) {
-				gen.beginCodeBlock();
-				gen.append(std::format("layout (rgba32f, binding={}) uniform image2D bOutput{};\n", m_imgId++, node->id()));
-				gen.endCodeBlock(ShaderGen::Target::uniforms);
-			}
+			// image bindings go in this order, render() follows it
+			if (topLevel) {
+				// Output nodes
+				if (node->outputNode()) {
+					gen.beginCodeBlock();
+					gen.append(std::format(
+						"layout ({}, binding={}) uniform image2D bOutput{};\n",
+						formatInfo(outputFormat(node)).qualifier, m_imgId++, node->id()
+					));
+					gen.endCodeBlock(ShaderGen::Target::uniforms);
+				}
 
-			// load libraries
-			lib += nodeLib;
-			lib += "\n";
+				// the pass texture of a split node
+				if (auto split = m_splitNodes.find(node); split != m_splitNodes.end()) {
+					gen.beginCodeBlock();
+					gen.append(std::format(
+						"layout ({}, binding={}) readonly uniform image2D bPass{};\n",
+						formatInfo(m_passes[split->second].format).qualifier, m_imgId++, node->id()
+					));
+					gen.append(std::format("uniform ivec2 bPassOrigin{};\n", node->id()));
+					gen.endCodeBlock(ShaderGen::Target::uniforms);
+				}
 
-			// do the same for params
-			for (auto& [paramName, nv] : node->params()) {
-				// uniforms
-				auto uniName = std::format("param_{}_{}", node->id(), toCamelCase(paramName));
-				gen.appendUniform(nv.type, uniName, nv.type == ValueType::image ? (m_imgId++) : 0);
+				// do the same for image params, the rest are in the param block
+				for (auto& param : node->params()) {
+					if (param.value.type != ValueType::image) continue;
+
+					auto uniName = std::format("param_{}_{}", node->id(), param.key.str());
+					gen.appendUniform(param.value.type, uniName, m_imgId++, param.format);
+				}
 			}
 
 			// declare outputs
 			for (size_t i = 0; i < node->outputCount(); i++) {
-				auto& nv = node->texture(i);
+				auto nv = node->texture(i);
 
 				auto varName = std::format("out_{}_{}", node->id(), i);
 
@@ -78,58 +412,46 @@ public:
 			}
 		}
 
-		gen.loadLib(lib);
-
 		// call functions
-		std::stack<Node*> nodes;
-
-		// find stop pos
-		auto stopPosIter = std::find(m_nodePath.begin(), m_nodePath.end(), nodeId);
-		auto stopPos = std::distance(m_nodePath.begin(), stopPosIter);
-		if (inclusive) stopPos++;
-
-		for (size_t i = stopPos; i-- > 0;) {
-			nodes.push(get(m_nodePath[i]));
-		}
-
-		Node* lastNode = nullptr;
-		while (!nodes.empty()) {
-			auto node = static_cast<GraphicsNode*>(nodes.top()); nodes.pop();
-			if (nodes.empty()) {
-				lastNode = node;
-			}
-
-			auto nodeFunction = std::regex_replace(node->functionName(), std::regex("\\$NODE"), std::to_string(node->id()));
+		GraphicsNode* lastNode = nodes.empty() ? nullptr : nodes.back();
+		for (GraphicsNode* node : nodes) {
+			auto libFunction = node->functionName();
+			auto nodeFunction = ShaderGen::instantiate(libFunction, node->id());
 
 			// a
-			if (appendFunctions) {
+			if (topLevel) {
 				if (node->multiPassNode() && m_subtreeFunctions.find(node->id()) != m_subtreeFunctions.end()) {
 					gen.beginCodeBlock();
 					gen.append(m_subtreeFunctions[node->id()]);
 					gen.endCodeBlock(ShaderGen::Target::definitions);
 				}
-				gen.pasteFunction(nodeFunction, lib);
+				auto treeName = m_subtreeNames.find(node->id());
+				gen.pasteFunction(libFunction, node->id(), treeName != m_subtreeNames.end() ? treeName->second : "");
 			}
 
 			gen.indent();
 			gen.append(std::format("{}(", nodeFunction));
 
 			// b
-			auto nodeParams = node->parameters();
-			auto fn = gen.getFunction(nodeFunction);
+			auto& nodeParams = node->bindings();
+			auto& fn = gen.getFunction(libFunction);
 
 			size_t i = 0;
-			for (auto&& param : fn.parameterOrder) {
-				auto paramOb = fn.parameters[param];
+			for (auto&& paramOb : fn.parameterOrder) {
 				if (paramOb.qualifier == ShaderFunctionParam::out) continue;
 
 				// i
-				auto [inputParamName, sType] = nodeParams[param];
+				Symbol inputParamName;
+				SpecialType sType = SpecialType::none;
+				if (auto binding = nodeParams.find(paramOb.symbol); binding != nodeParams.end()) {
+					std::tie(inputParamName, sType) = binding->second;
+				}
 				bool appendComma = false;
 
 				// ii
-				if (node->hasInput(inputParamName)) {
-					auto conns = getConnectionsToInput(node, node->inputIndex(inputParamName));
+				size_t inputIndex = node->inputIndex(inputParamName);
+				if (inputIndex < node->inputCount()) {
+					auto conns = getConnectionsToInput(node, inputIndex);
 					if (!conns.empty()) { // connected
 						// TODO: Consider multiple connections to the same output-input pair, maybe an average?
 						//       might give some problems when dealing with different types...
@@ -162,7 +484,6 @@ public:
 			// c
 			if (node->outputCount() > 0) {
 				for (size_t i = 0; i < node->outputCount(); i++) {
-					auto& nv = node->texture(i);
 					auto varName = std::format("out_{}_{}", node->id(), i);
 					gen.append(varName);
 					if (i < node->outputCount() - 1) {
@@ -175,7 +496,7 @@ public:
 		}
 
 		// output the last node output by default
-		if (lastNode && !dynamic_cast<OutputNode*>(lastNode)) {
+		if (lastNode && !lastNode->outputNode()) {
 			gen.indent();
 
 			auto varName = std::format("out_{}_{}", lastNode->id(), 0);
@@ -191,19 +512,430 @@ public:
 		gen.endFunctionBlock(ShaderGen::Target::definitions);
 	}
 
+	// everything solveFor reads from the live nodes, param values are uniforms so
+	// they're left out. Edits to dead branches don't change it
+	uint64_t structuralHash() {
+		static const uint64_t templateHash = StructureHash{}.add(shaderTemplate).value();
+
+		findLiveNodes();
+
+		StructureHash hash{};
+		hash.add(templateHash);
+		hash.add(m_passMode); // the split nodes follow from it and the rest
+		hash.add(uint64_t(m_liveNodes.size()));
+
+		for (GraphicsNode* node : m_liveNodes) {
+			hash.add(uint64_t(node->id()));
+			hash.add(node->parsedLibrary().hash);
+			hash.add(node->functionName());
+			hash.add(node->multiPassNode());
+			hash.add(node->outputNode());
+
+			// summed, the map is ordered by symbol id and that differs between runs
+			uint64_t bindings = 0;
+			for (auto&& [fnParam, binding] : node->bindings()) {
+				bindings += StructureHash{}.add(fnParam.str()).add(binding.first.str()).add(binding.second).value();
+			}
+			hash.add(bindings);
+
+			for (auto& param : node->params()) {
+				hash.add(param.key.str()).add(param.value.type).add(param.format);
+				if (param.variants) hash.add(node->variant(param.name));
+			}
+			if (node->outputNode()) hash.add(outputFormat(node));
+
+			hash.add(uint64_t(node->outputCount()));
+			for (size_t i = 0; i < node->outputCount(); i++) {
+				hash.add(node->texture(i).type);
+			}
+
+			hash.add(uint64_t(node->inputCount()));
+			for (auto&& conn : getNodeInputConnections(node)) {
+				hash.add(uint64_t(conn.destinationInput));
+				hash.add(uint64_t(conn.source->id()));
+				hash.add(uint64_t(conn.sourceOutput));
+			}
+		}
+		return hash.value();
+	}
+
 	void solve() override {
+		compile();
+		render();
+	}
+
+	// solve() without the render: the passes planned, their programs compiled
+	// and the uniforms found, for a caller that renders at its own size
+	// (renderTiled, say). generatedShader is null when nothing reaches an output
+	void compile() {
+		uint64_t key = structuralHash();
+		if (m_liveNodes.empty()) { // nothing reaches an output, nothing to run
+			m_passes.clear();
+			generatedShader.reset();
+			return;
+		}
+
+		planPasses();
+		if (key != m_paramsKey) { // a value edit keeps the layout, and the buffer
+			planParams();
+			m_paramsKey = key;
+		}
+
+#ifdef _DEBUG
+		bool compiled = false;
+#endif
+		for (size_t i = 0; i < m_passes.size(); i++) {
+			// a graph that was compiled before skips codegen and the compile
+			uint64_t passKey = StructureHash{}.add(key).add(uint64_t(i)).value();
+			if (!(m_passes[i].program = m_programs.find(passKey))) {
+				m_passes[i].program = compilePass(m_passes[i]);
+				m_programs.insert(passKey, m_passes[i].program);
+#ifdef _DEBUG
+				compiled = true;
+#endif
+			}
+			findLocations(passKey, m_passes[i]);
+		}
+		generatedShader = m_passes.back().program;
+		for (GraphicsNode* node : m_liveNodes) node->clearStructureChanged();
+
+#ifdef _DEBUG
+		if (compiled) {
+			auto stats = codegenStats();
+			std::cout << std::format(
+				"codegen: {} of {} nodes live, {} passes, {} uniforms, {} pruned, {} of {} output bytes/px\n",
+				stats.liveNodes, stats.pathNodes, stats.passes, stats.uniforms, stats.prunedUniforms,
+				stats.outputBytes, stats.outputBytesFull
+			);
+			m_timeDispatch = true;
+		}
+#endif
+	}
+
+	// after param edits: a variant or a format edit on a live node needs
+	// solve(), values only go up to the buffer and render again
+	void update() {
+		bool structural = !ready();
+		for (GraphicsNode* node : m_liveNodes) structural = structural || node->structureChanged();
+
+		if (structural) solve();
+		else render();
+	}
+
+	void render(uint32_t width = 1024, uint32_t height = 1024) {
+		if (!ready()) return;
+
+		if (!m_transientsPlanned || m_transientSize != std::array{ width, height, width, height }) {
+			planTransients(width, height, width, height);
+			allocateTransients();
+		}
+		uploadParams();
+
+#ifdef _DEBUG
+		GLuint query = 0;
+		if (m_timeDispatch) {
+			glGenQueries(1, &query);
+			glBeginQuery(GL_TIME_ELAPSED, query);
+		}
+#endif
+
+		renderPasses(width, height, { 0, 0, width, height });
+
+#ifdef _DEBUG
+		if (query) {
+			glEndQuery(GL_TIME_ELAPSED);
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+			glDeleteQueries(1, &query);
+			std::cout << std::format("dispatch: {:.3f} ms over {} passes\n", double(ns) / 1e6, m_passes.size());
+			m_timeDispatch = false;
+		}
+#endif
+	}
+
+	// the same image render() makes, a tile at a time into the sink: a row of
+	// tiles at a time, the top row first, so a sink can stream rows to a file.
+	// The output nodes' own textures are left alone. False if nothing was
+	// compiled, or if even the smallest tile doesn't fit the budget
+	bool renderTiled(uint32_t width, uint32_t height, const TileSink& sink) {
+		return renderTiled(width, height, sink, TiledRenderOptions{});
+	}
+
+	bool renderTiled(uint32_t width, uint32_t height, const TileSink& sink, const TiledRenderOptions& options) {
+		if (!ready() || width == 0 || height == 0) return false;
+
+		std::vector<GraphicsNode*> outputs;
+		for (GraphicsNode* node : m_passes.back().nodes) {
+			if (node->outputNode()) outputs.push_back(node);
+		}
+
+		// the biggest tile that fits
+		uint32_t tileWidth = 0, tileHeight = 0;
+		auto tileBytes = [&](uint32_t size) {
+			tileWidth = std::min(size, width);
+			tileHeight = std::min(size, height);
+			planTransients(width, height, tileWidth, tileHeight);
+			size_t texels = size_t(tileWidth) * tileHeight;
+			size_t bytes = m_renderGraph.stats().pooledBytes + texels * 16; // the readback buffer
+			for (GraphicsNode* node : outputs) bytes += texels * formatInfo(outputFormat(node)).texelBytes;
+			return bytes;
+		};
+
+		uint32_t tileSize = std::max(options.tileSize, 16u);
+		size_t bytes = tileBytes(tileSize);
+		while (bytes > options.memoryBudget && tileSize > 16) {
+			bytes = tileBytes(tileSize /= 2);
+		}
+		if (bytes > options.memoryBudget) {
+#ifdef _DEBUG
+			std::cout << std::format("tiled render: {} MB don't fit the budget\n", bytes >> 20);
+#endif
+			return false;
+		}
+		allocateTransients();
+		uploadParams();
+
+		std::unordered_map<Node*, std::unique_ptr<Texture>> tileOutputs;
+		for (GraphicsNode* node : outputs) {
+			tileOutputs[node] = std::unique_ptr<Texture>(new Texture({ tileWidth, tileHeight }, formatInfo(outputFormat(node)).internalFormat));
+		}
+		std::vector<float> pixels(size_t(tileWidth) * tileHeight * 4);
+
+		for (uint32_t row = (height + tileHeight - 1) / tileHeight; row-- > 0;) {
+			uint32_t y = row * tileHeight;
+			for (uint32_t x = 0; x < width; x += tileWidth) {
+				Tile tile{ x, y, std::min(tileWidth, width - x), std::min(tileHeight, height - y) };
+				renderPasses(width, height, tile, &tileOutputs);
+
+				glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+				size_t count = size_t(tile.width) * tile.height * 4;
+				for (GraphicsNode* node : outputs) {
+					glGetTextureSubImage(
+						tileOutputs[node]->id(), 0, 0, 0, 0, tile.width, tile.height, 1,
+						GL_RGBA, GL_FLOAT, GLsizei(count * sizeof(float)), pixels.data()
+					);
+
+					// GL reads r32f back as (r, 0, 0, 1), the texture's swizzle only applies to sampling
+					if (outputFormat(node) == StorageFormat::r32f) {
+						for (size_t i = 0; i < count; i += 4) pixels[i + 1] = pixels[i + 2] = pixels[i];
+					}
+					sink(node, tile, std::span<const float>(pixels.data(), count));
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// the outputs computed on the CPU, no GL involved. The sink gets the tiles
+	// renderTiled would give it, from the worker threads but one call at a time.
+	// False if a live node has no CPU kernel
+	bool renderCpu(uint32_t width, uint32_t height, const TileSink& sink) {
+		return renderCpu(width, height, sink, CpuRenderOptions{});
+	}
+
+	bool renderCpu(uint32_t width, uint32_t height, const TileSink& sink, const CpuRenderOptions& options) {
+		BytecodeProgram code;
+		if (!compileCpu(width, height, code)) return false;
+
+		size_t threads = options.threads ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+		if (!m_cpuPool || m_cpuPool->size() != threads) m_cpuPool = std::make_unique<ThreadPool>(threads);
+
+		uint32_t tileSize = std::max(options.tileSize, uint32_t(simd::width));
+		std::vector<Tile> tiles;
+		for (uint32_t y = 0; y < height; y += tileSize) {
+			for (uint32_t x = 0; x < width; x += tileSize) {
+				tiles.push_back({ x, y, std::min(tileSize, width - x), std::min(tileSize, height - y) });
+			}
+		}
+
+		// a VM and a tile buffer per output per worker
+		std::vector<std::unique_ptr<BytecodeVM>> machines;
+		std::vector<std::vector<std::vector<float>>> buffers(m_cpuPool->size());
+		for (auto& buffer : buffers) {
+			machines.push_back(std::make_unique<BytecodeVM>(code, tileSize));
+			for (size_t i = 0; i < code.targets.size(); i++) buffer.emplace_back(size_t(tileSize) * tileSize * 4);
+		}
+
+		std::vector<void*> seeds;
+		for (auto& tile : tiles) seeds.push_back(&tile);
+
+		std::mutex sinkMutex;
+		m_cpuPool->run(seeds, seeds.size(), [&](void* item, size_t worker) {
+			const Tile& tile = *static_cast<Tile*>(item);
+			auto& buffer = buffers[worker];
+
+			std::vector<float*> rows(buffer.size());
+			for (uint32_t row = 0; row < tile.height; row++) {
+				for (size_t i = 0; i < rows.size(); i++) rows[i] = buffer[i].data() + size_t(row) * tile.width * 4;
+				machines[worker]->run(tile.x, tile.y + row, tile.width, rows.data());
+			}
+
+			std::lock_guard<std::mutex> lock(sinkMutex);
+			size_t count = size_t(tile.width) * tile.height * 4;
+			for (size_t i = 0; i < buffer.size(); i++) {
+				sink(code.targets[i].node, tile, std::span<const float>(buffer[i].data(), count));
+			}
+		});
+
+		return true;
+	}
+
+	// the live nodes as one bytecode program for a width x height image, what
+	// renderCpu runs. False if a node has no CPU kernel
+	bool compileCpu(uint32_t width, uint32_t height, BytecodeProgram& code) {
+		if (width == 0 || height == 0) return false;
+
+		auto roots = outputNodes();
+		if (roots.empty()) return false;
+
+		CpuProgram program;
+		if (!buildCpuProgram(collectNodes(roots, false), program)) return false;
+
+		BytecodeCompiler compiler{ float(width), float(height) };
+		BytecodeCompiler::Scope scope{ compiler };
+		for (Node* node : roots) {
+			auto output = static_cast<GraphicsNode*>(node);
+			compiler.addTarget(output, outputFormat(output));
+		}
+
+		CpuInputs inputs;
+		inputs.uv = { CpuScalar{ BytecodeCompiler::uvX }, CpuScalar{ BytecodeCompiler::uvY } };
+		inputs.width = float(width);
+		inputs.height = float(height);
+
+		if (GraphicsNode* failed = program.compile(inputs)) {
+			m_lastError = std::format("node {} has no CPU kernel", failed->id());
+			return false;
+		}
+		code = compiler.finish();
+
+#ifdef _DEBUG
+		std::cout << std::format(
+			"cpu bytecode: {} instructions, {} registers, cost {} ({} emitted, {} folded, {} merged, {} dead)\n",
+			code.code.size(), code.registers, code.cost(),
+			code.stats.emitted, code.stats.folded, code.stats.merged, code.stats.dead
+		);
+#endif
+		return true;
+	}
+
+	void save(olc::utils::datafile& out) {
+		for (Node* node : m_nodes) {
+			auto nodePtr = static_cast<GraphicsNode*>(node);
+			std::string nodeName = std::format("node_{}", node->id());
+
+			nodePtr->saveTo(out["nodes"][nodeName]);
+		}
+
+		// connections
+		size_t i = 0;
+		for (Node* node : m_nodes) {
+			for (auto& conn : getNodeOutputConnections(node)) {
+				olc::utils::datafile& linkData = out["connections"][std::format("conn_{}", i)];
+				linkData["source"].SetInt(conn.source->id());
+				linkData["destination"].SetInt(conn.destination->id());
+				linkData["sourceOutput"].SetInt(conn.sourceOutput);
+				linkData["destinationInput"].SetInt(conn.destinationInput);
+				i++;
+			}
+		}
+	}
+
+	// what save() wrote, with the "type" the editor adds to each node. create
+	// makes a node of a type, null skips the node and its connections. The
+	// graph isn't solved. Returns the nodes by their saved id
+	std::unordered_map<int32_t, GraphicsNode*> load(
+		olc::utils::datafile& in,
+		const std::function<GraphicsNode* (const std::string& type)>& create
+	) {
+		std::unordered_map<int32_t, GraphicsNode*> savedIds;
+
+		// batched, the path is built once at the end
+		beginTransaction();
+
+		auto&& nodes = in["nodes"];
+		for (size_t i = 0; i < nodes.GetArraySize(); i++) {
+			auto&& val = nodes.GetArrayItem(i);
+			GraphicsNode* node = create(val["type"].GetString());
+			if (!node) continue;
+
+			node->loadFrom(val);
+			savedIds[val["id"].GetInt()] = node;
+		}
+
+		auto&& connections = in["connections"];
+		for (size_t i = 0; i < connections.GetArraySize(); i++) {
+			auto&& val = connections.GetArrayItem(i);
+			auto source = savedIds.find(val["source"].GetInt());
+			auto destination = savedIds.find(val["destination"].GetInt());
+			if (source == savedIds.end() || destination == savedIds.end()) continue;
+
+			connect(source->second, val["sourceOutput"].GetInt(), destination->second, val["destinationInput"].GetInt());
+		}
+
+		commitTransaction();
+		return savedIds;
+	}
+
+	ProgramCache& programCache() { return m_programs; }
+	const std::vector<GraphicsNode*>& liveNodes() const { return m_liveNodes; }
+
+	std::shared_ptr<Shader> generatedShader; // the final pass
+
+private:
+	std::vector<Node*> outputNodes() {
+		compactNodePath();
+
+		std::vector<Node*> outputs;
+		for (Node* node : m_nodePath) {
+			if (static_cast<GraphicsNode*>(node)->outputNode()) outputs.push_back(node);
+		}
+		return outputs;
+	}
+
+	std::vector<Node*> inputSources(Node* node) {
+		std::vector<Node*> sources;
+		for (auto&& conn : getNodeInputConnections(node)) sources.push_back(conn.source);
+		return sources;
+	}
+
+	// whether the node's function takes the input as a parameter, rather than only through $TREE
+	bool takesInput(GraphicsNode* node, size_t input) {
+		for (auto&& [fnParam, binding] : node->bindings()) {
+			if (node->inputIndex(binding.first) == input) return true;
+		}
+		return false;
+	}
+
+	std::shared_ptr<Shader> compilePass(const RenderPass& pass) {
 		ShaderGen gen{};
 
 		m_imgId = 0;
 		m_subtreeNames.clear();
 		m_subtreeFunctions.clear();
 
-		if (m_nodePath.empty()) buildNodePath();
-		solveFor(gen, m_nodePath.back(), "main"); // last node of the graph
-		
+		// a pass writes its target's input to the texture the later passes read
+		if (pass.target) {
+			gen.beginCodeBlock();
+			gen.append(std::format(
+				"layout ({}, binding={}) writeonly uniform image2D bPass{};\n",
+				formatInfo(pass.format).qualifier, m_imgId++, pass.target->id()
+			));
+			gen.endCodeBlock(ShaderGen::Target::uniforms);
+		}
+
+		solveFor(gen, pass.nodes, "main");
+
+		// every pass declares the whole block, std140 lays it out the same in all of them
+		gen.beginCodeBlock();
+		gen.append(m_paramLayout.declaration("NodeParams", paramBlockBinding));
+		gen.endCodeBlock(ShaderGen::Target::uniforms);
+
 		/*
-		* The nodes are already ordered by execution priority, that is the "node path"
-		* While the node stack is not empty:
+		* The nodes are already ordered by execution priority, that is the "node path",
+		* minus the ones that don't feed an output node
+		* For each node:
 		*	a. Output the function name to the shader source
 		*	b. For each parameter in the function (fetched from the function library for the correct order)
 		*		i. Get the input/param name from the parameter map that the node provides
@@ -221,129 +953,372 @@ public:
 		// output the shader itself
 
 		auto fnNameCall = std::format("tree_{}(cUV);", "main");
+		if (pass.target) {
+			fnNameCall = std::format("imageStore(bPass{}, cCoords, tree_{}(cUV));", pass.target->id(), "main");
+		}
 
 		gen.beginCodeBlock();
 		gen.indent();
 		gen.append(fnNameCall);
 		gen.endCodeBlock(ShaderGen::Target::body);
 
-		std::ofstream of("gen.glsl");
-		of << gen.generate();
+		std::string src = gen.generate();
+
+#ifdef _DEBUG
+		std::ofstream of(pass.target ? std::format("gen_pass_{}.glsl", pass.target->id()) : "gen.glsl");
+		of << src;
 		of.close();
+#endif
 
-		if (generatedShader) {
-			generatedShader.reset();
+		auto program = std::make_shared<Shader>();
+		program->add(src, GL_COMPUTE_SHADER);
+		program->link();
+		return program;
+	}
+
+	// an output node's own format, or one for what's connected: a channel for
+	// scalars, half floats for the rest
+	StorageFormat outputFormat(GraphicsNode* node) {
+		if (auto format = node->requestedFormat()) return *format;
+
+		auto conns = getNodeInputConnections(node);
+		if (!conns.empty() && conns.front().source->texture(conns.front().sourceOutput).type == ValueType::scalar) {
+			return StorageFormat::r32f;
 		}
+		return StorageFormat::rgba16f;
+	}
 
-		generatedShader = std::make_unique<Shader>();
-		generatedShader->add(gen.generate(), GL_COMPUTE_SHADER);
-		generatedShader->link();
+	// multipass nodes take differences of what they sample, so a pass keeps full
+	// floats, but a scalar subtree only needs the one channel
+	static StorageFormat passFormat(const RenderPass& pass) {
+		GraphicsNode* last = pass.nodes.empty() ? nullptr : pass.nodes.back();
+		if (last && last->outputCount() > 0 && last->texture(0).type == ValueType::scalar) {
+			return StorageFormat::r32f;
+		}
+		return StorageFormat::rgba32f;
+	}
 
-		render();
+	bool ready() const {
+		if (m_passes.empty()) return false;
+		for (auto& pass : m_passes) {
+			if (!pass.program || !pass.program->valid()) return false;
+		}
+		return true;
 	}
 
-	void render(uint32_t width = 1024, uint32_t height = 1024) {
-		if (!generatedShader) return;
+	// what a pass renders for the tile: the tile and its margin, inside the image
+	static Tile passRegion(const RenderPass& pass, uint32_t width, uint32_t height, const Tile& tile) {
+		uint32_t x0 = tile.x - std::min(tile.x, pass.margin), y0 = tile.y - std::min(tile.y, pass.margin);
+		uint32_t x1 = std::min(tile.x + tile.width + pass.margin, width);
+		uint32_t y1 = std::min(tile.y + tile.height + pass.margin, height);
+		return { x0, y0, x1 - x0, y1 - y0 };
+	}
+
+	// runs every pass for the tile, the output nodes write to their own textures
+	// unless tileOutputs has one for them
+	void renderPasses(
+		uint32_t width,
+		uint32_t height,
+		const Tile& tile,
+		std::unordered_map<Node*, std::unique_ptr<Texture>>* tileOutputs = nullptr
+	) {
+		for (auto& pass : m_passes) {
+			Shader& program = *pass.program;
+			Tile region = passRegion(pass, width, height, tile);
+
+			glUseProgram(program.id());
+			program.uniform<2>(pass.locations->outputSize, { float(width), float(height) });
+			program.uniformInt<2>(pass.locations->tileOrigin, { int(region.x), int(region.y) });
+			program.uniformInt<2>(pass.locations->tileSize, { int(region.width), int(region.height) });
+
+			// image bindings in the order compilePass and solveFor handed them out
+			size_t binding = 0;
+			if (pass.target) {
+				glBindImageTexture(binding++, passTexture(pass.target).id(), 0, false, 0, GL_WRITE_ONLY, formatInfo(pass.format).internalFormat);
+			}
+
+			for (size_t i = pass.nodes.size(); i-- > 0;) {
+				auto node = pass.nodes[i];
+
+				if (node->outputNode()) {
+					StorageFormat format = outputFormat(node);
+					if (tileOutputs) {
+						glBindImageTexture(binding++, tileOutputs->at(node)->id(), 0, false, 0, GL_WRITE_ONLY, formatInfo(format).internalFormat);
+					}
+					else {
+						node->render(width, height, binding++, format);
+					}
+				}
+				else {
+					node->render(width, height);
+				}
+				if (auto split = m_splitNodes.find(node); split != m_splitNodes.end()) {
+					Tile written = passRegion(m_passes[split->second], width, height, tile);
+					glBindImageTexture(binding++, passTexture(node).id(), 0, false, 0, GL_READ_ONLY, formatInfo(m_passes[split->second].format).internalFormat);
+					program.uniformInt<2>(pass.locations->passOrigins.at(node->id()), { int(written.x), int(written.y) });
+				}
+				bindImageParams(node, binding);
+			}
+
+			glDispatchCompute((region.width + 15) / 16, (region.height + 15) / 16, 1);
+
+			// the next pass reads what this one wrote
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		}
+	}
+
+	Texture& passTexture(GraphicsNode* node) {
+		return *m_transientTextures[m_renderGraph.physicalOf(m_passTransients.at(node))];
+	}
+
+	// the units are in the layout() of the image uniforms, binding follows them
+	void bindImageParams(GraphicsNode* node, size_t& binding) {
+		for (auto& param : node->params()) {
+			if (param.value.type != ValueType::image) continue;
+			glBindImageTexture(binding++, GLuint(param.value.value[0]), 0, false, 0, GL_READ_ONLY, formatInfo(param.format).internalFormat);
+		}
+	}
 
-		glUseProgram(generatedShader->id());
-		generatedShader->uniform<2>("bOutputSize", { float(width), float(height) });
+	void findLocations(uint64_t passKey, RenderPass& pass) {
+		if (auto cached = m_locations.find(passKey); cached && (*cached)->program.lock() == pass.program) {
+			pass.locations = *cached;
+			return;
+		}
 
-		// render outputs
-		size_t binding = 0;
-		for (const auto& nodeId : m_nodePath) {
-			auto node = get(nodeId);
-			GraphicsNode* gnode = dynamic_cast<GraphicsNode*>(node);
+		Shader& program = *pass.program;
+		auto locations = std::make_shared<PassLocations>();
+		locations->program = pass.program;
+		locations->outputSize = program.getUniformLocation("bOutputSize");
+		locations->tileOrigin = program.getUniformLocation("bTileOrigin");
+		locations->tileSize = program.getUniformLocation("bTileSize");
+		for (GraphicsNode* node : pass.nodes) {
+			if (!m_splitNodes.count(node)) continue;
+			locations->passOrigins[node->id()] = program.getUniformLocation(std::format("bPassOrigin{}", node->id()));
+		}
 
-			if (gnode->render(width, height, binding)) {
-				binding++;
+		pass.locations = locations;
+		m_locations.insert(passKey, std::move(locations));
+	}
+
+	// the value params of the live nodes, widest first so fewer bytes go to
+	// padding, with a scalar after each vec3 where there's one to spare
+	void planParams() {
+		m_paramLayout.clear();
+		m_paramSources.clear();
+
+		std::vector<std::pair<GraphicsNode*, size_t>> byType[5]; // by ValueType, scalar to vec4
+		for (GraphicsNode* node : m_liveNodes) {
+			auto& params = node->params();
+			for (size_t i = 0; i < params.size(); i++) {
+				size_t type = size_t(params[i].value.type);
+				if (params[i].variants == 0 && type >= 1 && type <= 4) byType[type].emplace_back(node, i);
 			}
 		}
 
-		setUniforms(binding);
-		
-		glDispatchCompute(width / 16, height / 16, 1);
-		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		auto add = [&](std::pair<GraphicsNode*, size_t> source) {
+			auto& param = source.first->params()[source.second];
+			m_paramLayout.add(std::format("param_{}_{}", source.first->id(), param.key.str()), param.value.type);
+			m_paramSources.push_back(source);
+		};
+
+		auto& scalars = byType[size_t(ValueType::scalar)];
+		size_t scalar = 0;
+		for (auto& source : byType[size_t(ValueType::vec4)]) add(source);
+		for (auto& source : byType[size_t(ValueType::vec3)]) {
+			add(source);
+			if (scalar < scalars.size()) add(scalars[scalar++]);
+		}
+		for (auto& source : byType[size_t(ValueType::vec2)]) add(source);
+		for (; scalar < scalars.size(); scalar++) add(scalars[scalar]);
+
+		// the buffer is made again with the whole copy on the next upload
+		m_paramShadow.assign(m_paramLayout.size(), 0);
+		m_paramBufferSize = 0;
 	}
 
-	void save(olc::utils::datafile& out) {
-		for (auto& node : m_nodes) {
-			auto nodePtr = static_cast<GraphicsNode*>(node.get());
-			std::string nodeName = std::format("node_{}", node->id());
+	// brings the buffer up to date with the params, once per render
+	void uploadParams() {
+		if (m_paramLayout.empty()) return;
 
-			nodePtr->saveTo(out["nodes"][nodeName]);
+		size_t dirtyBegin = m_paramShadow.size(), dirtyEnd = 0;
+		auto& members = m_paramLayout.members();
+		for (size_t i = 0; i < members.size(); i++) {
+			auto [node, index] = m_paramSources[i];
+			const float* value = node->params()[index].value.value.data();
+			uint32_t size = Std140Layout::sizeOf(members[i].type);
+
+			uint8_t* dest = m_paramShadow.data() + members[i].offset;
+			if (std::memcmp(dest, value, size) == 0) continue;
+
+			std::memcpy(dest, value, size);
+			dirtyBegin = std::min(dirtyBegin, size_t(members[i].offset));
+			dirtyEnd = std::max(dirtyEnd, size_t(members[i].offset + size));
 		}
 
-		// connections
-		size_t i = 0;
-		for (auto& conn : m_connections) {
-			olc::utils::datafile& linkData = out["connections"][std::format("conn_{}", i)];
-			linkData["source"].SetInt(conn.source->id());
-			linkData["destination"].SetInt(conn.destination->id());
-			linkData["sourceOutput"].SetInt(conn.sourceOutput);
-			linkData["destinationInput"].SetInt(conn.destinationInput);
-			i++;
+		if (m_paramBufferSize != m_paramShadow.size()) {
+			if (m_paramBuffer) glDeleteBuffers(1, &m_paramBuffer);
+			glCreateBuffers(1, &m_paramBuffer);
+			glNamedBufferStorage(m_paramBuffer, m_paramShadow.size(), m_paramShadow.data(), GL_DYNAMIC_STORAGE_BIT);
+			m_paramBufferSize = m_paramShadow.size();
 		}
+		else if (dirtyBegin < dirtyEnd) {
+			glNamedBufferSubData(m_paramBuffer, dirtyBegin, dirtyEnd - dirtyBegin, m_paramShadow.data() + dirtyBegin);
+		}
+		glBindBufferBase(GL_UNIFORM_BUFFER, paramBlockBinding, m_paramBuffer);
 	}
 
-	std::unique_ptr<Shader> generatedShader;
+	// the programs and the bindings were made for the live nodes, start over
+	void onRemove(Node* node) override {
+		if (std::find(m_liveNodes.begin(), m_liveNodes.end(), node) == m_liveNodes.end()) return;
+
+		m_liveNodes.clear();
+		m_splitNodes.clear();
+		m_passes.clear();
+		m_paramLayout.clear();
+		m_paramSources.clear();
+		m_paramsKey = 0;
+		m_passTransients.clear();
+		m_transientsPlanned = false;
+		generatedShader.reset();
+	}
 
-private:
-	void setUniform(const std::string& name, const NodeValue& nv, size_t index) {
-		auto shader = generatedShader.get();
-		switch (nv.type) {
-			case ValueType::scalar: shader->uniform<1>(name, { nv.value[0] }); break;
-			case ValueType::vec2: shader->uniform<2>(name, { nv.value[0], nv.value[1] }); break;
-			case ValueType::vec3: shader->uniform<3>(name, { nv.value[0], nv.value[1], nv.value[2] }); break;
-			case ValueType::vec4: shader->uniform<4>(name, nv.value); break;
-			case ValueType::image: {
-				glBindImageTexture(index, GLuint(nv.value[0]), 0, false, 0, GL_READ_ONLY, GL_RGBA32F);
-				shader->uniformInt<1>(name, { int(index) });
-			} break;
-		}
-	}
-
-	void setNodeUniforms(GraphicsNode* node, size_t& binding) {
-		for (auto& [paramName, nv] : node->params()) {
-			auto uniName = std::format("param_{}_{}", node->id(), toCamelCase(paramName));
-			
-			// UNIFORM
-			setUniform(uniName, nv, binding);
-
-			// BODY
-			if (nv.type == ValueType::image) {
-				binding++;
+	// the nodes as CPU steps, in path order, a multipass node's subtree as
+	// a program of its own. The params are read now, like an upload
+	bool buildCpuProgram(const std::vector<GraphicsNode*>& nodes, CpuProgram& program) {
+		std::unordered_map<Node*, size_t> slots;
+
+		for (GraphicsNode* node : nodes) {
+			auto& lib = node->parsedLibrary();
+			auto fn = lib.functions.find(node->functionName());
+			if (fn == lib.functions.end()) {
+				m_lastError = std::format("node {} has no function {}", node->id(), node->functionName());
+				return false;
+			}
+
+			auto& step = program.steps.emplace_back();
+			step.node = node;
+			step.slot = program.slots;
+			slots[node] = step.slot;
+			program.slots += node->outputCount();
+
+			for (auto&& paramOb : fn->second.parameterOrder) {
+				if (paramOb.qualifier == ShaderFunctionParam::out) continue;
+				if (!resolveArgument(node, paramOb, slots, step.arguments.emplace_back())) return false;
+			}
+
+			for (auto& param : node->params()) {
+				if (param.variants) step.variants.push_back(node->variant(param.name));
+			}
+
+			if (node->multiPassNode()) {
+				step.subtree = std::make_unique<CpuProgram>();
+				if (!buildCpuProgram(collectNodes(inputSources(node), false), *step.subtree)) return false;
 			}
-			
 		}
+
+		GraphicsNode* lastNode = nodes.empty() ? nullptr : nodes.back();
+		if (lastNode && !lastNode->outputNode() && lastNode->outputCount() > 0) {
+			program.returnsValue = true;
+			program.resultSlot = slots[lastNode];
+			program.resultType = lastNode->texture(0).type;
+		}
+		return true;
 	}
 
-	void setUniforms(size_t startBinding) {
-		size_t binding = startBinding;
-		for (size_t i = m_nodePath.size(); i-- > 0;) {
-			auto node = static_cast<GraphicsNode*>(get(m_nodePath[i]));
-			setNodeUniforms(node, binding);
+	// where solveFor and checkParams get a function parameter from, as a CPU argument
+	bool resolveArgument(
+		GraphicsNode* node,
+		const ShaderFunctionParam& paramOb,
+		const std::unordered_map<Node*, size_t>& slots,
+		CpuProgram::Argument& argument
+	) {
+		static const Symbol builtinUV = "cUV";
+		auto& nodeParams = node->bindings();
+		argument.to = paramOb.type;
+
+		auto fromOutput = [&](const Connection& con) {
+			auto slot = slots.find(con.source);
+			if (slot == slots.end()) {
+				m_lastError = std::format("node {} reads node {}, which doesn't run before it", node->id(), con.source->id());
+				return false;
+			}
+			argument.kind = CpuProgram::Argument::source;
+			argument.slot = slot->second + con.sourceOutput;
+			argument.from = con.source->texture(con.sourceOutput).type;
+			return true;
+		};
+
+		auto constant = [&](const RawValue& value, ValueType type) {
+			argument.kind = CpuProgram::Argument::constant;
+			argument.value = value;
+			argument.from = type;
+			return true;
+		};
+
+		Symbol inputParamName;
+		if (auto binding = nodeParams.find(paramOb.symbol); binding != nodeParams.end()) {
+			inputParamName = binding->second.first;
+		}
+
+		size_t inputIndex = node->inputIndex(inputParamName);
+		if (inputIndex < node->inputCount()) {
+			auto conns = getConnectionsToInput(node, inputIndex);
+			if (!conns.empty()) return fromOutput(conns.front());
+		}
+
+		if (auto param = node->findParam(inputParamName)) {
+			if (param->value.type == ValueType::image) {
+				m_lastError = std::format("node {} reads an image, there's no CPU path for it", node->id());
+				return false;
+			}
+			if (param->variants) return constant({ float(node->variant(param->name)), 0.0f, 0.0f, 0.0f }, ValueType::scalar);
+			return constant(param->value.value, param->value.type);
+		}
+
+		if (inputParamName == builtinUV) {
+			argument.kind = CpuProgram::Argument::uv;
+			argument.from = ValueType::vec2;
+			return true;
+		}
+
+		// the texture coords input, or cUV
+		for (auto&& [fnParam, ndParam] : nodeParams) {
+			if (ndParam.second != SpecialType::textureCoords) continue;
+
+			auto conns = getConnectionsToInput(node, node->inputIndex(ndParam.first));
+			if (!conns.empty()) {
+				if (!fromOutput(conns.front())) return false;
+				argument.via = ValueType::vec2;
+				return true;
+			}
+			argument.kind = CpuProgram::Argument::uv;
+			argument.from = ValueType::vec2;
+			return true;
 		}
+
+		return constant({ 0.0f, 0.0f, 0.0f, 0.0f }, paramOb.type);
 	}
 
 	bool checkParams(
 		ShaderGen& gen,
 		GraphicsNode* node,
-		const std::string& inputParamName,
+		Symbol inputParamName,
 		SpecialType specialType,
 		ValueType paramType
 	) {
-		auto nodeParams = node->parameters();
+		static const Symbol builtinUV = "cUV";
+		auto& nodeParams = node->bindings();
 
-		if (node->hasParam(inputParamName)) {
-			auto&& nv = node->param(inputParamName);
+		if (auto param = node->findParam(inputParamName)) {
+			auto&& nv = param->value;
 
 			if (nv.type == ValueType::image) {
 				// find a texCoord input
-				std::string uvsName = "";
+				Symbol uvsName;
 				SpecialType uvsSpecialType = SpecialType::none;
 				ValueType uvsType = ValueType::none;
 
-				for (auto [fnParam, ndParam] : nodeParams) {
+				for (auto&& [fnParam, ndParam] : nodeParams) {
 					if (ndParam.second == SpecialType::textureCoords) {
 						uvsName = ndParam.first;
 						uvsSpecialType = ndParam.second;
@@ -362,7 +1337,7 @@ private:
 					}
 				}
 
-				gen.append(std::format("Tex(param_{}_{}, ", node->id(), toCamelCase(inputParamName)));
+				gen.append(std::format("Tex(param_{}_{}, ", node->id(), param->key.str()));
 				if (uvsType != ValueType::none) {
 					gen.convertType(uvsType, ValueType::vec2, varName);
 					gen.append(")");
@@ -371,8 +1346,11 @@ private:
 					gen.append("cUV)");
 				}
 			}
+			else if (param->variants) { // compiled in
+				gen.convertType(nv.type, paramType, std::format("{}.0", node->variant(param->name)));
+			}
 			else {
-				std::string varName = std::format("param_{}_{}", node->id(), toCamelCase(inputParamName));
+				std::string varName = std::format("param_{}_{}", node->id(), param->key.str());
 				gen.convertType(nv.type, paramType, varName);
 			}
 
@@ -381,16 +1359,16 @@ private:
 		// iv
 		else {
 			// TODO: Implement a proper built-in system. We only have the UVs for now
-			if (inputParamName == "cUV") {
+			if (inputParamName == builtinUV) {
 				gen.convertType(ValueType::vec2, paramType, "cUV");
 			}
 			else {
 				// find a texCoord input
-				std::string uvsName = "";
+				Symbol uvsName;
 				SpecialType uvsSpecialType = SpecialType::none;
 				ValueType uvsType = ValueType::none;
 
-				for (auto [fnParam, ndParam] : nodeParams) {
+				for (auto&& [fnParam, ndParam] : nodeParams) {
 					if (ndParam.second == SpecialType::textureCoords) {
 						uvsName = ndParam.first;
 						uvsSpecialType = ndParam.second;
@@ -125,11 +125,12 @@ static Control* gui_ColorNode(VisualNode* node) {
 	const std::string labels[] = { "Red", "Geen", "Blue", "Alpha" };
 
 	GraphicsNode* nd = (GraphicsNode*)node->node();
+	const Symbol colorParam = "Color";
 	for (size_t i = 0; i < 4; i++) {
 		auto ctrl = gui_ValueSlider(
-			labels[i], nd->param("Color").value[i],
+			labels[i], nd->param(colorParam).value[i],
 			[=](float v) {
-				nd->setParam("Color", i, v);
+				nd->setParam(colorParam, i, v);
 			}
 		);
 		pnl->addChild(ctrl);
@@ -146,6 +147,8 @@ static Control* gui_MixNode(VisualNode* node) {
 	pnl->setLayout(new ColumnLayout());
 
 	GraphicsNode* nd = (GraphicsNode*)node->node();
+	const Symbol modeParam = "Mode";
+	const Symbol factorParam = "Factor";
 
 	RadioSelector* rsel = new RadioSelector();
 	rsel->bounds = { 0, 0, 0, 25 };
@@ -153,16 +156,16 @@ static Control* gui_MixNode(VisualNode* node) {
 	rsel->addOption(1, "Add");
 	rsel->addOption(2, "Sub");
 	rsel->addOption(3, "Mul");
-	rsel->select(int(nd->param("Mode").value[0]));
+	rsel->select(int(nd->param(modeParam).value[0]));
 	rsel->onSelect = [=](int index) {
-		nd->setParam("Mode", float(index));
+		nd->setParam(modeParam, float(index));
 	};
 	pnl->addChild(rsel);
 
 	auto ctrl = gui_ValueSlider(
-		"Factor", nd->param("Factor").value[0],
+		"Factor", nd->param(factorParam).value[0],
 		[=](float v) {
-			nd->setParam("Factor", v);
+			nd->setParam(factorParam, v);
 		}
 	);
 	pnl->addChild(ctrl);
@@ -177,6 +180,7 @@ static Control* gui_SimpleGradientNode(VisualNode* node) {
 	pnl->setLayout(new ColumnLayout());
 
 	GraphicsNode* nd = (GraphicsNode*)node->node();
+	const Symbol angleParam = "Angle";
 
 	Label* lbl = new Label();
 	lbl->text = "Angle";
@@ -185,9 +189,9 @@ static Control* gui_SimpleGradientNode(VisualNode* node) {
 	//gui->addControl(lbl);
 
 	Slider* sld = new Slider();
-	sld->value = nd->param("Angle").value[0];
+	sld->value = nd->param(angleParam).value[0];
 	sld->onChange = [=](float v) {
-		nd->setParam("Angle", v);
+		nd->setParam(angleParam, v);
 	};
 	sld->min = -PI;
 	sld->max = PI;
@@ -200,31 +204,45 @@ static Control* gui_SimpleGradientNode(VisualNode* node) {
 static Control* gui_NoiseNode(VisualNode* node) {
 	Panel* pnl = new Panel();
 	pnl->drawBackground(false);
-	pnl->bounds = { 0, 0, 0, 60 };
+	pnl->bounds = { 0, 0, 0, 85 };
 	pnl->setLayout(new ColumnLayout());
 
 	GraphicsNode* nd = (GraphicsNode*)node->node();
+	const Symbol hashParam = "Hash";
+	const Symbol scaleParam = "Scale";
+	const Symbol patternXParam = "Pattern X";
+	const Symbol patternYParam = "Pattern Y";
+
+	RadioSelector* rsel = new RadioSelector();
+	rsel->bounds = { 0, 0, 0, 25 };
+	rsel->addOption(0, "Sine");
+	rsel->addOption(1, "Integer");
+	rsel->select(int(nd->param(hashParam).value[0]));
+	rsel->onSelect = [=](int index) {
+		nd->setParam(hashParam, float(index));
+	};
 
 	auto scale = gui_ValueSlider(
-		"Scale", nd->param("Scale").value[0],
+		"Scale", nd->param(scaleParam).value[0],
 		[=](float v) {
-			nd->setParam("Scale", v);
+			nd->setParam(scaleParam, v);
 		},
 		1.0f, 99.0f
 	);
 	auto patx = gui_ValueSlider(
-		"Pattern X", nd->param("Pattern X").value[0],
+		"Pattern X", nd->param(patternXParam).value[0],
 		[=](float v) {
-			nd->setParam("Pattern X", v);
+			nd->setParam(patternXParam, v);
 		}
 	);
 	auto paty = gui_ValueSlider(
-		"Pattern Y", nd->param("Pattern Y").value[0],
+		"Pattern Y", nd->param(patternYParam).value[0],
 		[=](float v) {
-			nd->setParam("Pattern Y", v);
+			nd->setParam(patternYParam, v);
 		}
 	);
 
+	pnl->addChild(rsel);
 	pnl->addChild(scale);
 	pnl->addChild(patx);
 	pnl->addChild(paty);
@@ -239,17 +257,19 @@ static Control* gui_ThresholdNode(VisualNode* node) {
 	pnl->setLayout(new ColumnLayout());
 
 	GraphicsNode* nd = (GraphicsNode*)node->node();
+	const Symbol thresholdParam = "Threshold";
+	const Symbol featherParam = "Feather";
 
 	auto thr = gui_ValueSlider(
-		"Threshold", nd->param("Threshold").value[0],
+		"Threshold", nd->param(thresholdParam).value[0],
 		[=](float v) {
-			nd->setParam("Threshold", v);
+			nd->setParam(thresholdParam, v);
 		}
 	);
 	auto feat = gui_ValueSlider(
-		"Feather", nd->param("Feather").value[0],
+		"Feather", nd->param(featherParam).value[0],
 		[=](float v) {
-			nd->setParam("Feather", v);
+			nd->setParam(featherParam, v);
 		}
 	);
 
@@ -264,6 +284,7 @@ static Control* gui_ImageNode(VisualNode* node) {
 	btn->text = "Load Texture";
 
 	ImageNode* nd = (ImageNode*)node->node();
+	const Symbol imageParam = "Image";
 	
 	btn->bounds = { 0, 0, 0, 25 };
 	btn->onPress = [=]() {
@@ -278,13 +299,17 @@ static Control* gui_ImageNode(VisualNode* node) {
 				delete nd->handle;
 			}
 
+			// stbi_loadf linearizes 8-bit files with a 2.2 gamma, what graphs were
+			// made with. Half floats keep that, an rgba8 image would feed the graph
+			// sRGB values (and image load/store can't take sRGB textures)
 			int w, h, comp;
 			auto data = stbi_loadf(fp.result().front().c_str(), &w, &h, &comp, STBI_rgb_alpha);
-
-			nd->handle = new Texture({ uint32_t(w), uint32_t(h) }, GL_RGBA32F);
+			nd->handle = new Texture({ uint32_t(w), uint32_t(h) }, GL_RGBA16F);
 			nd->handle->loadFromMemory(data, GL_RGBA, GL_FLOAT);
+			stbi_image_free(data);
+			nd->setParamFormat(imageParam, StorageFormat::rgba16f);
 
-			nd->setParam("Image", float(nd->handle->id()));
+			nd->setParam(imageParam, float(nd->handle->id()));
 		}
 	};
 	return btn;
@@ -297,39 +322,45 @@ static Control* gui_UVNode(VisualNode* node) {
 	pnl->setLayout(new ColumnLayout());
 
 	GraphicsNode* nd = (GraphicsNode*)node->node();
+	const Symbol clampParam = "Clamp";
+	const Symbol deformAmountParam = "Deform Amount";
+	const Symbol repeatParam = "Repeat";
+	const Symbol positionParam = "Position";
+	const Symbol scaleParam = "Scale";
+	const Symbol rotationParam = "Rotation";
 
 	RadioSelector* rsel = new RadioSelector();
 	rsel->bounds = { 0, 0, 0, 25 };
 	rsel->addOption(0, "Clamp");
 	rsel->addOption(1, "Repeat");
 	rsel->addOption(2, "Mirror");
-	rsel->select(int(nd->param("Clamp").value[0]));
+	rsel->select(int(nd->param(clampParam).value[0]));
 	rsel->onSelect = [=](int index) {
-		nd->setParam("Clamp", float(index));
+		nd->setParam(clampParam, float(index));
 	};
 	pnl->addChild(rsel);
 
 	auto defAmt = gui_ValueSlider(
-		"Def. Amt.", nd->param("Deform Amount").value[0],
+		"Def. Amt.", nd->param(deformAmountParam).value[0],
 		[=](float v) {
-			nd->setParam("Deform Amount", v);
+			nd->setParam(deformAmountParam, v);
 		}
 	);
 	pnl->addChild(defAmt);
 
-	auto rep = gui_Vector<2ull>("Repeat", nd->paramValue("Repeat"));
+	auto rep = gui_Vector<2ull>("Repeat", nd->paramValue(repeatParam));
 	pnl->addChild(rep);
 
-	auto pos = gui_Vector<2ull>("Position", nd->paramValue("Position"));
+	auto pos = gui_Vector<2ull>("Position", nd->paramValue(positionParam));
 	pnl->addChild(pos);
 
-	auto scl = gui_Vector<2ull>("Scale", nd->paramValue("Scale"));
+	auto scl = gui_Vector<2ull>("Scale", nd->paramValue(scaleParam));
 	pnl->addChild(scl);
 
 	auto rot = gui_ValueSlider(
-		"Rotation", nd->param("Rotation").value[0],
+		"Rotation", nd->param(rotationParam).value[0],
 		[=](float v) {
-			nd->setParam("Rotation", v);
+			nd->setParam(rotationParam, v);
 		},
 		0.0f, PI * 2.0f, 0.01f
 	);
@@ -345,11 +376,12 @@ static Control* gui_NormalMapNode(VisualNode* node) {
 	pnl->setLayout(new ColumnLayout());
 
 	GraphicsNode* nd = (GraphicsNode*)node->node();
+	const Symbol scaleParam = "Scale";
 
 	auto ctrl = gui_ValueSlider(
-		"Scale", nd->param("Scale").value[0],
+		"Scale", nd->param(scaleParam).value[0],
 		[=](float v) {
-			nd->setParam("Scale", v);
+			nd->setParam(scaleParam, v);
 		},
 		0.01f, 1.0f, 0.01f
 	);
@@ -366,11 +398,12 @@ static Control* gui_CircleShapeNode(VisualNode* node) {
 	pnl->setLayout(new ColumnLayout());
 
 	GraphicsNode* nd = (GraphicsNode*)node->node();
+	const Symbol radiusParam = "Radius";
 
 	auto ctrl = gui_ValueSlider(
-		"Radius", nd->param("Radius").value[0],
+		"Radius", nd->param(radiusParam).value[0],
 		[=](float v) {
-			nd->setParam("Radius", v);
+			nd->setParam(radiusParam, v);
 		},
 		0.01f, 1.0f, 0.01f
 	);
@@ -390,12 +423,14 @@ static Control* gui_BoxShapeNode(VisualNode* node) {
 	const std::string labelsBounds[] = { "Width", "Height" };
 
 	GraphicsNode* nd = (GraphicsNode*)node->node();
+	const Symbol boundsParam = "Bounds";
+	const Symbol borderRadiusParam = "Border Radius";
 
 	for (size_t i = 0; i < 2; i++) {
 		auto ctrl = gui_ValueSlider(
-			labelsBounds[i], nd->param("Bounds").value[i],
+			labelsBounds[i], nd->param(boundsParam).value[i],
 			[=](float v) {
-				nd->setParam("Bounds", i, v);
+				nd->setParam(boundsParam, i, v);
 			},
 			0.0f, 1.0f, 0.01f
 		);
@@ -405,9 +440,9 @@ static Control* gui_BoxShapeNode(VisualNode* node) {
 
 	for (size_t i = 0; i < 4; i++) {
 		auto ctrl = gui_ValueSlider(
-			labelsCorners[i], nd->param("Border Radius").value[i],
+			labelsCorners[i], nd->param(borderRadiusParam).value[i],
 			[=](float v) {
-				nd->setParam("Border Radius", i, v);
+				nd->setParam(borderRadiusParam, i, v);
 			},
 			0.0f, 1.0f, 0.01f
 		);
@@ -418,6 +453,30 @@ static Control* gui_BoxShapeNode(VisualNode* node) {
 	return pnl;
 }
 
+static Control* gui_OutputNode(VisualNode* node) {
+	Panel* pnl = new Panel();
+	pnl->drawBackground(false);
+	pnl->bounds = { 0, 0, 0, 30 };
+	pnl->setLayout(new ColumnLayout());
+
+	OutputNode* nd = (OutputNode*)node->node();
+
+	// 0 picks one from what's connected
+	RadioSelector* rsel = new RadioSelector();
+	rsel->bounds = { 0, 0, 0, 25 };
+	rsel->addOption(0, "Auto");
+	for (size_t i = 0; i < std::size(storageFormats); i++) {
+		rsel->addOption(int(i) + 1, std::string(storageFormats[i].name));
+	}
+	rsel->select(nd->format ? int(*nd->format) + 1 : 0);
+	rsel->onSelect = [=](int index) {
+		nd->setFormat(index > 0 ? std::optional(StorageFormat(index - 1)) : std::nullopt);
+	};
+	pnl->addChild(rsel);
+
+	return pnl;
+}
+
 static NodeContructor nodeTypes[] = {
 	{ "COL", "Color", NodeCtor(ColorNode, generatorNodeColor), gui_ColorNode },
 	{ "MIX", "Mix", NodeCtor(MixNode, operatorNodeColor), gui_MixNode },
@@ -429,7 +488,7 @@ static NodeContructor nodeTypes[] = {
 	{ "UVS", "UV", NodeCtor(UVNode, generatorNodeColor), gui_UVNode },
 	{ "RGR", "Radial Gradient", NodeCtor(RadialGradientNode, generatorNodeColor), nullptr },
 	{ "NRM", "Normal Map", NodeCtor(NormalMapNode, multisampleNodeColor), gui_NormalMapNode },
-	{ "OUT", "Output", NodeCtor(OutputNode, resultNodeColor), nullptr },
+	{ "OUT", "Output", NodeCtor(OutputNode, resultNodeColor), gui_OutputNode },
 
 	{ "SCIRCLE", "Circle", NodeCtor(CircleShapeNode, generatorNodeColor), gui_CircleShapeNode },
 	{ "SBOX", "Box", NodeCtor(BoxShapeNode, generatorNodeColor), gui_BoxShapeNode },
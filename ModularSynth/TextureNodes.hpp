@@ -1,10 +1,17 @@
 #pragma once
 
 #include "GraphicsNode.h"
+#include "CpuBackend.h"
 #include "Texture.h"
+#include "Voronoise.h"
 
+#include <string_view>
+
+// the webcam node captures through escapi, Windows only
+#ifdef _WIN32
 #include "escapi.h"
 #include <Windows.h>
+#endif
 
 class ColorNode : public GraphicsNode {
 public:
@@ -27,6 +34,11 @@ public:
 		addParam("Color", ValueType::vec4);
 	}
 
+	bool evaluate(CpuArgs& args) override {
+		args.set(0, args.get(0));
+		return true;
+	}
+
 };
 
 class SimpleGradientNode : public GraphicsNode {
@@ -55,6 +67,18 @@ public:
 		addInput("UV", ValueType::vec2);
 		addParam("Angle", ValueType::scalar);
 	}
+
+	bool evaluate(CpuArgs& args) override {
+		CpuValue uv = args.get(0);
+		CpuScalar angle = args.scalar(1);
+		CpuScalar c = cos(angle), s = sin(angle);
+
+		// the x of mat2(c, -s, s, c) * (uv * 2.0 - 1.0)
+		CpuScalar x = uv.x * 2.0f - 1.0f, y = uv.y * 2.0f - 1.0f;
+		CpuScalar res = clamp((c * x + s * y) * 0.5f + 0.5f, 0.0f, 1.0f);
+		args.set(0, { res });
+		return true;
+	}
 };
 
 class MixNode : public GraphicsNode {
@@ -68,38 +92,30 @@ public:
 void opr_mix_add(float fac, vec4 ca, vec4 cb, out vec4 outColor) {
 	outColor = mix(ca, ca + cb, clamp(fac, 0.0, 1.0));
 	outColor.a = ca.a;
-})
+}
 
 void opr_mix_sub(float fac, vec4 ca, vec4 cb, out vec4 outColor) {
 	outColor = mix(ca, ca - cb, clamp(fac, 0.0, 1.0));
 	outColor.a = ca.a;
-})
+}
 
 void opr_mix_mul(float fac, vec4 ca, vec4 cb, out vec4 outColor) {
 	outColor = mix(ca, ca * cb, clamp(fac, 0.0, 1.0));
 	outColor.a = ca.a;
 }
-
-void opr_mix(float fac, float op, vec4 ca, vec4 cb, out vec4 outColor) {
-	if (op == 1.0) { // Add
-		opr_mix_add(fac, ca, cb, outColor);
-	} else if (op == 2.0) { // Sub
-		opr_mix_sub(fac, ca, cb, outColor);
-	} else if (op == 3.0) { // Multiply
-		opr_mix_mul(fac, ca, cb, outColor);
-	} else {
-		opr_mix_blend(fac, ca, cb, outColor);
-	}
-}
 )";
 	}
 
-	std::string functionName() { return "opr_mix"; }
+	// the mode is a specialization param, only its function goes in the shader
+	std::string functionName() {
+		static const std::string modes[] = { "opr_mix_blend", "opr_mix_add", "opr_mix_sub", "opr_mix_mul" };
+		static const Symbol modeParam = "Mode";
+		return modes[variant(modeParam)];
+	}
 
 	GraphicsNodeParams parameters() {
 		return {
 			{ "fac", { "Factor", SpecialType::none } },
-			{ "op", { "Mode", SpecialType::none } },
 			{ "ca", { "A", SpecialType::none } },
 			{ "cb", { "B", SpecialType::none } }
 		};
@@ -110,17 +126,39 @@ void opr_mix(float fac, float op, vec4 ca, vec4 cb, out vec4 outColor) {
 		addInput("B", ValueType::vec4);
 		addInput("Factor", ValueType::scalar);
 		addParam("Factor", ValueType::scalar);
-		addParam("Mode", ValueType::scalar);
+		addSpecializationParam("Mode", 4);
 		setParam("Factor", 0.5f);
 		setParam("Mode", 0.0f);
 		addOutput("Output", ValueType::vec4);
 	}
 
+	bool evaluate(CpuArgs& args) override {
+		CpuScalar fac = clamp(args.scalar(0), 0.0f, 1.0f);
+		CpuValue ca = args.get(1), cb = args.get(2);
+
+		CpuValue other = cb;
+		switch (args.variant()) {
+			case 1: other = { ca.x + cb.x, ca.y + cb.y, ca.z + cb.z, ca.w + cb.w }; break;
+			case 2: other = { ca.x - cb.x, ca.y - cb.y, ca.z - cb.z, ca.w - cb.w }; break;
+			case 3: other = { ca.x * cb.x, ca.y * cb.y, ca.z * cb.z, ca.w * cb.w }; break;
+			default: break;
+		}
+
+		args.set(0, { mix(ca.x, other.x, fac), mix(ca.y, other.y, fac), mix(ca.z, other.z, fac), ca.w });
+		return true;
+	}
+
 };
 
 class NoiseNode : public GraphicsNode {
 public:
-	std::string functionName() { return "gen_noise"; }
+	// the hash is a specialization param: 0 is the sin hash graphs were saved
+	// with before there was a choice, 1 the template's integer ihash3 (see
+	// IntHash.h and Voronoise.h), the same bits on the CPU
+	std::string functionName() {
+		static const Symbol hashParam = "Hash";
+		return variant(hashParam) ? "gen_noise_fast" : "gen_noise";
+	}
 
 	std::string library() {
 		return R"(void noise(vec2 n, out float res) {
@@ -187,6 +225,32 @@ void iqnoise(vec2 x, float u, float v, out float res) {
 
 void gen_noise(in vec2 uv, float scale, float patternX, float patternY, out float res) {
 	iqnoise(uv * scale, patternX, patternY, res);
+}
+
+void iqnoise_fast(vec2 x, float u, float k, out float res) {
+	vec2 p = floor(x);
+	vec2 f = fract(x);
+
+	float va = 0.0;
+	float wt = 0.0;
+	for (int j = -2; j <= 2; j++)
+	for (int i = -2; i <= 2; i++)
+	{
+		vec2 g = vec2(float(i), float(j));
+		vec3 o = ihash3(p + g) * vec3(u, u, 1.0);
+		vec2 r = g - f + o.xy;
+		float d = dot(r, r);
+		if (d >= 1.414 * 1.414) continue; // weighs 0
+		float ww = pow(1.0 - smoothstep(0.0, 1.414, sqrt(d)), k);
+		va += o.z * ww;
+		wt += ww;
+	}
+
+	res = va / wt;
+}
+
+void gen_noise_fast(in vec2 uv, float scale, float patternX, float patternY, out float res) {
+	iqnoise_fast(uv * scale, patternX, 1.0 + 63.0 * pow(1.0 - patternY, 4.0), res);
 })";
 	}
 
@@ -205,9 +269,23 @@ void gen_noise(in vec2 uv, float scale, float patternX, float patternY, out floa
 		addParam("Pattern Y", ValueType::scalar);
 		addParam("Scale", ValueType::scalar);
 		setParam("Scale", 1.0f);
+		addSpecializationParam("Hash", 2);
+		setParam("Hash", 1.0f);
 		addOutput("Output", ValueType::scalar);
 	}
 
+	// iqnoise(uv * scale, patternX, patternY). The 25 cells are one fused op,
+	// k only depends on the param and folds
+	bool evaluate(CpuArgs& args) override {
+		CpuValue uv = args.get(0);
+		CpuScalar scale = args.scalar(1), u = args.scalar(2), v = args.scalar(3);
+
+		CpuScalar k = 1.0f + pow(1.0f - v, 4.0f) * 63.0f;
+		if (args.variant()) args.set(0, { fused(&voronoise::fast, 25 * 30, { uv.x * scale, uv.y * scale, u, k }) });
+		else args.set(0, { fused(&voronoise::classic, 25 * 80, { uv.x * scale, uv.y * scale, u, k }) });
+		return true;
+	}
+
 };
 
 class ThresholdNode : public GraphicsNode {
@@ -242,6 +320,15 @@ public:
 		addOutput("Output", ValueType::scalar);
 	}
 
+	bool evaluate(CpuArgs& args) override {
+		CpuValue color = args.get(0);
+		CpuScalar threshold = args.scalar(1), fac = args.scalar(2) / 2.0f;
+
+		CpuScalar luma = color.x * 0.299f + color.y * 0.587f + color.z * 0.114f;
+		args.set(0, { smoothstep(threshold - fac, threshold + fac, luma) * color.w });
+		return true;
+	}
+
 };
 
 class ImageNode : public GraphicsNode {
@@ -267,7 +354,11 @@ public:
 		addOutput("Output", ValueType::vec4);
 	}
 
-	Texture* handle;
+	~ImageNode() {
+		delete handle;
+	}
+
+	Texture* handle{ nullptr };
 
 };
 
@@ -299,20 +390,12 @@ vec2 op_rep(in vec2 p, vec2 count) {
     return nuv;
 }
 
-void out_uv(
-	vec2 uvIn, float clampMode, float deformAmt, vec2 deform,
-
-	vec2 repeatCount,
-
-	vec2 pos, vec2 scale, float rot,
-
-	out vec2 duv
-) {
+void uv_transform(vec2 uvIn, float deformAmt, vec2 deform, vec2 pos, vec2 scale, float rot, out vec2 uv) {
 	vec2 sz = bOutputSize;
 	float s = sin(rot);
 	float c = cos(rot);
 
-	vec2 uv = uvIn;
+	uv = uvIn;
 
 	uv += ((deform * 2.0 - 1.0) * deformAmt);
 
@@ -324,26 +407,39 @@ void out_uv(
 		mat2(c, -s, s, c);	
 	uv *= xform;
 	uv += pos + vec2(0.5);
+}
 
-	if (clampMode == 0.0) { // clamp to edge
-		uv = clamp(uv, 0.0, 1.0);
-	} else if (clampMode == 1.0) { // repeat
-		uv = mod(uv, 1.0);
-	} else if (clampMode == 2.0) { // mirror
-		mirrored(uv, uv);
-	}
+void out_uv_clamp(vec2 uvIn, float deformAmt, vec2 deform, vec2 repeatCount, vec2 pos, vec2 scale, float rot, out vec2 duv) {
+	vec2 uv;
+	uv_transform(uvIn, deformAmt, deform, pos, scale, rot, uv);
+	duv = op_rep(clamp(uv, 0.0, 1.0), repeatCount);
+}
+
+void out_uv_repeat(vec2 uvIn, float deformAmt, vec2 deform, vec2 repeatCount, vec2 pos, vec2 scale, float rot, out vec2 duv) {
+	vec2 uv;
+	uv_transform(uvIn, deformAmt, deform, pos, scale, rot, uv);
+	duv = op_rep(mod(uv, 1.0), repeatCount);
+}
 
+void out_uv_mirror(vec2 uvIn, float deformAmt, vec2 deform, vec2 repeatCount, vec2 pos, vec2 scale, float rot, out vec2 duv) {
+	vec2 uv;
+	uv_transform(uvIn, deformAmt, deform, pos, scale, rot, uv);
+	mirrored(uv, uv);
 	duv = op_rep(uv, repeatCount);
 }
 )";
 	}
 
-	std::string functionName() { return "out_uv"; }
+	// the clamp mode is a specialization param, only its function goes in the shader
+	std::string functionName() {
+		static const std::string modes[] = { "out_uv_clamp", "out_uv_repeat", "out_uv_mirror" };
+		static const Symbol clampParam = "Clamp";
+		return modes[variant(clampParam)];
+	}
 
 	GraphicsNodeParams parameters() {
 		return {
 			{ "uvIn", { "cUV", SpecialType::none } },
-			{ "clampMode", { "Clamp", SpecialType::none } },
 			{ "deformAmt", { "Deform Amount", SpecialType::none } },
 			{ "deform", { "Deform", SpecialType::none } },
 			{ "repeatCount", { "Repeat", SpecialType::none } },
@@ -363,7 +459,7 @@ void out_uv(
 		addParam("Rotation", ValueType::scalar);
 		setParam("Scale", 1.0f, 1.0f);
 
-		addParam("Clamp", ValueType::scalar);
+		addSpecializationParam("Clamp", 3);
 
 		addParam("Deform Amount", ValueType::scalar);
 		setParam("Deform Amount", 1.0f);
@@ -371,6 +467,48 @@ void out_uv(
 		addOutput("Output", ValueType::vec2);
 	}
 
+	bool evaluate(CpuArgs& args) override {
+		CpuValue uvIn = args.get(0), deform = args.get(2), count = args.get(3), pos = args.get(4), scale = args.get(5);
+		CpuScalar deformAmt = args.scalar(1), rot = args.scalar(6);
+
+		// uv_transform
+		CpuScalar s = sin(rot), c = cos(rot);
+		CpuScalar x = uvIn.x + (deform.x * 2.0f - 1.0f) * deformAmt;
+		CpuScalar y = uvIn.y + (deform.y * 2.0f - 1.0f) * deformAmt;
+		x = x * (args.width() / args.height()) - 0.5f;
+		y = y - 0.5f;
+
+		// uv *= mat2(scale.x, 0, 0, scale.y) * mat2(c, -s, s, c)
+		CpuScalar tx = x * scale.x * c - y * scale.y * s;
+		CpuScalar ty = x * scale.x * s + y * scale.y * c;
+		x = tx + pos.x + 0.5f;
+		y = ty + pos.y + 0.5f;
+
+		switch (args.variant()) {
+			case 1: // repeat
+				x = mod(x, 1.0f);
+				y = mod(y, 1.0f);
+				break;
+			case 2: { // mirror
+				CpuScalar mx = mod(x, 2.0f), my = mod(y, 2.0f);
+				x = mix(mx, 2.0f - mx, step(1.0f, mx));
+				y = mix(my, 2.0f - my, step(1.0f, my));
+				break;
+			}
+			default:
+				x = clamp(x, 0.0f, 1.0f);
+				y = clamp(y, 0.0f, 1.0f);
+				break;
+		}
+
+		// op_rep, the longer side is repeated more
+		CpuScalar nx = fract(x * count.x), ny = fract(y * count.y);
+		CpuScalar ratio = max(count.x, count.y) / min(count.x, count.y);
+		CpuScalar tall = count.y > count.x;
+		args.set(0, { select(tall, nx * ratio, nx), select(tall, ny, ny * ratio) });
+		return true;
+	}
+
 };
 
 class RadialGradientNode : public GraphicsNode {
@@ -394,6 +532,14 @@ public:
 		addOutput("Output", ValueType::scalar);
 		addInput("UV", ValueType::vec2);
 	}
+
+	bool evaluate(CpuArgs& args) override {
+		CpuValue uv = args.get(0);
+		CpuScalar x = clamp(uv.x, 0.0f, 1.0f) * 2.0f - 1.0f;
+		CpuScalar y = clamp(uv.y, 0.0f, 1.0f) * 2.0f - 1.0f;
+		args.set(0, { 1.0f - sqrt(x * x + y * y) });
+		return true;
+	}
 };
 
 class NormalMapNode : public GraphicsNode {
@@ -403,7 +549,7 @@ public:
 	}
 
 	std::string library() {
-		return R"(void gen_normal_map(in vec2 uv, float scale, out vec3 res) {
+		return R"(void gen_normal_map_$NODE(in vec2 uv, float scale, out vec3 res) {
 	vec2 step = 1.0 / bOutputSize;
 
 	float height = rgb_to_float($TREE(uv).rgb);
@@ -416,7 +562,7 @@ public:
 })";
 	}
 
-	std::string functionName() { return "gen_normal_map"; }
+	std::string functionName() { return "gen_normal_map_$NODE"; }
 
 	GraphicsNodeParams parameters() {
 		return {
@@ -431,6 +577,22 @@ public:
 		addParam("Scale", ValueType::scalar);
 		setParam("Scale", 0.1f);
 	}
+
+	bool evaluate(CpuArgs& args) override {
+		CpuValue uv = args.get(0);
+		CpuScalar scale = args.scalar(1);
+		CpuScalar stepX = 1.0f / args.width(), stepY = 1.0f / args.height();
+
+		CpuScalar height = rgbToFloat(args.sample(uv));
+		CpuScalar s1 = rgbToFloat(args.sample({ uv.x + stepX, uv.y }));
+		CpuScalar s2 = rgbToFloat(args.sample({ uv.x, uv.y + stepY }));
+
+		// normalize(vec3(dxy * scale / step, 1.0)) * 0.5 + 0.5
+		CpuScalar nx = (height - s1) * scale / stepX, ny = (height - s2) * scale / stepY;
+		CpuScalar inv = 1.0f / sqrt(nx * nx + ny * ny + 1.0f);
+		args.set(0, { nx * inv * 0.5f + 0.5f, ny * inv * 0.5f + 0.5f, inv * 0.5f + 0.5f });
+		return true;
+	}
 };
 
 class OutputNode : public GraphicsNode {
@@ -438,11 +600,12 @@ public:
 	std::string library() {
 		return R"(
 void emit_out_$NODE(in vec2 uv, vec4 color) {
-	imageStore(bOutput$NODE, ivec2(uv * vec2(imageSize(bOutput$NODE))), color);
+	imageStore(bOutput$NODE, ivec2(gl_GlobalInvocationID.xy), color);
 })";
 	}
 
 	std::string functionName() { return "emit_out_$NODE"; }
+	bool outputNode() override { return true; }
 
 	GraphicsNodeParams parameters() {
 		return {
@@ -455,21 +618,42 @@ void emit_out_$NODE(in vec2 uv, vec4 color) {
 		addInput("Color", ValueType::vec4);
 	}
 
-	bool render(uint32_t width, uint32_t height, size_t binding = 0) override {
-		if (!texture) {
-			texture = std::unique_ptr<Texture>(new Texture({ width, height }, GL_RGBA32F));
-		}
-		else {
-			if (texture->size()[0] != width || texture->size()[1] != height) {
-				texture.reset(nullptr);
-				texture = std::unique_ptr<Texture>(new Texture({ width, height }, GL_RGBA32F));
-			}
+	bool evaluate(CpuArgs& args) override {
+		args.emit(args.get(1));
+		return true;
+	}
+
+	std::optional<StorageFormat> requestedFormat() override { return format; }
+
+	void setFormat(std::optional<StorageFormat> value) {
+		format = value;
+		invalidateStructure();
+	}
+
+	bool render(uint32_t width, uint32_t height, size_t binding = 0, StorageFormat storage = StorageFormat::rgba32f) override {
+		auto& info = formatInfo(storage);
+		if (!texture || texture->size()[0] != width || texture->size()[1] != height || texture->internalFormat() != info.internalFormat) {
+			texture.reset(nullptr);
+			texture = std::unique_ptr<Texture>(new Texture({ width, height }, info.internalFormat));
 		}
 
-		glBindImageTexture(binding, texture->id(), 0, false, 0, GL_WRITE_ONLY, GL_RGBA32F);
+		glBindImageTexture(binding, texture->id(), 0, false, 0, GL_WRITE_ONLY, info.internalFormat);
 		return true;
 	}
 
+	// 0 is automatic, otherwise the format + 1
+	void saveTo(olc::utils::datafile& df) override {
+		GraphicsNode::saveTo(df);
+		df["format"].SetInt(format ? int(*format) + 1 : 0);
+	}
+
+	void loadFrom(olc::utils::datafile& df) override {
+		GraphicsNode::loadFrom(df);
+		int value = df["format"].GetInt();
+		if (value > 0 && value <= int(std::size(storageFormats))) format = StorageFormat(value - 1);
+	}
+
+	std::optional<StorageFormat> format; // none picks one from what's connected
 	std::unique_ptr<Texture> texture;
 };
 
@@ -498,6 +682,14 @@ void gen_shape_circle(in vec2 uv, float r, out float res) {
 		addParam("Radius", ValueType::scalar);
 		setParam("Radius", 0.5f);
 	}
+
+	bool evaluate(CpuArgs& args) override {
+		CpuValue uv = args.get(0);
+		CpuScalar x = clamp(uv.x, 0.0f, 1.0f) * 2.0f - 1.0f;
+		CpuScalar y = clamp(uv.y, 0.0f, 1.0f) * 2.0f - 1.0f;
+		args.set(0, { 1.0f - (sqrt(x * x + y * y) - args.scalar(1)) });
+		return true;
+	}
 };
 
 class BoxShapeNode : public GraphicsNode {
@@ -534,8 +726,25 @@ void gen_shape_box(in vec2 uv, vec2 b, in vec4 r, out float res) {
 		setParam("Bounds", { 0.5f, 0.5f });
 		setParam("Border Radius", { 0.0f, 0.0f, 0.0f, 0.0f });
 	}
+
+	bool evaluate(CpuArgs& args) override {
+		CpuValue uv = args.get(0), b = args.get(1), r = args.get(2);
+		CpuScalar x = clamp(uv.x, 0.0f, 1.0f) * 2.0f - 1.0f;
+		CpuScalar y = clamp(uv.y, 0.0f, 1.0f) * 2.0f - 1.0f;
+
+		// the corner's radius: r.xy on the right, r.zw on the left, then by y
+		CpuScalar right = x > 0.0f;
+		CpuScalar radius = select(y > 0.0f, select(right, r.x, r.z), select(right, r.y, r.w));
+
+		CpuScalar qx = abs(x) - b.x + radius, qy = abs(y) - b.y + radius;
+		CpuScalar ox = max(qx, 0.0f), oy = max(qy, 0.0f);
+		CpuScalar dist = min(max(qx, qy), 0.0f) + sqrt(ox * ox + oy * oy) - radius;
+		args.set(0, { 1.0f - dist });
+		return true;
+	}
 };
 
+#ifdef _WIN32
 class WebCamNode : public GraphicsNode {
 public:
 	std::string library() {
@@ -559,7 +768,7 @@ public:
 		addInput("UV", ValueType::vec2);
 	}
 
-	bool render(uint32_t width, uint32_t height, size_t binding = 0) override {
+	bool render(uint32_t width, uint32_t height, size_t binding = 0, StorageFormat storage = StorageFormat::rgba32f) override {
 		if (!texture) {
 			CoInitialize(NULL);
 
@@ -583,22 +792,22 @@ public:
 			doCapture(1);
 			while (isCaptureDone(1) == 0);
 
-			texture = std::unique_ptr<Texture>(new Texture({ uint32_t(captureParams.mWidth), uint32_t(captureParams.mHeight) }, GL_RGBA32F));
+			// 8 bits per channel from the camera, no point storing more
+			texture = std::unique_ptr<Texture>(new Texture({ uint32_t(captureParams.mWidth), uint32_t(captureParams.mHeight) }, GL_RGBA8));
 
-			float* floatData = new float[captureParams.mWidth * captureParams.mHeight * 4];
+			uint8_t* byteData = new uint8_t[captureParams.mWidth * captureParams.mHeight * 4];
 			for (size_t i = 0; i < captureParams.mWidth * captureParams.mHeight; i++) {
 				int pixel = captureParams.mTargetBuf[i];
-				int r = (pixel & 0x00FF0000) >> 16;
-				int g = (pixel & 0x0000FF00) >> 8;
-				int b = (pixel & 0x000000FF);
-				floatData[i * 4 + 0] = float(r) / 255.0f;
-				floatData[i * 4 + 1] = float(g) / 255.0f;
-				floatData[i * 4 + 2] = float(b) / 255.0f;
-				floatData[i * 4 + 3] = 1.0f;
+				byteData[i * 4 + 0] = uint8_t((pixel & 0x00FF0000) >> 16);
+				byteData[i * 4 + 1] = uint8_t((pixel & 0x0000FF00) >> 8);
+				byteData[i * 4 + 2] = uint8_t(pixel & 0x000000FF);
+				byteData[i * 4 + 3] = 255;
 			}
 
-			texture->loadFromMemory(floatData, GL_RGBA, GL_FLOAT);
+			texture->loadFromMemory(byteData, GL_RGBA, GL_UNSIGNED_BYTE);
+			delete[] byteData;
 
+			setParamFormat("Image", StorageFormat::rgba8);
 			setParam("Image", float(texture->id()));
 
 			deinitCapture(1);
@@ -606,6 +815,30 @@ public:
 		return true;
 	}
 
-	struct SimpleCapParams captureParams;
+	~WebCamNode() {
+		delete[] captureParams.mTargetBuf;
+	}
+
+	struct SimpleCapParams captureParams{};
 	std::unique_ptr<Texture> texture;
 };
+#endif
+
+// a node by the type code the editor saves it with (nodeTypes in
+// TextureNodeRegistry.h), for loading a graph without the editor
+template <typename Graph>
+GraphicsNode* createTextureNode(Graph& graph, std::string_view code) {
+	if (code == "COL") return graph.template create<ColorNode>();
+	if (code == "MIX") return graph.template create<MixNode>();
+	if (code == "SGR") return graph.template create<SimpleGradientNode>();
+	if (code == "NOI") return graph.template create<NoiseNode>();
+	if (code == "THR") return graph.template create<ThresholdNode>();
+	if (code == "IMG") return graph.template create<ImageNode>();
+	if (code == "UVS") return graph.template create<UVNode>();
+	if (code == "RGR") return graph.template create<RadialGradientNode>();
+	if (code == "NRM") return graph.template create<NormalMapNode>();
+	if (code == "OUT") return graph.template create<OutputNode>();
+	if (code == "SCIRCLE") return graph.template create<CircleShapeNode>();
+	if (code == "SBOX") return graph.template create<BoxShapeNode>();
+	return nullptr;
+}
@@ -0,0 +1,134 @@
+#include "ThreadPool.h"
+
+#include <bit>
+
+void WorkDeque::reset(size_t capacity) {
+	capacity = std::bit_ceil(std::max<size_t>(capacity, 2));
+	if (capacity > m_capacity) {
+		m_buffer = std::make_unique<std::atomic<void*>[]>(capacity);
+		m_capacity = capacity;
+		m_mask = int64_t(capacity - 1);
+	}
+	m_top.store(0, std::memory_order_relaxed);
+	m_bottom.store(0, std::memory_order_relaxed);
+}
+
+void WorkDeque::push(void* item) {
+	int64_t b = m_bottom.load(std::memory_order_relaxed);
+	m_buffer[b & m_mask].store(item, std::memory_order_relaxed);
+	m_bottom.store(b + 1, std::memory_order_release); // publishes the item to steal()
+}
+
+void* WorkDeque::pop() {
+	int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+	m_bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = m_top.load(std::memory_order_relaxed);
+
+	if (t > b) { // empty
+		m_bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	void* item = m_buffer[b & m_mask].load(std::memory_order_relaxed);
+	if (t == b) { // last item, race against the thieves
+		if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			item = nullptr;
+		}
+		m_bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return item;
+}
+
+void* WorkDeque::steal() {
+	int64_t t = m_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = m_bottom.load(std::memory_order_acquire);
+
+	if (t >= b) return nullptr;
+
+	void* item = m_buffer[t & m_mask].load(std::memory_order_relaxed);
+	if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+		return nullptr;
+	}
+	return item;
+}
+
+ThreadPool::ThreadPool(size_t threadCount) : m_deques(std::max<size_t>(threadCount, 1)) {
+	for (size_t i = 1; i < m_deques.size(); i++) {
+		m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+	for (auto&& thread : m_threads) thread.join();
+}
+
+void ThreadPool::run(std::span<void* const> seeds, size_t total, const Job& job) {
+	if (total == 0) return;
+
+	for (auto&& deque : m_deques) deque.reset(total);
+	for (size_t i = 0; i < seeds.size(); i++) {
+		m_deques[i % m_deques.size()].push(seeds[i]);
+	}
+
+	m_job = &job;
+	m_remaining.store(total, std::memory_order_release);
+
+	if (!m_threads.empty()) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_busy.store(m_threads.size(), std::memory_order_relaxed);
+			m_runId++;
+		}
+		m_wake.notify_all();
+	}
+
+	work(0);
+
+	// the deques get reset on the next run, wait for everyone to leave
+	while (m_busy.load(std::memory_order_acquire) > 0) {
+		std::this_thread::yield();
+	}
+	m_job = nullptr;
+}
+
+void ThreadPool::workerLoop(size_t worker) {
+	uint64_t seenRun = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [&]() { return m_quit || m_runId != seenRun; });
+			if (m_quit) return;
+			seenRun = m_runId;
+		}
+
+		work(worker);
+		m_busy.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+void ThreadPool::work(size_t worker) {
+	const size_t count = m_deques.size();
+
+	while (m_remaining.load(std::memory_order_acquire) > 0) {
+		void* item = m_deques[worker].pop();
+
+		for (size_t i = 1; !item && i < count; i++) {
+			item = m_deques[(worker + i) % count].steal();
+		}
+
+		if (!item) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		(*m_job)(item, worker);
+		m_remaining.fetch_sub(1, std::memory_order_acq_rel);
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <span>
+#include <cstdint>
+
+/*
+ * Chase-Lev work-stealing deque
+ * ====================================================
+ * The owner pushes and pops at the bottom, other workers steal from the top.
+ * Lock-free, fixed capacity (power of two), sized by the pool before each run.
+ */
+class WorkDeque {
+public:
+	void reset(size_t capacity);
+
+	void push(void* item);	// owner only
+	void* pop();			// owner only
+	void* steal();			// any thread
+
+private:
+	alignas(64) std::atomic<int64_t> m_top{ 0 };
+	alignas(64) std::atomic<int64_t> m_bottom{ 0 };
+	std::unique_ptr<std::atomic<void*>[]> m_buffer;
+	size_t m_capacity{ 0 };
+	int64_t m_mask{ 0 };
+};
+
+/*
+ * Work-stealing thread pool
+ * ====================================================
+ * run() hands out the seed items and blocks until exactly `total` items have
+ * been processed. The job may push more items (on the calling worker's deque)
+ * while it runs, idle workers steal them. The calling thread takes part as
+ * worker 0, so a pool of size N spawns N - 1 threads.
+ */
+class ThreadPool {
+public:
+	using Job = std::function<void(void* item, size_t worker)>;
+
+	explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void run(std::span<void* const> seeds, size_t total, const Job& job);
+	void push(size_t worker, void* item) { m_deques[worker].push(item); }
+
+	size_t size() const { return m_deques.size(); }
+
+private:
+	std::vector<WorkDeque> m_deques;
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	uint64_t m_runId{ 0 };
+	bool m_quit{ false };
+
+	const Job* m_job{ nullptr };
+	std::atomic<size_t> m_remaining{ 0 };
+	std::atomic<size_t> m_busy{ 0 };
+
+	void workerLoop(size_t worker);
+	void work(size_t worker);
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "IntHash.h"
+#include "Simd.h"
+
+#include <cstdint>
+#include <cmath>
+
+/*
+ * Voronoise
+ * ====================================================
+ * The CPU kernels of the noise node, iq's voronoise: every pixel weighs the
+ * 5x5 cells around it, each jittered by a hash of its cell. Both take the
+ * operands x, y, u (jitter) and k (sharpness exponent, already worked out
+ * from the param so it folds) and match the GLSL of NoiseNode.
+ *
+ * classic is the original, a sin hash per cell and a pow per tap. fast is
+ * the "Integer" hash variant:
+ *  - pcg3d (IntHash.h) instead of the sin hash, the same bits on every ISA
+ *    and on the GPU;
+ *  - the 8 pixels of a batch usually sit in one or two cells, so the hashes
+ *    of the cells around them come from a per thread cache (the workers run
+ *    rows of a tile left to right, the cache only misses on a new cell);
+ *  - taps out of reach in every lane (weight 0) skip the pow.
+ */
+namespace voronoise {
+
+inline simd::Float classic(const simd::Float* operands) {
+	using namespace simd;
+	const Float x = operands[0], y = operands[1], u = operands[2], k = operands[3];
+
+	Float px = floor(x), py = floor(y);
+	Float fx = x - px, fy = y - py;
+
+	// fract(sin(q) * 43758.5453), the template's hash3
+	auto hash = [](Float q) { return fract(sin(q) * 43758.5453f); };
+
+	Float va = 0.0f, wt = 0.0f;
+	for (int j = -2; j <= 2; j++) {
+		for (int i = -2; i <= 2; i++) {
+			Float cx = px + float(i), cy = py + float(j);
+			Float ox = hash(cx * 127.1f + cy * 311.7f) * u;
+			Float oy = hash(cx * 269.5f + cy * 183.3f) * u;
+			Float oz = hash(cx * 419.2f + cy * 371.9f);
+
+			Float rx = Float(float(i)) - fx + ox, ry = Float(float(j)) - fy + oy;
+			Float d = sqrt(rx * rx + ry * ry);
+			Float ww = pow(Float(1.0f) - smoothstep(0.0f, 1.414f, d), k);
+			va += oz * ww;
+			wt += ww;
+		}
+	}
+	return va / wt;
+}
+
+// the hashes of the cells around (x, y): rows y-2..y+2, columns x-3..x+3, so
+// lanes one cell left or right of x find theirs too
+struct CellCache {
+	int32_t x{ 0 }, y{ 0 };
+	bool valid{ false };
+	float hashes[5][7][3];
+
+	void fill(int32_t cx, int32_t cy) {
+		x = cx;
+		y = cy;
+		valid = true;
+		for (int j = 0; j < 5; j++) {
+			for (int i = 0; i < 7; i++) int_hash::hash3(cx + i - 3, cy + j - 2, hashes[j][i]);
+		}
+	}
+};
+
+// cells past this many can't be hashed through the cache, their floats aren't whole numbers apart
+constexpr float cacheRange = 16777216.0f;
+
+inline simd::Float fast(const simd::Float* operands) {
+	using namespace simd;
+	const Float x = operands[0], y = operands[1], u = operands[2], k = operands[3];
+
+	Float px = floor(x), py = floor(y);
+	Float fx = x - px, fy = y - py;
+
+	alignas(32) float cellX[width], cellY[width];
+	px.store(cellX);
+	py.store(cellY);
+
+	// one row of cells, lanes at most a cell away from the first one's
+	thread_local CellCache cache;
+	const float firstX = cellX[0], firstY = cellY[0];
+	Mask left = px == Float(firstX - 1.0f), right = px == Float(firstX + 1.0f);
+	bool cached = std::fabs(firstX) < cacheRange && std::fabs(firstY) < cacheRange
+		&& all((py == Float(firstY)) & (left | right | (px == Float(firstX))));
+	bool spread = cached && any(left | right);
+	if (cached && (!cache.valid || cache.x != int32_t(firstX) || cache.y != int32_t(firstY))) {
+		cache.fill(int32_t(firstX), int32_t(firstY));
+	}
+
+	Int ix = toInt(px), iy = toInt(py);
+
+	Float va = 0.0f, wt = 0.0f;
+	for (int j = -2; j <= 2; j++) {
+		for (int i = -2; i <= 2; i++) {
+			Float o[3];
+			if (!cached) {
+				int_hash::hash3(ix + Int(i), iy + Int(j), o);
+			}
+			else {
+				const float (&row)[7][3] = cache.hashes[j + 2];
+				for (int c = 0; c < 3; c++) {
+					o[c] = row[i + 3][c];
+					if (spread) o[c] = select(left, Float(row[i + 2][c]), select(right, Float(row[i + 4][c]), o[c]));
+				}
+			}
+
+			Float rx = Float(float(i)) - fx + o[0] * u, ry = Float(float(j)) - fy + o[1] * u;
+			Float d2 = rx * rx + ry * ry;
+
+			// smoothstep(0, 1.414, d) is 1 from there on, and the weight pow(0, k)
+			if (!any(d2 < Float(1.414f * 1.414f))) continue;
+
+			Float t = min(sqrt(d2) * (1.0f / 1.414f), 1.0f);
+			Float ww = pow(Float(1.0f) - t * t * (Float(3.0f) - Float(2.0f) * t), k);
+			va += o[2] * ww;
+			wt += ww;
+		}
+	}
+	return va / wt;
+}
+
+} // namespace voronoise
@@ -24,6 +24,7 @@
 #include <sstream>
 #include <array>
 #include <string_view>
+#include <unordered_map>
 
 #include <iostream>
 
@@ -100,6 +101,7 @@ public:
 			}
 
 			singleNodeEditor = createTextureNodeEditorGui(node);
+			editedNode = node;
 			if (singleNodeEditor) {
 				pnlSettings->addChild(singleNodeEditor);
 			}
@@ -109,11 +111,36 @@ public:
 				if (!out->texture) return;
 
 				previewControl->setTexture(out->texture.get());
+				previewedNode = node;
 			}
 		};
 
+		ned->onRemove = [=](VisualNode* node) {
+			if (node == editedNode) {
+				if (singleNodeEditor) {
+					pnlSettings->removeChild(singleNodeEditor->id());
+					singleNodeEditor = nullptr;
+				}
+				editedNode = nullptr;
+			}
+
+			if (node == previewedNode) {
+				previewControl->setTexture(nullptr);
+				previewedNode = nullptr;
+			}
+
+			nodeTypeStorage.erase(node->node()->id());
+		};
+
 		ned->onParamChange = [=]() {
-			graph->render();
+			// a variant or a format change is a new shader, value edits only upload and render
+			graph->update();
+
+			// the output texture is reallocated when its format changes
+			if (previewedNode) {
+				OutputNode* out = dynamic_cast<OutputNode*>(previewedNode->node());
+				if (out) previewControl->setTexture(out->texture.get());
+			}
 		};
 
 		// build the Node list UI
@@ -234,27 +261,42 @@ public:
 		if(!in.Read(in, std::string(file)))
 			return false;
 
-		// create nodes
-		for (size_t i = 0; i < in["nodes"].GetArraySize(); i++) {
-			auto&& val = in["nodes"].GetArrayItem(i);
+		// batch everything, the graph is ordered and solved once at the end
+		ned->beginTransaction();
+
+		// create nodes, saved ids are only used to resolve the connections below
+		std::unordered_map<int32_t, VisualNode*> savedIds;
+		auto&& nodes = in["nodes"];
+		for (size_t i = 0; i < nodes.GetArraySize(); i++) {
+			auto&& val = nodes.GetArrayItem(i);
 			auto&& node = createNewTextureNode(ned, val["type"].GetString());
+			if (!node) continue;
+
 			node->position.x = val["position"].GetInt(0);
 			node->position.y = val["position"].GetInt(1);
 			static_cast<GraphicsNode*>(node->node())->loadFrom(val);
 
+			savedIds[val["id"].GetInt()] = node;
 			nodeTypeStorage[node->node()->id()] = { val["type"].GetString(), node->id() };
 		}
 
-		for (size_t i = 0; i < in["connections"].GetArraySize(); i++) {
-			auto&& val = in["connections"].GetArrayItem(i);
+		auto&& connections = in["connections"];
+		for (size_t i = 0; i < connections.GetArraySize(); i++) {
+			auto&& val = connections.GetArrayItem(i);
+			auto source = savedIds.find(val["source"].GetInt());
+			auto destination = savedIds.find(val["destination"].GetInt());
+			if (source == savedIds.end() || destination == savedIds.end()) continue;
+
 			ned->connect(
-				ned->getFromOriginalNodeId(val["source"].GetInt()),
+				source->second,
 				val["sourceOutput"].GetInt(),
-				ned->getFromOriginalNodeId(val["destination"].GetInt()),
+				destination->second,
 				val["destinationInput"].GetInt()
 			);
 		}
 
+		ned->commitTransaction();
+
 		return true;
 
 	}
@@ -265,6 +307,8 @@ public:
 
 	GUISystem* gui;
 	Control* singleNodeEditor{ nullptr };
+	VisualNode* editedNode{ nullptr };
+	VisualNode* previewedNode{ nullptr };
 
 	float bgColor[3] = { 0.1f, 0.2f, 0.4f };
 